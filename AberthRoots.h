@@ -0,0 +1,248 @@
+#pragma once
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <complex>
+#include <vector>
+#include "ThreadPool.h"
+
+// All roots of a complex polynomial at once by the Aberth-Ehrlich iteration:
+// every approximation z_i takes the Newton step N_i = P(z_i) / P'(z_i)
+// corrected for the pull of the other approximations,
+//     z_i -= N_i / (1 - N_i * sum_{j != i} 1 / (z_i - z_j)).
+// The starting points are spread over circles given by the Newton polygon
+// of the coefficient magnitudes. Roots are updated together from the
+// previous iterate (Jacobi style), so they are independent of each other
+// and are computed over the thread pool, four to a group so that their
+// Horner chains overlap. A root whose value is within
+// the rounding error of evaluating P drops out of the active set.
+
+// Tunable parameters of the Aberth solver
+struct AberthSettings
+{
+	// Iterations before giving up on the roots that did not converge
+	unsigned maxIterations;
+
+	static AberthSettings& Instance()
+	{
+		static AberthSettings settings = { 500 };
+		return settings;
+	}
+};
+
+// Starting points for the Aberth iteration (Bini): the upper convex hull
+// of the points (k, log |a_k|) splits the degree into runs, a run of
+// length m over an edge of slope -log u gets m points evenly spread on the
+// circle of radius u. Those radii bound the root moduli much more tightly
+// than one Cauchy circle does when they spread over orders of magnitude.
+// a_0 and a_n must not be zero
+inline std::vector<std::complex<double>> aberth_starting_points(const std::vector<double>& magnitudes)
+{
+	size_t n = magnitudes.size() - 1;
+	std::vector<double> logs(n + 1);
+	for (size_t k = 0; k <= n; k++) {
+		logs[k] = magnitudes[k] > 0 ? std::log(magnitudes[k]) : -HUGE_VAL;
+	}
+
+	// Upper hull by a monotone chain from k = 0 to k = n
+	std::vector<size_t> hull;
+	for (size_t k = 0; k <= n; k++) {
+		if (magnitudes[k] == 0)
+			continue;
+		while (hull.size() >= 2) {
+			size_t i = hull[hull.size() - 2];
+			size_t j = hull.back();
+			// Drop j when it is on or below the chord from i to k
+			if ((logs[j] - logs[i]) * (k - i) <= (logs[k] - logs[i]) * (j - i))
+				hull.pop_back();
+			else
+				break;
+		}
+		hull.push_back(k);
+	}
+
+	const double pi = std::acos(-1.0);
+	std::vector<std::complex<double>> points;
+	for (size_t e = 0; e + 1 < hull.size(); e++) {
+		size_t m = hull[e + 1] - hull[e];
+		double radius = std::exp((logs[hull[e]] - logs[hull[e + 1]]) / m);
+		// The turn off the real axis keeps conjugate pairs of real
+		// polynomials from moving in lockstep
+		for (size_t j = 0; j < m; j++) {
+			points.push_back(std::polar(radius, 2 * pi * j / m + 2 * pi * e / n + 0.4));
+		}
+	}
+	return points;
+}
+
+// Roots evaluated side by side in aberth_newton_ratios
+static const unsigned ABERTH_LANES = 4;
+
+// Newton ratios P(z) / P'(z) for up to ABERTH_LANES roots. Inside the unit
+// circle P is evaluated by Horner's rule, outside it the reversed
+// polynomial is evaluated at 1 / z, so that large |z| cannot overflow.
+// forward and backward hold the coefficients in Horner order for the two
+// cases, as re, im, abs triples. converged[l] tells whether |P(z)| is
+// within the rounding error bound (2n + 1) eps sum |a_k| |z|^k
+inline void aberth_newton_ratios(size_t degree, const double* forward, const double* backward, unsigned lanes, const std::complex<double>* z, std::complex<double>* ratios, bool* converged)
+{
+	const double* coefficients[ABERTH_LANES];
+	double wr[ABERTH_LANES], wi[ABERTH_LANES], wa[ABERTH_LANES];
+	double pr[ABERTH_LANES], pi[ABERTH_LANES], dr[ABERTH_LANES], di[ABERTH_LANES], bound[ABERTH_LANES];
+	for (unsigned l = 0; l < ABERTH_LANES; l++) {
+		// Spare lanes repeat the first one
+		std::complex<double> x = z[l < lanes ? l : 0];
+		bool inside = std::abs(x) <= 1;
+		std::complex<double> w = inside ? x : 1.0 / x;
+		coefficients[l] = inside ? forward : backward;
+		wr[l] = w.real();
+		wi[l] = w.imag();
+		wa[l] = std::abs(w);
+		pr[l] = coefficients[l][0];
+		pi[l] = coefficients[l][1];
+		bound[l] = coefficients[l][2];
+		dr[l] = 0;
+		di[l] = 0;
+	}
+
+	for (size_t k = 1; k <= degree; k++) {
+		for (unsigned l = 0; l < ABERTH_LANES; l++) {
+			const double* a = coefficients[l] + 3 * k;
+			double tr = dr[l] * wr[l] - di[l] * wi[l] + pr[l];
+			double ti = dr[l] * wi[l] + di[l] * wr[l] + pi[l];
+			dr[l] = tr;
+			di[l] = ti;
+			tr = pr[l] * wr[l] - pi[l] * wi[l] + a[0];
+			ti = pr[l] * wi[l] + pi[l] * wr[l] + a[1];
+			pr[l] = tr;
+			pi[l] = ti;
+			bound[l] = bound[l] * wa[l] + a[2];
+		}
+	}
+
+	for (unsigned l = 0; l < lanes; l++) {
+		std::complex<double> p(pr[l], pi[l]);
+		std::complex<double> dp(dr[l], di[l]);
+		converged[l] = std::abs(p) <= (2.0 * degree + 1) * DBL_EPSILON * bound[l];
+		if (coefficients[l] == forward) {
+			ratios[l] = dp == 0.0 ? p : p / dp;
+		}
+		else {
+			// P(z) = z^n R(y) and P'(z) = z^(n - 1) (n R(y) - y R'(y)) for y = 1 / z
+			std::complex<double> y(wr[l], wi[l]);
+			std::complex<double> denominator = y * ((double)degree * p - y * dp);
+			ratios[l] = denominator == 0.0 ? p : p / denominator;
+		}
+	}
+}
+
+// Roots of sum coefficients[k] x^k, as many as its degree without the
+// vanishing leading coefficients. Returns false when some of the roots did
+// not converge in AberthSettings::maxIterations; roots then holds the last
+// approximations
+inline bool aberth_roots(const std::vector<std::complex<double>>& coefficients, std::vector<std::complex<double>>& roots)
+{
+	typedef std::complex<double> cd;
+	roots.clear();
+	size_t top = coefficients.size();
+	while (top > 0 && coefficients[top - 1] == 0.0) {
+		top--;
+	}
+	size_t bottom = 0;
+	while (bottom < top && coefficients[bottom] == 0.0) {
+		roots.push_back(0);
+		bottom++;
+	}
+	if (top - bottom <= 1)
+		return true;
+
+	// What is left is a_0 + ... + a_n x^n with a_0 and a_n non-zero
+	size_t degree = top - bottom - 1;
+	std::vector<double> forward(3 * (degree + 1)), backward(3 * (degree + 1)), magnitudes(degree + 1);
+	for (size_t k = 0; k <= degree; k++) {
+		cd a = coefficients[bottom + k];
+		magnitudes[k] = std::abs(a);
+		double* high = &forward[3 * (degree - k)];
+		double* low = &backward[3 * k];
+		high[0] = low[0] = a.real();
+		high[1] = low[1] = a.imag();
+		high[2] = low[2] = magnitudes[k];
+	}
+
+	std::vector<cd> z = aberth_starting_points(magnitudes);
+	std::vector<cd> next(degree);
+
+	std::vector<double> zr(degree), zi(degree);
+	std::vector<unsigned> active(degree);
+	for (unsigned i = 0; i < degree; i++) {
+		active[i] = i;
+	}
+	std::vector<char> done(degree);
+	unsigned maxIterations = AberthSettings::Instance().maxIterations;
+
+	for (unsigned iteration = 0; iteration < maxIterations && !active.empty(); iteration++) {
+		for (size_t j = 0; j < degree; j++) {
+			zr[j] = z[j].real();
+			zi[j] = z[j].imag();
+		}
+
+		size_t groups = (active.size() + ABERTH_LANES - 1) / ABERTH_LANES;
+		size_t grain = std::max<size_t>(1, PARALLEL_MIN_ELEMENTS / (ABERTH_LANES * 2 * degree));
+		ThreadPool::Instance().ParallelFor(groups, grain, [&](size_t begin, size_t end) {
+			for (size_t group = begin; group < end; group++) {
+				size_t first = group * ABERTH_LANES;
+				unsigned lanes = (unsigned)std::min<size_t>(ABERTH_LANES, active.size() - first);
+				cd points[ABERTH_LANES], ratios[ABERTH_LANES];
+				bool converged[ABERTH_LANES];
+				for (unsigned l = 0; l < lanes; l++) {
+					points[l] = z[active[first + l]];
+				}
+				aberth_newton_ratios(degree, forward.data(), backward.data(), lanes, points, ratios, converged);
+
+				for (unsigned l = 0; l < lanes; l++) {
+					unsigned i = active[first + l];
+					// sum_{j != i} 1 / (z_i - z_j) in four independent partial sums
+					double xr = zr[i], xi = zi[i];
+					double sr[4] = { 0, 0, 0, 0 }, si[4] = { 0, 0, 0, 0 };
+					auto accumulate = [&](size_t from, size_t to) {
+						size_t j = from;
+						for (; j + 4 <= to; j += 4) {
+							for (unsigned q = 0; q < 4; q++) {
+								double ur = xr - zr[j + q], ui = xi - zi[j + q];
+								double scale = 1 / (ur * ur + ui * ui);
+								sr[q] += ur * scale;
+								si[q] -= ui * scale;
+							}
+						}
+						for (; j < to; j++) {
+							double ur = xr - zr[j], ui = xi - zi[j];
+							double scale = 1 / (ur * ur + ui * ui);
+							sr[0] += ur * scale;
+							si[0] -= ui * scale;
+						}
+					};
+					accumulate(0, i);
+					accumulate(i + 1, degree);
+					cd sum(sr[0] + sr[1] + sr[2] + sr[3], si[0] + si[1] + si[2] + si[3]);
+
+					cd denominator = 1.0 - ratios[l] * sum;
+					cd step = denominator == 0.0 ? ratios[l] : ratios[l] / denominator;
+					next[i] = points[l] - step;
+					done[i] = converged[l];
+				}
+			}
+		});
+
+		size_t kept = 0;
+		for (size_t a = 0; a < active.size(); a++) {
+			unsigned i = active[a];
+			z[i] = next[i];
+			if (!done[i])
+				active[kept++] = i;
+		}
+		active.resize(kept);
+	}
+
+	roots.insert(roots.end(), z.begin(), z.end());
+	return active.empty();
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <new>
+
+// Cache line size used for the alignment of the matrix storage
+static const std::size_t CACHE_LINE_SIZE = 64;
+
+// Number of blocks handed out by AlignedAllocator so far, for checking
+// that code paths which should not allocate really do not
+inline std::atomic<unsigned long long>& AlignedAllocationCount()
+{
+	static std::atomic<unsigned long long> count(0);
+	return count;
+}
+
+// STL allocator returning blocks aligned to the given boundary
+template <typename T, std::size_t Alignment = CACHE_LINE_SIZE>
+class AlignedAllocator
+{
+public:
+	using value_type = T;
+
+	template <typename U>
+	struct rebind
+	{
+		using other = AlignedAllocator<U, Alignment>;
+	};
+
+	AlignedAllocator() noexcept {}
+
+	template <typename U>
+	AlignedAllocator(const AlignedAllocator<U, Alignment>&) noexcept {}
+
+	T* allocate(std::size_t n)
+	{
+		AlignedAllocationCount().fetch_add(1, std::memory_order_relaxed);
+		return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(Alignment)));
+	}
+
+	void deallocate(T* p, std::size_t) noexcept
+	{
+		::operator delete(p, std::align_val_t(Alignment));
+	}
+
+	template <typename U>
+	bool operator==(const AlignedAllocator<U, Alignment>&) const noexcept
+	{
+		return true;
+	}
+
+	template <typename U>
+	bool operator!=(const AlignedAllocator<U, Alignment>&) const noexcept
+	{
+		return false;
+	}
+};
@@ -0,0 +1,116 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include "AlignedAllocator.h"
+
+// Fixed-size array in cache-line aligned memory. Unlike std::vector it can
+// be allocated without initializing the elements, so a result that is about
+// to be overwritten costs one allocation and no extra sweep over memory.
+template <typename T>
+class AlignedBuffer
+{
+private:
+	T* elements;
+	size_t count;
+
+	// Types whose raw bytes may be used without running a constructor
+	static const bool RAW_STORAGE = std::is_trivially_copyable<T>::value && std::is_trivially_destructible<T>::value;
+
+	static T* allocate(size_t n)
+	{
+		return n > 0 ? AlignedAllocator<T>().allocate(n) : nullptr;
+	}
+
+	void release()
+	{
+		if (elements == nullptr)
+			return;
+		if (!std::is_trivially_destructible<T>::value) {
+			for (size_t i = 0; i < count; i++) {
+				elements[i].~T();
+			}
+		}
+		AlignedAllocator<T>().deallocate(elements, count);
+		elements = nullptr;
+		count = 0;
+	}
+
+public:
+	AlignedBuffer() : elements(nullptr), count(0) {}
+
+	AlignedBuffer(size_t n, const T& value) : elements(allocate(n)), count(n)
+	{
+		std::uninitialized_fill(elements, elements + n, value);
+	}
+
+	AlignedBuffer(const AlignedBuffer& rhs) : elements(allocate(rhs.count)), count(rhs.count)
+	{
+		std::uninitialized_copy(rhs.elements, rhs.elements + count, elements);
+	}
+
+	AlignedBuffer(AlignedBuffer&& rhs) noexcept : elements(rhs.elements), count(rhs.count)
+	{
+		rhs.elements = nullptr;
+		rhs.count = 0;
+	}
+
+	~AlignedBuffer()
+	{
+		release();
+	}
+
+	// Buffer whose elements are about to be overwritten. Trivial types are
+	// left uninitialized, the others are default-constructed
+	static AlignedBuffer uninitialized(size_t n)
+	{
+		AlignedBuffer result;
+		result.elements = allocate(n);
+		result.count = n;
+		if (!RAW_STORAGE) {
+			std::uninitialized_fill(result.elements, result.elements + n, T());
+		}
+		return result;
+	}
+
+	AlignedBuffer& operator=(const AlignedBuffer& rhs)
+	{
+		if (&rhs == this)
+			return *this;
+
+		// Same size: copy over the existing elements without reallocating
+		if (rhs.count == count) {
+			std::copy(rhs.elements, rhs.elements + count, elements);
+			return *this;
+		}
+
+		AlignedBuffer copy(rhs);
+		swap(copy);
+		return *this;
+	}
+
+	AlignedBuffer& operator=(AlignedBuffer&& rhs) noexcept
+	{
+		if (&rhs != this) {
+			release();
+			elements = rhs.elements;
+			count = rhs.count;
+			rhs.elements = nullptr;
+			rhs.count = 0;
+		}
+		return *this;
+	}
+
+	void swap(AlignedBuffer& rhs) noexcept
+	{
+		std::swap(elements, rhs.elements);
+		std::swap(count, rhs.count);
+	}
+
+	size_t size() const { return count; }
+	T* data() { return elements; }
+	const T* data() const { return elements; }
+	T& operator[](size_t i) { return elements[i]; }
+	const T& operator[](size_t i) const { return elements[i]; }
+};
@@ -0,0 +1,1036 @@
+#pragma once
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <cmath>
+#include <complex>
+#include "BigInt.h"
+#include "BigIntDecimal.h"
+#include "BigIntDivide.h"
+#include "BigIntMultiply.h"
+#include "FixedMatrix.h"
+#include "QSMatrix.h"
+#include "WideUInt.h"
+#include "Polynomial.h"
+#include "Eigenvalues.h"
+
+using namespace std;
+
+/*
+*  .   main() 
+*/
+
+/*
+*        (  ).
+*  ,      minSeconds
+*/
+template <typename Func>
+double MeasureSeconds(Func func, double minSeconds = 0.2)
+{
+	typedef chrono::steady_clock Clock;
+	int runs = 0;
+	Clock::time_point startTime = Clock::now();
+	double elapsed = 0;
+	do {
+		func();
+		runs++;
+		elapsed = chrono::duration<double>(Clock::now() - startTime).count();
+	} while (elapsed < minSeconds);
+
+	return elapsed / runs;
+}
+
+/*
+*      [-1, 1]
+*/
+inline void FillRandom(QSMatrix<double> &matrix)
+{
+	for (unsigned i = 0; i < matrix.get_rows(); i++) {
+		for (unsigned j = 0; j < matrix.get_cols(); j++) {
+			matrix(i, j) = 2.0 * rand() / RAND_MAX - 1.0;
+		}
+	}
+}
+
+inline void FillRandom(QSMatrix<complex<double>> &matrix)
+{
+	for (unsigned i = 0; i < matrix.get_rows(); i++) {
+		for (unsigned j = 0; j < matrix.get_cols(); j++) {
+			matrix(i, j) = complex<double>(2.0 * rand() / RAND_MAX - 1.0, 2.0 * rand() / RAND_MAX - 1.0);
+		}
+	}
+}
+
+/*
+*     i-j-k,    QSMatrix::operator*
+*/
+template <typename T>
+QSMatrix<T> NaiveMultiply(const QSMatrix<T> &lhs, const QSMatrix<T> &rhs)
+{
+	QSMatrix<T> result(lhs.get_rows(), rhs.get_cols(), 0.0);
+	for (unsigned i = 0; i < lhs.get_rows(); i++) {
+		for (unsigned j = 0; j < rhs.get_cols(); j++) {
+			for (unsigned k = 0; k < lhs.get_cols(); k++) {
+				result(i, j) = result(i, j) + lhs(i, k) * rhs(k, j);
+			}
+		}
+	}
+	return result;
+}
+
+/*
+* GFLOP/s     16..2048:
+*      QSMatrix::operator*
+* @param double flopsPerMultAdd -    - (2  double, 8  complex)
+*/
+template <typename T>
+void GemmBenchmark(const char *typeName, double flopsPerMultAdd)
+{
+	printf("GEMM, %s\n", typeName);
+	printf("%6s %14s %14s %10s\n", "size", "naive GFLOP/s", "gemm GFLOP/s", "speedup");
+
+	for (unsigned size = 16; size <= 2048; size *= 2) {
+		QSMatrix<T> a(size, size, 0.0);
+		QSMatrix<T> b(size, size, 0.0);
+		FillRandom(a);
+		FillRandom(b);
+		double flops = flopsPerMultAdd * size * size * size;
+
+		double naiveTime = MeasureSeconds([&]() { NaiveMultiply(a, b); });
+		double gemmTime = MeasureSeconds([&]() { a * b; });
+
+		printf("%6u %14.2f %14.2f %9.1fx\n", size, flops / naiveTime * 1e-9, flops / gemmTime * 1e-9, naiveTime / gemmTime);
+	}
+}
+
+inline void GemmBenchmarks()
+{
+	printf("Complex kernels: %s\n", ComplexKernels::LevelName(ComplexKernels::Level()));
+	GemmBenchmark<double>("double", 2);
+	GemmBenchmark<complex<double>>("complex<double>", 8);
+}
+
+/*
+*   : ,     
+*  complex<double>  1..N  
+* @param unsigned size -   
+*/
+inline void ParallelScalingBenchmark(unsigned size = 1024)
+{
+	ThreadPool &pool = ThreadPool::Instance();
+	unsigned initialThreads = pool.ThreadCount();
+	unsigned maxThreads = thread::hardware_concurrency();
+	if (maxThreads == 0)
+		maxThreads = 1;
+
+	QSMatrix<complex<double>> a(size, size, 0.0);
+	QSMatrix<complex<double>> b(size, size, 0.0);
+	FillRandom(a);
+	FillRandom(b);
+	vector<complex<double>> v(size, complex<double>(1, 1));
+
+	printf("Thread scaling, complex<double> %ux%u\n", size, size);
+	printf("%8s %14s %10s %14s %10s %14s %10s\n", "threads", "gemm GFLOP/s", "speedup", "add GB/s", "speedup", "gemv GFLOP/s", "speedup");
+
+	double gemmBase = 0, addBase = 0, gemvBase = 0;
+	for (unsigned threads = 1; threads <= maxThreads; threads++) {
+		pool.SetThreadCount(threads);
+		double gemmTime = MeasureSeconds([&]() { a * b; });
+		double addTime = MeasureSeconds([&]() { a + b; });
+		double gemvTime = MeasureSeconds([&]() { a * v; });
+		if (threads == 1) {
+			gemmBase = gemmTime;
+			addBase = addTime;
+			gemvBase = gemvTime;
+		}
+
+		double elements = (double)size * size;
+		printf("%8u %14.2f %9.2fx %14.2f %9.2fx %14.2f %9.2fx\n", threads,
+			8.0 * elements * size / gemmTime * 1e-9, gemmBase / gemmTime,
+			3.0 * elements * sizeof(complex<double>) / addTime * 1e-9, addBase / addTime,
+			8.0 * elements / gemvTime * 1e-9, gemvBase / gemvTime);
+	}
+
+	pool.SetThreadCount(initialThreads);
+}
+
+/*
+*   :     
+*     - (crossover = size / 2).
+*  ,    , -  
+* StrassenSettings::crossover   
+*/
+template <typename T>
+void StrassenCrossoverBenchmark(const char *typeName)
+{
+	StrassenSettings &settings = StrassenSettings::Instance();
+	StrassenSettings initial = settings;
+
+	printf("Strassen crossover, %s\n", typeName);
+	printf("%6s %14s %14s %10s\n", "size", "classic, ms", "strassen, ms", "speedup");
+
+	unsigned crossover = 0;
+	for (unsigned size = 128; size <= 2048; size *= 2) {
+		QSMatrix<T> a(size, size, 0.0);
+		QSMatrix<T> b(size, size, 0.0);
+		FillRandom(a);
+		FillRandom(b);
+
+		settings.enabled = false;
+		double classicTime = MeasureSeconds([&]() { a * b; });
+		settings.enabled = true;
+		settings.crossover = size / 2;
+		double strassenTime = MeasureSeconds([&]() { a * b; });
+
+		if (crossover == 0 && strassenTime < classicTime)
+			crossover = size / 2;
+		printf("%6u %14.2f %14.2f %9.2fx\n", size, classicTime * 1e3, strassenTime * 1e3, classicTime / strassenTime);
+	}
+
+	if (crossover != 0)
+		printf("Suggested crossover: %u\n", crossover);
+	else
+		printf("Strassen does not pay off up to 2048\n");
+	settings = initial;
+}
+
+/*
+*    complex<double>:   
+*  ,   max|A| * max|B| * n,    
+*/
+inline void StrassenAccuracyReport(unsigned size = 1024)
+{
+	StrassenSettings &settings = StrassenSettings::Instance();
+	StrassenSettings initial = settings;
+
+	QSMatrix<complex<double>> a(size, size, 0.0);
+	QSMatrix<complex<double>> b(size, size, 0.0);
+	FillRandom(a);
+	FillRandom(b);
+
+	settings.enabled = false;
+	QSMatrix<complex<double>> reference = a * b;
+
+	double maxA = 0, maxB = 0;
+	for (unsigned i = 0; i < size; i++) {
+		for (unsigned j = 0; j < size; j++) {
+			maxA = max(maxA, abs(a(i, j)));
+			maxB = max(maxB, abs(b(i, j)));
+		}
+	}
+	double scale = maxA * maxB * size;
+
+	printf("Strassen accuracy, complex<double> %ux%u\n", size, size);
+	printf("%6s %10s %14s\n", "levels", "crossover", "max rel error");
+	settings.enabled = true;
+	unsigned levels = 1;
+	for (unsigned crossover = size / 2; crossover >= 32; crossover /= 2, levels++) {
+		settings.crossover = crossover;
+		QSMatrix<complex<double>> result = a * b;
+
+		double error = 0;
+		for (unsigned i = 0; i < size; i++) {
+			for (unsigned j = 0; j < size; j++) {
+				error = max(error, abs(result(i, j) - reference(i, j)));
+			}
+		}
+		printf("%6u %10u %14.3e\n", levels, crossover, error / scale);
+	}
+
+	settings = initial;
+}
+
+/*
+*  U * T * U^H,  U -    
+* .   ,   T
+*/
+inline QSMatrix<complex<double>> RandomUnitarySimilarity(const QSMatrix<complex<double>> &matrix)
+{
+	unsigned size = matrix.get_rows();
+	QSMatrix<complex<double>> result = matrix;
+	for (int reflection = 0; reflection < 3; reflection++) {
+		QSMatrix<complex<double>> direction(size, 1, 0.0);
+		FillRandom(direction);
+		double norm = 0;
+		for (unsigned i = 0; i < size; i++) {
+			norm += std::norm(direction(i, 0));
+		}
+
+		QSMatrix<complex<double>> reflector(size, size, 0.0);
+		for (unsigned i = 0; i < size; i++) {
+			for (unsigned j = 0; j < size; j++) {
+				reflector(i, j) = (i == j ? 1.0 : 0.0) - 2.0 * direction(i, 0) * conj(direction(j, 0)) / norm;
+			}
+		}
+		result = reflector * result * reflector;
+	}
+	return result;
+}
+
+/*
+*       
+*/
+inline double SpectrumDistance(const vector<complex<double>> &lhs, const vector<complex<double>> &rhs)
+{
+	double distance = 0;
+	for (int pass = 0; pass < 2; pass++) {
+		const vector<complex<double>> &from = pass == 0 ? lhs : rhs;
+		const vector<complex<double>> &to = pass == 0 ? rhs : lhs;
+		for (size_t i = 0; i < from.size(); i++) {
+			double nearest = HUGE_VAL;
+			for (size_t j = 0; j < to.size(); j++) {
+				nearest = min(nearest, abs(from[i] - to[j]));
+			}
+			distance = max(distance, nearest);
+		}
+	}
+	return distance;
+}
+
+/*
+*      EigenvalueBenchmark:
+* 0 - U * T * U^H, T     
+*       1 / size   (   ),
+* 1 -       ,
+* 2 -   (-1, 2, -1)
+*/
+inline QSMatrix<complex<double>> EigenTestMatrix(int kind, unsigned size, vector<complex<double>> &spectrum)
+{
+	const double pi = acos(-1.0);
+	QSMatrix<complex<double>> matrix(size, size, 0.0);
+	spectrum.resize(size);
+
+	if (kind == 2) {
+		for (unsigned i = 0; i < size; i++) {
+			matrix(i, i) = 2.0;
+			if (i + 1 < size) {
+				matrix(i, i + 1) = -1.0;
+				matrix(i + 1, i) = -1.0;
+			}
+			spectrum[i] = 2.0 - 2.0 * cos(pi * (i + 1) / (size + 1));
+		}
+		return matrix;
+	}
+
+	if (kind == 0)
+		FillRandom(matrix);
+	for (unsigned i = 0; i < size; i++) {
+		for (unsigned j = 0; j < i; j++) {
+			matrix(i, j) = 0.0;
+		}
+		for (unsigned j = i + 1; j < size; j++) {
+			matrix(i, j) /= size;
+		}
+		if (kind == 1)
+			matrix(i, i) = polar(1.0, 2 * pi * i / size);
+		spectrum[i] = matrix(i, i);
+	}
+	return RandomUnitarySimilarity(matrix);
+}
+
+/*
+*  :  (    )
+*  QR        
+* .  -     
+* @param unsigned berkowitzMaxSize -    ,    
+*/
+inline void EigenvalueBenchmark(unsigned berkowitzMaxSize = 32)
+{
+	const char *kinds[] = { "random", "circle", "tridiag" };
+	Eigenvalues eigenvalues;
+
+	printf("Eigenvalues, complex<double>\n");
+	printf("%8s %6s %14s %12s %14s %12s\n", "matrix", "size", "berkowitz, ms", "error", "hess-qr, ms", "error");
+	for (int kind = 0; kind < 3; kind++) {
+		for (unsigned size = 8; size <= 512; size *= 2) {
+			vector<complex<double>> spectrum;
+			QSMatrix<complex<double>> matrix = EigenTestMatrix(kind, size, spectrum);
+
+			vector<complex<double>> result;
+			double qrTime = MeasureSeconds([&]() { result = eigenvalues.GetEigenvalues(matrix, EIGEN_HESSENBERG_QR); });
+			double qrError = SpectrumDistance(result, spectrum);
+
+			if (size <= berkowitzMaxSize) {
+				double berkowitzTime = MeasureSeconds([&]() { result = eigenvalues.GetEigenvalues(matrix, EIGEN_BERKOWITZ); });
+				double berkowitzError = SpectrumDistance(result, spectrum);
+				printf("%8s %6u %14.3f %12.3e %14.3f %12.3e\n", kinds[kind], size, berkowitzTime * 1e3, berkowitzError, qrTime * 1e3, qrError);
+			}
+			else {
+				printf("%8s %6u %14s %12s %14.3f %12.3e\n", kinds[kind], size, "-", "-", qrTime * 1e3, qrError);
+			}
+		}
+	}
+}
+
+/*
+*   U * D * U^H    :
+*  QR    QL (   
+*  ),     .
+*  - max |A v - lambda v|   
+* @param unsigned maxSize -   
+*/
+inline void HermitianEigenBenchmark(unsigned maxSize = 1024)
+{
+	Eigenvalues eigenvalues;
+	QSMatrix<complex<double>> matrix(0, 0, 0.0);
+	QSMatrix<complex<double>> vectors(0, 0, 0.0);
+
+	printf("Hermitian eigenvalues, complex<double>\n");
+	printf("%6s %14s %12s %14s %12s %14s %12s\n", "size", "hess-qr, ms", "error", "values, ms", "error", "vectors, ms", "residual");
+	for (unsigned size = 64; size <= maxSize; size *= 2) {
+		QSMatrix<complex<double>> diagonal(size, size, 0.0);
+		vector<complex<double>> spectrum(size);
+		for (unsigned i = 0; i < size; i++) {
+			spectrum[i] = 2.0 * rand() / RAND_MAX - 1.0;
+			diagonal(i, i) = spectrum[i];
+		}
+		matrix = RandomUnitarySimilarity(diagonal);
+
+		vector<complex<double>> result;
+		double qrTime = MeasureSeconds([&]() { result = eigenvalues.GetEigenvalues(matrix, EIGEN_HESSENBERG_QR); });
+		double qrError = SpectrumDistance(result, spectrum);
+		double valuesTime = MeasureSeconds([&]() { result = eigenvalues.GetEigenvalues(matrix, EIGEN_HERMITIAN); });
+		double valuesError = SpectrumDistance(result, spectrum);
+
+		vector<double> realEigenvalues;
+		double vectorsTime = MeasureSeconds([&]() { realEigenvalues = eigenvalues.GetHermitianEigenvalues(matrix, &vectors); });
+		QSMatrix<complex<double>> product = matrix * vectors;
+		double residual = 0;
+		for (unsigned i = 0; i < size; i++) {
+			for (unsigned j = 0; j < size; j++) {
+				residual = max(residual, abs(product(i, j) - realEigenvalues[j] * vectors(i, j)));
+			}
+		}
+		printf("%6u %14.3f %12.3e %14.3f %12.3e %14.3f %12.3e\n", size, qrTime * 1e3, qrError, valuesTime * 1e3, valuesError, vectorsTime * 1e3, residual);
+	}
+
+	ThreadPool &pool = ThreadPool::Instance();
+	unsigned initialThreads = pool.ThreadCount();
+	unsigned maxThreads = thread::hardware_concurrency();
+	if (maxThreads == 0)
+		maxThreads = 1;
+
+	printf("Thread scaling, Hermitian %ux%u\n", matrix.get_rows(), matrix.get_rows());
+	printf("%8s %14s %10s %14s %10s\n", "threads", "values, ms", "speedup", "vectors, ms", "speedup");
+	double valuesBase = 0, vectorsBase = 0;
+	for (unsigned threads = 1; threads <= maxThreads; threads++) {
+		pool.SetThreadCount(threads);
+		double valuesTime = MeasureSeconds([&]() { eigenvalues.GetHermitianEigenvalues(matrix); });
+		double vectorsTime = MeasureSeconds([&]() { eigenvalues.GetHermitianEigenvalues(matrix, &vectors); });
+		if (threads == 1) {
+			valuesBase = valuesTime;
+			vectorsBase = vectorsTime;
+		}
+		printf("%8u %14.3f %9.2fx %14.3f %9.2fx\n", threads, valuesTime * 1e3, valuesBase / valuesTime, vectorsTime * 1e3, vectorsBase / vectorsTime);
+	}
+
+	pool.SetThreadCount(initialThreads);
+}
+
+/*
+*    : max |P(z)| / sum |a_k| |z|^k.
+*  |z| > 1      1 / z
+*/
+inline double RootsBackwardError(const vector<complex<double>> &coefficients, const vector<complex<double>> &roots)
+{
+	size_t degree = coefficients.size() - 1;
+	double error = 0;
+	for (size_t i = 0; i < roots.size(); i++) {
+		bool inside = abs(roots[i]) <= 1;
+		complex<double> point = inside ? roots[i] : 1.0 / roots[i];
+		complex<double> value = 0;
+		double bound = 0;
+		for (size_t k = 0; k <= degree; k++) {
+			complex<double> coefficient = inside ? coefficients[degree - k] : coefficients[k];
+			value = value * point + coefficient;
+			bound = bound * abs(point) + abs(coefficient);
+		}
+		error = max(error, abs(value) / bound);
+	}
+	return error;
+}
+
+/*
+*      :  
+*       -
+* @param int deflationMaxDegree -    ,    
+* @param uint64_t seed -     ,   
+*    
+*/
+inline void PolynomialRootsBenchmark(int deflationMaxDegree = 64, uint64_t seed = 1)
+{
+	srand((unsigned)seed);
+	RandomSource::Seed(seed);
+	printf("Polynomial roots, complex<double>, seed %llu\n", (unsigned long long)seed);
+	printf("%6s %14s %12s %14s %12s\n", "degree", "deflation, ms", "error", "aberth, ms", "error");
+	for (int degree = 16; degree <= 4096; degree *= 2) {
+		QSMatrix<complex<double>> random(degree + 1, 1, 0.0);
+		FillRandom(random);
+		vector<complex<double>> coefficients(degree + 1);
+		for (int k = 0; k <= degree; k++) {
+			coefficients[k] = random(k, 0);
+		}
+		Polynomial<complex<double>> polynomial(coefficients);
+
+		vector<complex<double>> roots;
+		double aberthTime = MeasureSeconds([&]() { roots = polynomial.FindComplexRoots(ROOTS_ABERTH); });
+		double aberthError = RootsBackwardError(coefficients, roots);
+
+		if (degree <= deflationMaxDegree) {
+			double deflationTime = MeasureSeconds([&]() { roots = polynomial.FindComplexRoots(ROOTS_DEFLATION); });
+			double deflationError = RootsBackwardError(coefficients, roots);
+			printf("%6d %14.3f %12.3e %14.3f %12.3e\n", degree, deflationTime * 1e3, deflationError, aberthTime * 1e3, aberthError);
+		}
+		else {
+			printf("%6d %14s %12s %14.3f %12.3e\n", degree, "-", "-", aberthTime * 1e3, aberthError);
+		}
+	}
+}
+
+/*
+*     (x^distinct - w)^multiplicity: distinct
+*    ,   multiplicity.       
+*       eps^(1 / multiplicity),  
+*      (P, P').  - 
+*    
+* @param int distinct -   
+* @param uint64_t seed -   
+*/
+inline void MultipleRootsBenchmark(int distinct = 8, uint64_t seed = 1)
+{
+	RandomSource::Seed(seed);
+	const double pi = acos(-1.0);
+	printf("Polynomial roots with multiplicities, %d distinct roots on the unit circle\n", distinct);
+	printf("%12s %6s %14s %12s %16s %12s %10s\n", "multiplicity", "degree", "aberth, ms", "error", "square-free, ms", "error", "found");
+	for (int multiplicity = 1; multiplicity <= 8; multiplicity++) {
+		// P = (x^distinct - w)^multiplicity  :  
+		// x - r        1e-7
+		complex<double> w = polar(1.0, 2 * pi * 0.3);
+		vector<complex<double>> exact(distinct);
+		for (int j = 0; j < distinct; j++) {
+			exact[j] = polar(1.0, 2 * pi * (j + 0.3) / distinct);
+		}
+		vector<complex<double>> coefficients(distinct * multiplicity + 1, 0.0);
+		double binomial = 1;
+		for (int k = 0; k <= multiplicity; k++) {
+			coefficients[k * distinct] = binomial * pow(-w, multiplicity - k);
+			binomial = binomial * (multiplicity - k) / (k + 1);
+		}
+		Polynomial<complex<double>> polynomial(coefficients);
+
+		auto distance = [&](complex<double> root) {
+			double best = abs(root - exact[0]);
+			for (int j = 1; j < distinct; j++) {
+				best = min(best, abs(root - exact[j]));
+			}
+			return best;
+		};
+
+		vector<complex<double>> roots;
+		double aberthTime = MeasureSeconds([&]() { roots = polynomial.FindComplexRoots(ROOTS_ABERTH); });
+		double aberthError = 0;
+		for (size_t i = 0; i < roots.size(); i++) {
+			aberthError = max(aberthError, distance(roots[i]));
+		}
+
+		vector<pair<int, complex<double>>> rootsWithDegrees;
+		double squareFreeTime = MeasureSeconds([&]() { rootsWithDegrees = polynomial.FindComplexRootsWithDegrees(); });
+		double squareFreeError = 0;
+		for (size_t i = 0; i < rootsWithDegrees.size(); i++) {
+			squareFreeError = max(squareFreeError, distance(rootsWithDegrees[i].second));
+		}
+
+		printf("%12d %6d %14.3f %12.3e %16.3f %12.3e %10zu\n", multiplicity, polynomial.Degree(), aberthTime * 1e3, aberthError, squareFreeTime * 1e3, squareFreeError, rootsWithDegrees.size());
+	}
+}
+
+/*
+*      :     pow
+*        SIMD,    
+* @param int degree -  
+* @param int count -  
+*/
+inline void PolynomialEvaluationBenchmark(int degree = 64, int count = 1 << 20)
+{
+	QSMatrix<complex<double>> random(degree + 1 + count, 1, 0.0);
+	FillRandom(random);
+	vector<complex<double>> coefficients(degree + 1);
+	vector<complex<double>> points(count);
+	for (int k = 0; k <= degree; k++) {
+		coefficients[k] = random(k, 0);
+	}
+	for (int i = 0; i < count; i++) {
+		points[i] = random(degree + 1 + i, 0);
+	}
+	Polynomial<complex<double>> polynomial(coefficients);
+	vector<complex<double>> values(count);
+	vector<complex<double>> derivatives;
+
+	printf("Polynomial evaluation, complex<double>, degree %d, %d points\n", degree, count);
+	printf("%10s %16s %16s\n", "kernel", "values, Mpt/s", "+ P', Mpt/s");
+
+	double powTime = MeasureSeconds([&]() {
+		for (int i = 0; i < count; i++) {
+			complex<double> result = 0;
+			for (int k = 0; k <= degree; k++) {
+				result += coefficients[k] * pow(points[i], k);
+			}
+			values[i] = result;
+		}
+	});
+	printf("%10s %16.2f %16s\n", "pow", count / powTime * 1e-6, "-");
+
+	SimdLevel initial = ComplexKernels::Level();
+	for (int level = SIMD_SCALAR; level <= ComplexKernels::DetectLevel(); level++) {
+		ComplexKernels::Select((SimdLevel)level);
+		double valuesTime = MeasureSeconds([&]() { values = polynomial.Evaluate(points); });
+		double derivativesTime = MeasureSeconds([&]() { values = polynomial.Evaluate(points, &derivatives); });
+		printf("%10s %16.2f %16.2f\n", ComplexKernels::LevelName((SimdLevel)level), count / valuesTime * 1e-6, count / derivativesTime * 1e-6);
+	}
+	ComplexKernels::Select(initial);
+}
+
+/*
+*     8  2^20   
+* :  , ,     
+*  .   -   
+* @param size_t schoolbookMaxDegree -     
+* @param size_t karatsubaMaxDegree -    
+*/
+inline void PolynomialMultiplyBenchmark(size_t schoolbookMaxDegree = 1 << 13, size_t karatsubaMaxDegree = 1 << 16)
+{
+	const PolynomialMultiplySettings &settings = PolynomialMultiplySettings::Instance();
+	printf("Polynomial multiplication, complex<double>\n");
+	printf("%8s %14s %14s %14s %14s %12s\n", "degree", "school, ms", "karatsuba, ms", "fft, ms", "fft sqr, ms", "fft error");
+	for (size_t degree = 8; degree <= (1 << 20); degree *= 2) {
+		QSMatrix<complex<double>> random(2 * (degree + 1), 1, 0.0);
+		FillRandom(random);
+		vector<complex<double>> a(degree + 1);
+		vector<complex<double>> b(degree + 1);
+		for (size_t k = 0; k <= degree; k++) {
+			a[k] = random(k, 0);
+			b[k] = random(degree + 1 + k, 0);
+		}
+
+		vector<complex<double>> product;
+		double fftTime = MeasureSeconds([&]() { product = multiply_fft(a, b); });
+		double squareTime = MeasureSeconds([&]() { square_fft(a); });
+
+		char schoolbook[32] = "-";
+		if (degree <= schoolbookMaxDegree) {
+			double time = MeasureSeconds([&]() { convolve<complex<double>>(a, b, 2 * degree + 1); });
+			snprintf(schoolbook, sizeof(schoolbook), "%.3f", time * 1e3);
+		}
+
+		char karatsuba[32] = "-";
+		char error[32] = "-";
+		if (degree <= karatsubaMaxDegree) {
+			vector<complex<double>> reference(2 * degree + 1);
+			double time = MeasureSeconds([&]() {
+				fill(reference.begin(), reference.end(), complex<double>());
+				karatsuba_multiply_add(a.data(), a.size(), b.data(), b.size(), reference.data(), settings.karatsubaThreshold);
+			});
+			snprintf(karatsuba, sizeof(karatsuba), "%.3f", time * 1e3);
+
+			double difference = 0, scale = 0;
+			for (size_t k = 0; k < reference.size(); k++) {
+				difference = max(difference, abs(product[k] - reference[k]));
+				scale = max(scale, abs(reference[k]));
+			}
+			snprintf(error, sizeof(error), "%.3e", difference / scale);
+		}
+
+		printf("%8zu %14s %14s %14.3f %14.3f %12s\n", degree, schoolbook, karatsuba, fftTime * 1e3, squareTime * 1e3, error);
+	}
+}
+
+/*
+*   P(x) -> P(x + a)   8  2^16  
+*  :       
+*  (   ).  -  
+*  :    ,   
+*  1e-6   
+* @param size_t hornerMaxDegree -     
+*/
+inline void TaylorShiftBenchmark(size_t hornerMaxDegree = 1 << 14)
+{
+	TaylorShiftSettings &settings = TaylorShiftSettings::Instance();
+	const bool initial = settings.divide;
+	settings.divide = true;
+	const complex<double> shift(0.1, -0.15);
+	printf("Taylor shift, complex<double>, a = (%.2f, %.2f), divide threshold %zu\n", shift.real(), shift.imag(), settings.divideThreshold);
+	printf("%8s %14s %14s %12s %8s\n", "degree", "horner, ms", "divide, ms", "error", "wrong");
+	for (size_t degree = 8; degree <= (1 << 16); degree *= 2) {
+		QSMatrix<complex<double>> random(degree + 1, 1, 0.0);
+		FillRandom(random);
+		vector<complex<double>> coefficients(degree + 1);
+		for (size_t k = 0; k <= degree; k++) {
+			coefficients[k] = random(k, 0);
+		}
+
+		vector<complex<double>> shifted;
+		double divideTime = MeasureSeconds([&]() {
+			shifted = coefficients;
+			taylor_shift(shifted, shift);
+		});
+
+		char horner[32] = "-";
+		char error[32] = "-";
+		char wrong[32] = "-";
+		if (degree <= hornerMaxDegree) {
+			vector<complex<double>> reference;
+			double time = MeasureSeconds([&]() {
+				reference = coefficients;
+				taylor_shift_horner(reference.data(), reference.size(), shift);
+			});
+			snprintf(horner, sizeof(horner), "%.3f", time * 1e3);
+
+			double difference = 0, scale = 0;
+			size_t count = 0;
+			for (size_t k = 0; k < reference.size(); k++) {
+				difference = max(difference, abs(shifted[k] - reference[k]));
+				scale = max(scale, abs(reference[k]));
+				if (!(abs(shifted[k] - reference[k]) <= 1e-6 * abs(reference[k])))
+					count++;
+			}
+			//     P(x + a)    double
+			if (isfinite(scale)) {
+				snprintf(error, sizeof(error), "%.3e", difference / scale);
+				snprintf(wrong, sizeof(wrong), "%zu", count);
+			}
+			else {
+				snprintf(error, sizeof(error), "overflow");
+			}
+		}
+
+		printf("%8zu %14s %14.3f %12s %8s\n", degree, horner, divideTime * 1e3, error, wrong);
+	}
+	settings.divide = initial;
+}
+
+/*
+*    n = 8 .. 2^18  64-   
+*    ( -   ): , , -3,
+* NTT,        .  
+* BigIntMultiplySettings  ,    
+* 
+* @param size_t schoolbookMaxLimbs -     
+* @param size_t karatsubaMaxLimbs -      -3
+*/
+inline void BigIntMultiplyBenchmark(size_t schoolbookMaxLimbs = 1 << 12, size_t karatsubaMaxLimbs = 1 << 16)
+{
+	const BigIntMultiplySettings &settings = BigIntMultiplySettings::Instance();
+	printf("BigInt multiplication, thresholds: karatsuba %zu, toom-3 %zu, ntt %zu limbs\n",
+		settings.karatsubaThreshold, settings.toomThreshold, settings.nttThreshold);
+	printf("%8s %12s %12s %12s %12s %12s %12s %8s\n", "limbs", "school, ms", "karatsuba", "toom-3", "ntt", "auto", "square", "equal");
+	Xoshiro256 &random = RandomSource::Engine();
+	for (size_t n = 8; n <= (1 << 18); n *= 2) {
+		vector<uint64_t> a(n), b(n);
+		for (size_t i = 0; i < n; i++) {
+			a[i] = random();
+			b[i] = random();
+		}
+
+		vector<uint64_t> product(2 * n), reference(2 * n), square(2 * n);
+		double autoTime = MeasureSeconds([&]() { limbs_mul(product.data(), a.data(), n, b.data(), n); });
+		double squareTime = MeasureSeconds([&]() { limbs_mul(square.data(), a.data(), n, a.data(), n); });
+		double nttTime = MeasureSeconds([&]() { limbs_mul_ntt(reference.data(), a.data(), n, b.data(), n); });
+		bool equal = reference == product;
+		limbs_mul_ntt(reference.data(), a.data(), n, a.data(), n);
+		equal = equal && reference == square;
+
+		char schoolbook[32] = "-";
+		if (n <= schoolbookMaxLimbs) {
+			double time = MeasureSeconds([&]() { limbs_mul_schoolbook(reference.data(), a.data(), n, b.data(), n); });
+			snprintf(schoolbook, sizeof(schoolbook), "%.4f", time * 1e3);
+		}
+
+		char karatsuba[32] = "-";
+		char toom[32] = "-";
+		if (n <= karatsubaMaxLimbs) {
+			double time = MeasureSeconds([&]() { limbs_mul_karatsuba(reference.data(), a.data(), n, b.data(), n); });
+			snprintf(karatsuba, sizeof(karatsuba), "%.4f", time * 1e3);
+			time = MeasureSeconds([&]() { limbs_mul_toom3(reference.data(), a.data(), n, b.data(), n); });
+			snprintf(toom, sizeof(toom), "%.4f", time * 1e3);
+		}
+
+		printf("%8zu %12s %12s %12s %12.4f %12.4f %12.4f %8s\n", n, schoolbook, karatsuba, toom, nttTime * 1e3, autoTime * 1e3, squareTime * 1e3, equal ? "yes" : "NO");
+	}
+}
+
+/*
+*  BigInt  n = 4 .. maxLimbs      
+* :      10^(19 2^k) 
+*   ( BigIntDecimalSettings   
+* ).    LongPlusPlus     
+* to_string
+* @param size_t maxLimbs -   
+* @param size_t quadraticMaxLimbs -     
+*/
+inline void DecimalConversionBenchmark(size_t maxLimbs = 1 << 16, size_t quadraticMaxLimbs = 1 << 12)
+{
+	BigIntDecimalSettings &settings = BigIntDecimalSettings::Instance();
+	const BigIntDecimalSettings tuned = settings;
+	printf("BigInt decimal conversion, thresholds: format %zu limbs, parse %zu chunks\n", tuned.formatThreshold, tuned.parseThreshold);
+	printf("%8s %10s %14s %14s %14s %14s %8s\n", "limbs", "digits", "format, ms", "quadratic", "parse, ms", "quadratic", "equal");
+	Xoshiro256 &random = RandomSource::Engine();
+	for (size_t n = 4; n <= maxLimbs; n *= 2) {
+		string digits(n * DECIMAL_CHUNK_DIGITS, '0');
+		for (size_t i = 0; i < digits.size(); i++) {
+			digits[i] = (char)('0' + random() % 10);
+		}
+		digits[0] = '1';
+
+		BigInt value;
+		double parseTime = MeasureSeconds([&]() { value = BigInt(digits); });
+		// The first conversion of a size builds the reciprocals of the powers
+		string text = value.to_string();
+		double formatTime = MeasureSeconds([&]() { text = value.to_string(); });
+		bool equal = text == digits;
+
+		char quadraticFormat[32] = "-";
+		char quadraticParse[32] = "-";
+		if (n <= quadraticMaxLimbs) {
+			settings.formatThreshold = settings.parseThreshold = (size_t)-1;
+			BigInt slowValue;
+			double time = MeasureSeconds([&]() { slowValue = BigInt(digits); });
+			snprintf(quadraticParse, sizeof(quadraticParse), "%.4f", time * 1e3);
+			string slowText;
+			time = MeasureSeconds([&]() { slowText = value.to_string(); });
+			snprintf(quadraticFormat, sizeof(quadraticFormat), "%.4f", time * 1e3);
+			equal = equal && slowValue == value && slowText == digits;
+			settings = tuned;
+		}
+
+		printf("%8zu %10zu %14.4f %14s %14.4f %14s %8s\n", n, digits.size(), formatTime * 1e3, quadraticFormat, parseTime * 1e3, quadraticParse, equal ? "yes" : "NO");
+	}
+
+	const size_t count = 1000000;
+	vector<LongPlusPlus> values(count);
+	for (size_t i = 0; i < count; i++) {
+		values[i] = LongPlusPlus(random() % LongPlusPlus::e8, random() % LongPlusPlus::e8, random() % 1000000);
+	}
+	vector<char> buffer(count * LongPlusPlus::MAX_DECIMAL_LENGTH);
+	size_t written = 0;
+	double bufferTime = MeasureSeconds([&]() {
+		written = 0;
+		for (size_t i = 0; i < count; i++) {
+			written += values[i].write_decimal(buffer.data() + written);
+		}
+	});
+	size_t stringLength = 0;
+	double stringTime = MeasureSeconds([&]() {
+		stringLength = 0;
+		for (size_t i = 0; i < count; i++) {
+			stringLength += values[i].to_string().size();
+		}
+	});
+	printf("%zu LongPlusPlus values, %zu chars: write_decimal %.2f ms, to_string %.2f ms\n", count, written, bufferTime * 1e3, stringTime * 1e3);
+}
+
+/*
+* F(n)  F(n + 1) : F(2k) = F(k) (2 F(k + 1) - F(k)),
+* F(2k + 1) = F(k)^2 + F(k + 1)^2
+* @param unsigned n -   
+*/
+inline pair<BigInt, BigInt> FibonacciPair(unsigned n)
+{
+	BigInt current = 0;
+	BigInt next = 1;
+	for (int bit = 31; bit >= 0; bit--) {
+		BigInt doubled = current * (next + next - current);
+		BigInt doubledNext = current * current + next * next;
+		if ((n >> bit) & 1) {
+			current = doubledNext;
+			next = doubled + doubledNext;
+		}
+		else {
+			current = doubled;
+			next = doubledNext;
+		}
+	}
+	return make_pair(current, next);
+}
+
+/*
+*  BigInt  2n    n , n = 4 .. 2^17: 
+*          (
+* BigIntDivideSettings    ),   
+*  n x n.     F(maxIndex)  
+*  
+* @param size_t schoolbookMaxLimbs -    
+*  
+* @param unsigned maxIndex -   
+*/
+inline void BigIntDivideBenchmark(size_t schoolbookMaxLimbs = 1 << 13, unsigned maxIndex = 1000000)
+{
+	BigIntDivideSettings &settings = BigIntDivideSettings::Instance();
+	const BigIntDivideSettings tuned = settings;
+	printf("BigInt division 2n / n limbs, thresholds: newton %zu, barrett %zu limbs\n", tuned.newtonThreshold, tuned.barrettThreshold);
+	printf("%8s %14s %14s %14s %14s %8s\n", "n", "school, ms", "barrett, ms", "auto, ms", "multiply, ms", "equal");
+	Xoshiro256 &random = RandomSource::Engine();
+	for (size_t n = 4; n <= (1 << 17); n *= 2) {
+		vector<uint64_t> a(2 * n), d(n);
+		for (size_t i = 0; i < 2 * n; i++) {
+			a[i] = random();
+		}
+		for (size_t i = 0; i < n; i++) {
+			d[i] = random();
+		}
+
+		vector<uint64_t> quotient(n + 1), remainder(n), product(2 * n);
+		vector<uint64_t> referenceQuotient(n + 1), referenceRemainder(n);
+		double autoTime = MeasureSeconds([&]() { limbs_divmod(quotient.data(), remainder.data(), a.data(), 2 * n, d.data(), n); });
+		settings.barrettThreshold = 2;
+		double barrettTime = MeasureSeconds([&]() { limbs_divmod(referenceQuotient.data(), referenceRemainder.data(), a.data(), 2 * n, d.data(), n); });
+		settings = tuned;
+		bool equal = quotient == referenceQuotient && remainder == referenceRemainder;
+		double multiplyTime = MeasureSeconds([&]() { limbs_mul(product.data(), a.data(), n, d.data(), n); });
+
+		char schoolbook[32] = "-";
+		if (n <= schoolbookMaxLimbs) {
+			double time = MeasureSeconds([&]() { limbs_divmod_schoolbook(referenceQuotient.data(), referenceRemainder.data(), a.data(), 2 * n, d.data(), n); });
+			equal = equal && quotient == referenceQuotient && remainder == referenceRemainder;
+			snprintf(schoolbook, sizeof(schoolbook), "%.4f", time * 1e3);
+		}
+		printf("%8zu %14s %14.4f %14.4f %14.4f %8s\n", n, schoolbook, barrettTime * 1e3, autoTime * 1e3, multiplyTime * 1e3, equal ? "yes" : "NO");
+	}
+
+	BigInt fibonacci = FibonacciPair(maxIndex).first;
+	const BigInt modulus = 1000000007;
+	BigInt residue;
+	double residueTime = MeasureSeconds([&]() { residue = fibonacci % modulus; });
+	printf("F(%u) of %zu limbs mod %s = %s: %.3f ms\n", maxIndex, fibonacci.limb_count(), modulus.to_string().c_str(),
+		residue.to_string().c_str(), residueTime * 1e3);
+}
+
+/*
+*   F(n)  n  100  maxIndex  BigInt:  
+*   2x2. LongPlusPlus    F(140)
+* @param unsigned maxIndex -  
+*/
+inline void BigIntFibonacciBenchmark(unsigned maxIndex = 1000000)
+{
+	typedef FixedMatrix<BigInt, 2, 2> Matrix2x2;
+	printf("Fibonacci numbers on BigInt\n");
+	printf("%10s %10s %14s %14s %8s\n", "n", "bits", "doubling, ms", "matrix, ms", "equal");
+	for (unsigned n = 100; n <= maxIndex; n *= 10) {
+		BigInt doubling;
+		double doublingTime = MeasureSeconds([&]() { doubling = FibonacciPair(n).first; });
+		BigInt matrix;
+		double matrixTime = MeasureSeconds([&]() { matrix = pow(Matrix2x2(1, 1, 1, 0), n)(0, 1); });
+
+		size_t bits = 0;
+		if (!doubling.is_zero()) {
+			uint64_t top = doubling.limbs()[doubling.limb_count() - 1];
+			bits = 64 * (doubling.limb_count() - 1);
+			for (; top != 0; top >>= 1) {
+				bits++;
+			}
+		}
+		printf("%10u %10zu %14.3f %14.3f %8s\n", n, bits, doublingTime * 1e3, matrixTime * 1e3, doubling == matrix ? "yes" : "NO");
+	}
+}
+
+/*
+*    WideUInt  BigInt   :
+*   count   64-  ( 
+* ), 128-  FNV-1a  count   
+*  size x size    1000 (LongPlusPlus 
+* )
+* @param unsigned count -    
+* @param unsigned size -  
+*/
+inline void WideUIntBenchmark(unsigned count = 1 << 20, unsigned size = 64)
+{
+	Xoshiro256 &random = RandomSource::Engine();
+	vector<uint64_t> a(count), b(count);
+	for (unsigned i = 0; i < count; i++) {
+		a[i] = random();
+		b[i] = random();
+	}
+
+	printf("Sum of %u products of 64-bit words\n", count);
+	printf("%-16s %12s %s\n", "type", "ns / term", "sum");
+	uint64_t wordSum = 0;
+	double wordTime = MeasureSeconds([&]() {
+		wordSum = 0;
+		for (unsigned i = 0; i < count; i++) {
+			wordSum += a[i] * b[i];
+		}
+	});
+	printf("%-16s %12.3f %llu (mod 2^64)\n", "uint64_t", wordTime * 1e9 / count, (unsigned long long)wordSum);
+	UInt128 sum128;
+	double time128 = MeasureSeconds([&]() {
+		sum128 = 0;
+		for (unsigned i = 0; i < count; i++) {
+			sum128 += UInt128(a[i]) * UInt128(b[i]);
+		}
+	});
+	printf("%-16s %12.3f %s (mod 2^128)\n", "UInt128", time128 * 1e9 / count, sum128.to_string().c_str());
+	UInt256 sum256;
+	double time256 = MeasureSeconds([&]() {
+		sum256 = 0;
+		for (unsigned i = 0; i < count; i++) {
+			sum256 += UInt256(a[i]) * UInt256(b[i]);
+		}
+	});
+	printf("%-16s %12.3f %s\n", "UInt256", time256 * 1e9 / count, sum256.to_string().c_str());
+	BigInt bigSum;
+	double bigTime = MeasureSeconds([&]() {
+		bigSum = 0;
+		for (unsigned i = 0; i < count; i++) {
+			bigSum += BigInt(a[i]) * BigInt(b[i]);
+		}
+	});
+	printf("%-16s %12.3f %s\n", "BigInt", bigTime * 1e9 / count, bigSum.to_string().c_str());
+
+	// FNV-1a: h = (h ^ byte) * prime, the constants of the 128-bit variant
+	// are parsed at compile time
+	constexpr UInt128 fnvOffset("144066263297769815596495629667062367629", 39);
+	constexpr UInt128 fnvPrime("309485009821345068724781371", 27);
+	const unsigned char *bytes = reinterpret_cast<const unsigned char *>(a.data());
+	uint64_t hash64 = 0;
+	double hash64Time = MeasureSeconds([&]() {
+		hash64 = 14695981039346656037ULL;
+		for (unsigned i = 0; i < count; i++) {
+			hash64 = (hash64 ^ bytes[i]) * 1099511628211ULL;
+		}
+	});
+	UInt128 hash128;
+	double hash128Time = MeasureSeconds([&]() {
+		hash128 = fnvOffset;
+		for (unsigned i = 0; i < count; i++) {
+			hash128 = (hash128 ^ UInt128(bytes[i])) * fnvPrime;
+		}
+	});
+	printf("FNV-1a of %u bytes: 64-bit %.3f ns / byte (%llu), UInt128 %.3f ns / byte (%s)\n", count,
+		hash64Time * 1e9 / count, (unsigned long long)hash64, hash128Time * 1e9 / count, hash128.to_string().c_str());
+
+	QSMatrix<UInt256> wide(size, size, UInt256());
+	QSMatrix<BigInt> big(size, size, BigInt());
+	QSMatrix<LongPlusPlus> decimal(size, size, LongPlusPlus());
+	for (unsigned i = 0; i < size; i++) {
+		for (unsigned j = 0; j < size; j++) {
+			unsigned value = (unsigned)(random() % 1000);
+			wide(i, j) = value;
+			big(i, j) = value;
+			decimal(i, j) = value;
+		}
+	}
+	QSMatrix<UInt256> wideProduct = wide * wide;
+	QSMatrix<BigInt> bigProduct = big * big;
+	QSMatrix<LongPlusPlus> decimalProduct = decimal * decimal;
+	double wideTime = MeasureSeconds([&]() { wideProduct = wide * wide; });
+	double bigMatrixTime = MeasureSeconds([&]() { bigProduct = big * big; });
+	double decimalTime = MeasureSeconds([&]() { decimalProduct = decimal * decimal; });
+	bool equal = true;
+	for (unsigned i = 0; i < size; i++) {
+		for (unsigned j = 0; j < size; j++) {
+			equal = equal && wideProduct(i, j).to_string() == bigProduct(i, j).to_string()
+				&& bigProduct(i, j).to_string() == to_string(decimalProduct(i, j));
+		}
+	}
+	printf("%ux%u matrix product: UInt256 %.3f ms, BigInt %.3f ms, LongPlusPlus %.3f ms, equal %s\n",
+		size, size, wideTime * 1e3, bigMatrixTime * 1e3, decimalTime * 1e3, equal ? "yes" : "NO");
+}
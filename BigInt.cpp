@@ -0,0 +1,330 @@
+#include "BigInt.h"
+#include <algorithm>
+#include <cassert>
+#include "BigIntDecimal.h"
+#include "BigIntDivide.h"
+#include "BigIntKernels.h"
+#include "BigIntMultiply.h"
+
+BigInt::BigInt() : data(local), length(0), capacity(INLINE_LIMBS), negative(false)
+{
+}
+
+BigInt::BigInt(const std::string& decimal) : BigInt(decimal.data(), decimal.size())
+{
+}
+
+BigInt::BigInt(const char* decimal, size_t length) : BigInt()
+{
+	size_t position = 0;
+	bool isNegative = false;
+	if (position < length && (decimal[position] == '-' || decimal[position] == '+')) {
+		isNegative = decimal[position] == '-';
+		position++;
+	}
+	assert(position < length && "no digits");
+
+	size_t digits = length - position;
+	reserve(decimal_limbs_bound(digits));
+	size_t count = decimal_to_limbs(data, decimal + position, digits);
+	negative = isNegative;
+	set_length(count);
+}
+
+BigInt::BigInt(const LongPlus& value) : BigInt()
+{
+	*this = BigInt(value.high) * BigInt(LongPlus::e15) + BigInt(value.low);
+}
+
+BigInt::BigInt(const LongPlusPlus& value) : BigInt()
+{
+	BigInt base(LongPlusPlus::e8);
+	*this = (BigInt(value.high) * base + BigInt(value.medium)) * base + BigInt(value.low);
+}
+
+BigInt::BigInt(const BigInt& other) : BigInt()
+{
+	*this = other;
+}
+
+BigInt::BigInt(BigInt&& other) noexcept : BigInt()
+{
+	*this = std::move(other);
+}
+
+BigInt& BigInt::operator=(const BigInt& other)
+{
+	if (this == &other)
+		return *this;
+	reserve(other.length);
+	std::copy(other.data, other.data + other.length, data);
+	length = other.length;
+	negative = other.negative;
+	return *this;
+}
+
+BigInt& BigInt::operator=(BigInt&& other) noexcept
+{
+	if (this == &other)
+		return *this;
+	if (other.data == other.local) {
+		// Inline limbs are copied, the heap buffer of this (if any) stays
+		std::copy(other.local, other.local + other.length, data);
+	}
+	else {
+		if (data != local)
+			delete[] data;
+		data = other.data;
+		capacity = other.capacity;
+		other.data = other.local;
+		other.capacity = INLINE_LIMBS;
+	}
+	length = other.length;
+	negative = other.negative;
+	other.length = 0;
+	other.negative = false;
+	return *this;
+}
+
+BigInt::~BigInt()
+{
+	if (data != local)
+		delete[] data;
+}
+
+void BigInt::reserve(size_t count)
+{
+	if (count <= capacity)
+		return;
+	size_t newCapacity = std::max(count, (size_t)capacity * 2);
+	uint64_t* newData = new uint64_t[newCapacity];
+	std::copy(data, data + length, newData);
+	if (data != local)
+		delete[] data;
+	data = newData;
+	capacity = (uint32_t)newCapacity;
+}
+
+void BigInt::set_length(size_t count)
+{
+	while (count > 0 && data[count - 1] == 0) {
+		count--;
+	}
+	length = (uint32_t)count;
+	if (length == 0)
+		negative = false;
+}
+
+void BigInt::assign_limb(uint64_t magnitude, bool isNegative)
+{
+	data[0] = magnitude;
+	negative = isNegative;
+	set_length(1);
+}
+
+void BigInt::add(BigInt& result, const BigInt& a, const BigInt& b, bool subtract)
+{
+	bool bNegative = b.negative != subtract;
+	bool sameSign = a.negative == bNegative;
+	int order = sameSign ? 0 : limbs_compare(a.data, a.length, b.data, b.length);
+	// |larger| +- |smaller|, the sign is that of the larger magnitude
+	bool aLarger = sameSign ? a.length >= b.length : order > 0;
+	const BigInt& larger = aLarger ? a : b;
+	const BigInt& smaller = aLarger ? b : a;
+	bool resultNegative = aLarger ? a.negative : bNegative;
+	size_t largerLength = larger.length;
+	size_t smallerLength = smaller.length;
+
+	if (!sameSign && order == 0) {
+		result.length = 0;
+		result.negative = false;
+		return;
+	}
+
+	// reserve may move the limbs of result, and so of a or b aliasing it
+	result.reserve(largerLength + 1);
+	if (sameSign) {
+		result.data[largerLength] = limbs_add(result.data, larger.data, largerLength, smaller.data, smallerLength);
+		result.negative = resultNegative;
+		result.set_length(largerLength + 1);
+	}
+	else {
+		limbs_sub(result.data, larger.data, largerLength, smaller.data, smallerLength);
+		result.negative = resultNegative;
+		result.set_length(largerLength);
+	}
+}
+
+void BigInt::multiply(BigInt& result, const BigInt& a, const BigInt& b)
+{
+	if (a.length == 0 || b.length == 0) {
+		result.length = 0;
+		result.negative = false;
+		return;
+	}
+
+	// The product is built apart from the operands, result may be one of them.
+	// a * a passes the same limbs twice, which limbs_mul takes for a square
+	BigInt product;
+	size_t count = (size_t)a.length + b.length;
+	product.reserve(count);
+	limbs_mul(product.data, a.data, a.length, b.data, b.length);
+	product.negative = a.negative != b.negative;
+	product.set_length(count);
+	result = std::move(product);
+}
+
+void BigInt::divide(BigInt* quotient, BigInt* remainder, const BigInt& a, const BigInt& b)
+{
+	assert(b.length != 0 && "division by zero");
+	bool quotientNegative = a.negative != b.negative;
+	bool remainderNegative = a.negative;
+	if (limbs_compare(a.data, a.length, b.data, b.length) < 0) {
+		if (remainder != nullptr)
+			*remainder = a;
+		if (quotient != nullptr)
+			*quotient = BigInt();
+		return;
+	}
+
+	if (b.length == 1 && quotient == nullptr) {
+		// One limb and no quotient: the remainder alone, nothing allocated
+		remainder->assign_limb(limbs_mod_1(a.data, a.length, b.data[0]), remainderNegative);
+		return;
+	}
+
+	// Both are built apart from the operands, which they may replace
+	BigInt q, r;
+	size_t count = (size_t)a.length - b.length + 1;
+	q.reserve(count);
+	r.reserve(b.length);
+	limbs_divmod(q.data, r.data, a.data, a.length, b.data, b.length);
+	q.negative = quotientNegative;
+	q.set_length(count);
+	r.negative = remainderNegative;
+	r.set_length(b.length);
+	if (quotient != nullptr)
+		*quotient = std::move(q);
+	if (remainder != nullptr)
+		*remainder = std::move(r);
+}
+
+int BigInt::compare(const BigInt& a, const BigInt& b)
+{
+	if (a.negative != b.negative)
+		return a.negative ? -1 : 1;
+	int order = limbs_compare(a.data, a.length, b.data, b.length);
+	return a.negative ? -order : order;
+}
+
+BigInt BigInt::operator-() const
+{
+	BigInt result(*this);
+	if (result.length != 0)
+		result.negative = !result.negative;
+	return result;
+}
+
+BigInt BigInt::operator+(const BigInt& other) const
+{
+	BigInt result;
+	add(result, *this, other, false);
+	return result;
+}
+
+BigInt BigInt::operator-(const BigInt& other) const
+{
+	BigInt result;
+	add(result, *this, other, true);
+	return result;
+}
+
+BigInt BigInt::operator*(const BigInt& other) const
+{
+	BigInt result;
+	multiply(result, *this, other);
+	return result;
+}
+
+BigInt& BigInt::operator+=(const BigInt& other)
+{
+	add(*this, *this, other, false);
+	return *this;
+}
+
+BigInt& BigInt::operator-=(const BigInt& other)
+{
+	add(*this, *this, other, true);
+	return *this;
+}
+
+BigInt& BigInt::operator*=(const BigInt& other)
+{
+	multiply(*this, *this, other);
+	return *this;
+}
+
+BigInt BigInt::operator/(const BigInt& other) const
+{
+	BigInt result;
+	divide(&result, nullptr, *this, other);
+	return result;
+}
+
+BigInt BigInt::operator%(const BigInt& other) const
+{
+	BigInt result;
+	divide(nullptr, &result, *this, other);
+	return result;
+}
+
+BigInt& BigInt::operator/=(const BigInt& other)
+{
+	divide(this, nullptr, *this, other);
+	return *this;
+}
+
+BigInt& BigInt::operator%=(const BigInt& other)
+{
+	divide(nullptr, this, *this, other);
+	return *this;
+}
+
+std::pair<BigInt, BigInt> divmod(const BigInt& a, const BigInt& b)
+{
+	std::pair<BigInt, BigInt> result;
+	BigInt::divide(&result.first, &result.second, a, b);
+	return result;
+}
+
+bool BigInt::operator==(const BigInt& other) const { return compare(*this, other) == 0; }
+bool BigInt::operator!=(const BigInt& other) const { return compare(*this, other) != 0; }
+bool BigInt::operator<(const BigInt& other) const { return compare(*this, other) < 0; }
+bool BigInt::operator<=(const BigInt& other) const { return compare(*this, other) <= 0; }
+bool BigInt::operator>(const BigInt& other) const { return compare(*this, other) > 0; }
+bool BigInt::operator>=(const BigInt& other) const { return compare(*this, other) >= 0; }
+
+size_t BigInt::decimal_capacity() const
+{
+	return decimal_digits_bound(length) + 1;
+}
+
+size_t BigInt::write_decimal(char* buffer) const
+{
+	size_t written = 0;
+	if (negative)
+		buffer[written++] = '-';
+	return written + limbs_to_decimal(buffer + written, data, length);
+}
+
+std::string BigInt::to_string() const
+{
+	std::string result(decimal_capacity(), '\0');
+	result.resize(write_decimal(&result[0]));
+	return result;
+}
+
+std::string to_string(const BigInt& value)
+{
+	return value.to_string();
+}
@@ -0,0 +1,98 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include "Longplus.h"
+#include "LongPlusPlus.h"
+
+// Signed integer of any size: a sign and the magnitude in base 2^64 limbs,
+// least significant first, without leading zero limbs (zero has none).
+// Values of up to INLINE_LIMBS limbs are stored in the object itself, larger
+// ones on the heap.
+class BigInt
+{
+public:
+	static const unsigned INLINE_LIMBS = 4;
+
+	BigInt();
+
+	template <typename Integer, typename = typename std::enable_if<std::is_integral<Integer>::value>::type>
+	BigInt(Integer n) : BigInt()
+	{
+		static_assert(sizeof(Integer) <= sizeof(uint64_t), "integer wider than a limb");
+		bool isNegative = std::is_signed<Integer>::value && n < 0;
+		assign_limb(isNegative ? 0 - (uint64_t)n : (uint64_t)n, isNegative);
+	}
+
+	// Decimal digits with an optional leading '-' or '+'
+	explicit BigInt(const std::string& decimal);
+	BigInt(const char* decimal, size_t length);
+	explicit BigInt(const LongPlus& value);
+	explicit BigInt(const LongPlusPlus& value);
+
+	BigInt(const BigInt& other);
+	BigInt(BigInt&& other) noexcept;
+	BigInt& operator=(const BigInt& other);
+	BigInt& operator=(BigInt&& other) noexcept;
+	~BigInt();
+
+	bool is_zero() const { return length == 0; }
+	bool is_negative() const { return negative; }
+	// Limbs of the magnitude, least significant first
+	size_t limb_count() const { return length; }
+	const uint64_t* limbs() const { return data; }
+
+	BigInt operator-() const;
+	BigInt operator+(const BigInt& other) const;
+	BigInt operator-(const BigInt& other) const;
+	BigInt operator*(const BigInt& other) const;
+	BigInt& operator+=(const BigInt& other);
+	BigInt& operator-=(const BigInt& other);
+	BigInt& operator*=(const BigInt& other);
+	// Quotient rounded toward zero and remainder with the sign of the
+	// dividend, as for the built-in integers; the divisor must not be zero
+	BigInt operator/(const BigInt& other) const;
+	BigInt operator%(const BigInt& other) const;
+	BigInt& operator/=(const BigInt& other);
+	BigInt& operator%=(const BigInt& other);
+	// Quotient and remainder of one division
+	friend std::pair<BigInt, BigInt> divmod(const BigInt& a, const BigInt& b);
+
+	bool operator==(const BigInt& other) const;
+	bool operator!=(const BigInt& other) const;
+	bool operator<(const BigInt& other) const;
+	bool operator<=(const BigInt& other) const;
+	bool operator>(const BigInt& other) const;
+	bool operator>=(const BigInt& other) const;
+
+	// Most chars write_decimal can write
+	size_t decimal_capacity() const;
+	// Writes the decimal digits, with a '-' in front if negative, into buffer
+	// of decimal_capacity() chars or more; returns their number
+	size_t write_decimal(char* buffer) const;
+	std::string to_string() const;
+	friend std::string to_string(const BigInt& value);
+
+private:
+	uint64_t* data;
+	uint32_t length;
+	uint32_t capacity;
+	bool negative;
+	uint64_t local[INLINE_LIMBS];
+
+	// Room for count limbs, the current ones are kept
+	void reserve(size_t count);
+	// The first count limbs are the magnitude; leading zero limbs are
+	// dropped and zero is made non-negative
+	void set_length(size_t count);
+	void assign_limb(uint64_t magnitude, bool isNegative);
+
+	// result = a + b, or a - b when subtract is set. result may be a or b
+	static void add(BigInt& result, const BigInt& a, const BigInt& b, bool subtract);
+	static void multiply(BigInt& result, const BigInt& a, const BigInt& b);
+	// quotient = a / b and remainder = a % b, either may be null or be a or b
+	static void divide(BigInt* quotient, BigInt* remainder, const BigInt& a, const BigInt& b);
+	static int compare(const BigInt& a, const BigInt& b);
+};
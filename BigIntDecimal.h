@@ -0,0 +1,210 @@
+#pragma once
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <vector>
+#include "BigIntDivide.h"
+#include "BigIntKernels.h"
+#include "BigIntMultiply.h"
+#include "DecimalFormat.h"
+
+// Conversion of limb arrays to decimal digits and back. Short numbers take
+// the quadratic route of one 19-digit chunk per pass over the limbs. Long
+// ones are split at a cached power 10^(19 2^k) into two halves converted
+// on their own, which with fast multiplication and Barrett division costs
+// O(M(n) log n).
+
+// Largest power of ten in a limb and its exponent
+static const uint64_t DECIMAL_CHUNK = 10000000000000000000ULL;
+static const unsigned DECIMAL_CHUNK_DIGITS = 19;
+
+// Tunable parameters of decimal conversion, see DecimalConversionBenchmark
+struct BigIntDecimalSettings
+{
+	// Numbers below this many limbs are written by repeated division by 10^19
+	size_t formatThreshold;
+	// Strings below this many 19-digit chunks are read by repeated
+	// multiplication by 10^19
+	size_t parseThreshold;
+
+	static BigIntDecimalSettings& Instance()
+	{
+		static BigIntDecimalSettings settings = { 40, 384 };
+		return settings;
+	}
+};
+
+// 10^digits for digits = 19 2^k and, once a division needs it, its
+// reciprocal
+struct DecimalPower
+{
+	std::vector<uint64_t> value;
+	std::vector<uint64_t> reciprocal;
+	size_t digits;
+};
+
+// The powers are cached per thread, so conversions on several threads need
+// no lock. References stay valid as the cache grows
+inline const DecimalPower& decimal_power(size_t k, bool withReciprocal)
+{
+	static thread_local std::deque<DecimalPower> powers;
+	while (powers.size() <= k) {
+		DecimalPower power;
+		if (powers.empty()) {
+			power.value.assign(1, DECIMAL_CHUNK);
+			power.digits = DECIMAL_CHUNK_DIGITS;
+		}
+		else {
+			const DecimalPower& previous = powers.back();
+			size_t n = previous.value.size();
+			power.value.resize(2 * n);
+			limbs_mul(power.value.data(), previous.value.data(), n, previous.value.data(), n);
+			power.value.resize(limbs_normalized_length(power.value.data(), 2 * n));
+			power.digits = 2 * previous.digits;
+		}
+		powers.push_back(std::move(power));
+	}
+
+	DecimalPower& power = powers[k];
+	if (withReciprocal && power.reciprocal.empty()) {
+		size_t m = power.value.size();
+		power.reciprocal.resize(m + 1);
+		limbs_reciprocal(power.reciprocal.data(), power.value.data(), m);
+	}
+	return power;
+}
+
+// Most decimal digits of n limbs: log10(2) < 1234 / 4096
+inline size_t decimal_digits_bound(size_t n)
+{
+	return ((n * 64 * 1234) >> 12) + 1;
+}
+
+// Most limbs of count decimal digits: 10^19 < 2^64
+inline size_t decimal_limbs_bound(size_t count)
+{
+	return count / DECIMAL_CHUNK_DIGITS + 1;
+}
+
+// Writes a[0 .. n) as exactly width digits, zero-padded, or without leading
+// zeros (nothing for zero) when width is 0; returns the number written
+inline size_t limbs_to_decimal_width(char* buffer, const uint64_t* a, size_t n, size_t width)
+{
+	n = limbs_normalized_length(a, n);
+	if (n < std::max<size_t>(2, BigIntDecimalSettings::Instance().formatThreshold)) {
+		// 19-digit chunks from the bottom
+		uint64_t magnitude[64];
+		std::vector<uint64_t> heapMagnitude;
+		uint64_t* rest = magnitude;
+		if (n > 64) {
+			heapMagnitude.assign(a, a + n);
+			rest = heapMagnitude.data();
+		}
+		else {
+			std::copy(a, a + n, magnitude);
+		}
+		std::vector<uint64_t> chunks;
+		chunks.reserve(n * 64 / 63 + 1);
+		while (n > 0) {
+			chunks.push_back(limbs_divmod_1(rest, rest, n, DECIMAL_CHUNK));
+			n = limbs_normalized_length(rest, n);
+		}
+
+		size_t written = 0;
+		size_t digits = chunks.empty() ? 0 : decimal_digit_count(chunks.back()) + DECIMAL_CHUNK_DIGITS * (chunks.size() - 1);
+		assert(width == 0 || width >= digits);
+		if (width > digits) {
+			memset(buffer, '0', width - digits);
+			written = width - digits;
+		}
+		if (chunks.empty())
+			return written;
+		written += format_decimal(buffer + written, chunks.back());
+		for (size_t i = chunks.size() - 1; i-- > 0;) {
+			written += format_decimal_padded(buffer + written, chunks[i], DECIMAL_CHUNK_DIGITS);
+		}
+		return written;
+	}
+
+	// The largest k with 10^(19 2^k) <= a; a < 10^(19 2^(k + 1)) then has at
+	// most twice the limbs of the power, as Barrett division needs
+	size_t k = 0;
+	for (;;) {
+		const DecimalPower& next = decimal_power(k + 1, false);
+		if (limbs_compare(a, n, next.value.data(), next.value.size()) < 0)
+			break;
+		k++;
+	}
+	const DecimalPower& power = decimal_power(k, true);
+	size_t m = power.value.size();
+	std::vector<uint64_t> quotient(n - m + 1), remainder(m);
+	limbs_divmod_barrett(quotient.data(), remainder.data(), a, n, power.value.data(), m, power.reciprocal.data());
+
+	assert(width == 0 || width > power.digits);
+	size_t written = limbs_to_decimal_width(buffer, quotient.data(), quotient.size(), width == 0 ? 0 : width - power.digits);
+	written += limbs_to_decimal_width(buffer + written, remainder.data(), m, power.digits);
+	return written;
+}
+
+// Writes the digits of a[0 .. n) without leading zeros, "0" for zero, into
+// buffer of decimal_digits_bound(n) chars or more; returns their number
+inline size_t limbs_to_decimal(char* buffer, const uint64_t* a, size_t n)
+{
+	size_t written = limbs_to_decimal_width(buffer, a, n, 0);
+	if (written == 0)
+		buffer[written++] = '0';
+	return written;
+}
+
+// r[0 .. decimal_limbs_bound(count)) = value of count decimal digits,
+// leading zeros allowed; returns the number of limbs without leading zeros
+inline size_t decimal_to_limbs(uint64_t* r, const char* digits, size_t count)
+{
+	size_t bound = decimal_limbs_bound(count);
+	std::fill(r, r + bound, 0);
+	size_t chunks = (count + DECIMAL_CHUNK_DIGITS - 1) / DECIMAL_CHUNK_DIGITS;
+	if (chunks < std::max<size_t>(2, BigIntDecimalSettings::Instance().parseThreshold)) {
+		// value = value 10^19 + next 19 digits, the first chunk shorter
+		size_t length = 0;
+		size_t chunkDigits = count % DECIMAL_CHUNK_DIGITS;
+		if (chunkDigits == 0)
+			chunkDigits = DECIMAL_CHUNK_DIGITS;
+		for (size_t position = 0; position < count; position += chunkDigits, chunkDigits = DECIMAL_CHUNK_DIGITS) {
+			uint64_t chunk = parse_decimal(digits + position, chunkDigits);
+			uint64_t carry = limbs_mul_1(r, r, length, UINT64_POWERS_OF_TEN[chunkDigits]);
+			if (carry != 0)
+				r[length++] = carry;
+			if (length == 0)
+				length = 1;
+			if (limbs_add(r, r, length, &chunk, 1) != 0)
+				r[length++] = 1;
+		}
+		return limbs_normalized_length(r, length);
+	}
+
+	// The low part has 19 2^k digits for the largest such count below count
+	size_t k = 0;
+	while ((size_t)DECIMAL_CHUNK_DIGITS << (k + 1) < count) {
+		k++;
+	}
+	const DecimalPower& power = decimal_power(k, false);
+	size_t lowDigits = power.digits;
+	size_t highDigits = count - lowDigits;
+	std::vector<uint64_t> high(decimal_limbs_bound(highDigits)), low(decimal_limbs_bound(lowDigits));
+	size_t highLength = decimal_to_limbs(high.data(), digits, highDigits);
+	size_t lowLength = decimal_to_limbs(low.data(), digits + highDigits, lowDigits);
+
+	// r = high 10^lowDigits + low
+	size_t m = power.value.size();
+	std::vector<uint64_t> value(std::max(highLength + m, lowLength) + 1, 0);
+	if (highLength > 0)
+		limbs_mul(value.data(), high.data(), highLength, power.value.data(), m);
+	limbs_add(value.data(), value.data(), value.size(), low.data(), lowLength);
+	size_t length = limbs_normalized_length(value.data(), value.size());
+	assert(length <= bound);
+	std::copy(value.begin(), value.begin() + length, r);
+	return length;
+}
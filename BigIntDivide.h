@@ -0,0 +1,271 @@
+#pragma once
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "BigIntKernels.h"
+#include "BigIntMultiply.h"
+
+// Division of limb arrays. Short divisors go through schoolbook long
+// division (Knuth's algorithm D). A long divisor gets a reciprocal
+// floor(B^2m / d) by Newton's iteration, after which every division of up
+// to 2m limbs costs two multiplications (Barrett), so a division stays
+// within a constant factor of a multiplication.
+
+// Tunable parameters of big integer division
+struct BigIntDivideSettings
+{
+	// Reciprocals of divisors below this many limbs come straight from long
+	// division, longer ones from a Newton step on the reciprocal of the top
+	// half
+	size_t newtonThreshold;
+	// Divisions with a divisor and a quotient of at least this many limbs go
+	// through the reciprocal, see BigIntDivideBenchmark
+	size_t barrettThreshold;
+
+	static BigIntDivideSettings& Instance()
+	{
+		static BigIntDivideSettings settings = { 64, 1024 };
+		return settings;
+	}
+};
+
+// Length of a without its leading zero limbs
+inline size_t limbs_normalized_length(const uint64_t* a, size_t n)
+{
+	while (n > 0 && a[n - 1] == 0) {
+		n--;
+	}
+	return n;
+}
+
+// q[0 .. na - nd + 1) = a / d and r[0 .. nd) = a % d for na >= nd and
+// d[nd - 1] != 0. q and r must not overlap a or d; r may be null
+inline void limbs_divmod_schoolbook(uint64_t* q, uint64_t* r, const uint64_t* a, size_t na, const uint64_t* d, size_t nd)
+{
+	assert(na >= nd && nd > 0 && d[nd - 1] != 0);
+	if (nd == 1) {
+		uint64_t remainder = limbs_divmod_1(q, a, na, d[0]);
+		if (r != nullptr)
+			r[0] = remainder;
+		return;
+	}
+
+	// With the top bit of the divisor set every quotient limb estimated from
+	// the top two limbs of the remainder is at most 2 too large
+	unsigned shift = limb_leading_zeros(d[nd - 1]);
+	std::vector<uint64_t> divisor(nd), remainder(na + 1);
+	limbs_shift_left(divisor.data(), d, nd, shift);
+	remainder[na] = limbs_shift_left(remainder.data(), a, na, shift);
+	uint64_t top = divisor[nd - 1];
+	uint64_t next = divisor[nd - 2];
+
+	for (size_t j = na - nd + 1; j-- > 0;) {
+		uint64_t* window = remainder.data() + j;
+		uint64_t estimate, rest;
+		bool restOverflow = false;
+		if (window[nd] == top) {
+			estimate = ~0ULL;
+			restOverflow = limb_add_carry(0, window[nd - 1], top, rest) != 0;
+		}
+		else {
+			estimate = limb_div(window[nd], window[nd - 1], top, rest);
+		}
+		// The second divisor limb catches all but one case of a too large
+		// estimate; a rest past B makes the test always pass
+		while (!restOverflow) {
+			uint64_t high;
+			uint64_t low = limb_mul_add(estimate, next, 0, 0, high);
+			if (high < rest || (high == rest && low <= window[nd - 2]))
+				break;
+			estimate--;
+			restOverflow = limb_add_carry(0, rest, top, rest) != 0;
+		}
+
+		uint64_t borrow = limbs_submul_1(window, divisor.data(), nd, estimate);
+		uint64_t topLimb = window[nd];
+		window[nd] = topLimb - borrow;
+		if (topLimb < borrow) {
+			estimate--;
+			window[nd] += limbs_add(window, window, nd, divisor.data(), nd);
+		}
+		q[j] = estimate;
+	}
+
+	if (r != nullptr)
+		limbs_shift_right(r, remainder.data(), nd, shift);
+}
+
+// v[0 .. m + 1) = floor(B^2m / d) for d of m limbs, d[m - 1] != 0; the one
+// reciprocal that does not fit, of d = B^(m - 1), becomes B^(m + 1) - 1.
+// Above the threshold: x0 = xr B^l with xr = floor(B^2h / d_top) from the
+// top h limbs of d, one Newton step x1 = x0 + x0 (B^2m - d x0) / B^2m,
+// which squares the relative error to about B^-2h <= B^-m, and an exact
+// correction by the few units left. Only xr, the top of the error and the
+// step are multiplied, never the l zero limbs of x0
+inline void limbs_reciprocal(uint64_t* v, const uint64_t* d, size_t m)
+{
+	assert(m > 0 && d[m - 1] != 0);
+	if (m < std::max<size_t>(2, BigIntDivideSettings::Instance().newtonThreshold)) {
+		std::vector<uint64_t> power(2 * m + 1, 0), quotient(m + 2);
+		power[2 * m] = 1;
+		limbs_divmod_schoolbook(quotient.data(), nullptr, power.data(), power.size(), d, m);
+		if (quotient[m + 1] != 0)
+			std::fill(v, v + m + 1, ~0ULL);
+		else
+			std::copy(quotient.begin(), quotient.begin() + m + 1, v);
+		return;
+	}
+
+	size_t h = (m + 1) / 2;
+	size_t l = m - h;
+	std::vector<uint64_t> top(h + 1);
+	limbs_reciprocal(top.data(), d + l, h);
+	SignedLimbs xr(top.data(), h + 1);
+
+	// e = B^2m - d x0 = E B^l with E = B^(2m - l) - d xr
+	SignedLimbs divisor(d, m);
+	SignedLimbs power;
+	power.limbs.assign(2 * m - l + 1, 0);
+	power.limbs[2 * m - l] = 1;
+	SignedLimbs error = SignedLimbs::add(power, SignedLimbs::multiply(divisor, xr), true);
+
+	// x0 e / B^2m = xr E / B^2h; the low h - 1 limbs of E change it by less
+	// than one unit
+	SignedLimbs errorTop = error;
+	errorTop.limbs.erase(errorTop.limbs.begin(), errorTop.limbs.begin() + std::min(h - 1, errorTop.limbs.size()));
+	errorTop.trim();
+	SignedLimbs step = SignedLimbs::multiply(xr, errorTop);
+	step.limbs.erase(step.limbs.begin(), step.limbs.begin() + std::min(h + 1, step.limbs.size()));
+	step.trim();
+	SignedLimbs x = xr;
+	x.limbs.insert(x.limbs.begin(), l, 0);
+	x = SignedLimbs::add(x, step, false);
+
+	// B^2m - d x = E B^l - d step
+	SignedLimbs remainder = error;
+	if (!remainder.limbs.empty())
+		remainder.limbs.insert(remainder.limbs.begin(), l, 0);
+	remainder = SignedLimbs::add(remainder, SignedLimbs::multiply(divisor, step), true);
+
+	// x += floor((B^2m - d x) / d)
+	SignedLimbs correction;
+	bool inexact = !remainder.limbs.empty();
+	if (remainder.limbs.size() >= m) {
+		size_t nr = remainder.limbs.size();
+		std::vector<uint64_t> quotient(nr - m + 1), rest(m);
+		limbs_divmod_schoolbook(quotient.data(), rest.data(), remainder.limbs.data(), nr, d, m);
+		correction = SignedLimbs(quotient.data(), quotient.size());
+		inexact = limbs_normalized_length(rest.data(), m) != 0;
+	}
+	if (remainder.negative) {
+		// floor of a negative ratio goes one further down unless exact
+		if (inexact) {
+			uint64_t one = 1;
+			correction = SignedLimbs::add(correction, SignedLimbs(&one, 1), false);
+		}
+		x = SignedLimbs::add(x, correction, true);
+	}
+	else {
+		x = SignedLimbs::add(x, correction, false);
+	}
+
+	assert(!x.negative && x.limbs.size() <= m + 2);
+	if (x.limbs.size() > m + 1) {
+		std::fill(v, v + m + 1, ~0ULL);
+		return;
+	}
+	std::fill(v, v + m + 1, 0);
+	std::copy(x.limbs.begin(), x.limbs.end(), v);
+}
+
+// q[0 .. na - m + 1) = a / d and r[0 .. m) = a % d for m <= na <= 2m, with
+// v from limbs_reciprocal. The estimate
+// floor(floor(a / B^(m - 1)) v / B^(m + 1)) is at most 3 below the
+// quotient. q and r must not overlap a, d or v
+inline void limbs_divmod_barrett(uint64_t* q, uint64_t* r, const uint64_t* a, size_t na, const uint64_t* d, size_t m, const uint64_t* v)
+{
+	assert(na >= m && na <= 2 * m);
+	size_t nq = na - m + 1;
+	std::vector<uint64_t> product(nq + m + 1);
+	limbs_mul(product.data(), a + m - 1, nq, v, m + 1);
+	std::copy(product.begin() + m + 1, product.end(), q);
+
+	// a - q d < 4 d < B^(m + 1), so the low m + 1 limbs carry all of it
+	limbs_mul(product.data(), q, nq, d, m);
+	size_t low = std::min(na, m + 1);
+	std::vector<uint64_t> remainder(m + 1, 0);
+	std::copy(a, a + low, remainder.begin());
+	limbs_sub(remainder.data(), remainder.data(), m + 1, product.data(), std::min(nq + m, m + 1));
+
+	size_t dLength = limbs_normalized_length(d, m);
+	while (limbs_compare(remainder.data(), limbs_normalized_length(remainder.data(), m + 1), d, dLength) >= 0) {
+		limbs_sub(remainder.data(), remainder.data(), m + 1, d, m);
+		uint64_t one = 1;
+		limbs_add(q, q, nq, &one, 1);
+	}
+	std::copy(remainder.begin(), remainder.begin() + m, r);
+}
+
+// q[0 .. na - nd + 1) = a / d and r[0 .. nd) = a % d for na >= nd and
+// d[nd - 1] != 0. q and r must not overlap a or d; r may be null
+inline void limbs_divmod(uint64_t* q, uint64_t* r, const uint64_t* a, size_t na, const uint64_t* d, size_t nd)
+{
+	assert(na >= nd && nd > 0 && d[nd - 1] != 0);
+	size_t nq = na - nd + 1;
+	if (nd == 1) {
+		uint64_t remainder = limbs_divmod_1(q, a, na, d[0]);
+		if (r != nullptr)
+			r[0] = remainder;
+		return;
+	}
+	size_t threshold = std::max<size_t>(2, BigIntDivideSettings::Instance().barrettThreshold);
+	if (nd < threshold || nq < threshold) {
+		limbs_divmod_schoolbook(q, r, a, na, d, nd);
+		return;
+	}
+
+	if (nd > nq + 1) {
+		// Dropping the low k limbs of both leaves a divisor d' of nq + 1
+		// limbs. d' >= B^nq > q makes floor(a' / d') the quotient or one more,
+		// which a - q d tells apart
+		size_t k = nd - nq - 1;
+		limbs_divmod(q, nullptr, a + k, na - k, d + k, nd - k);
+		std::vector<uint64_t> product(na + 1);
+		limbs_mul(product.data(), d, nd, q, nq);
+		size_t length = limbs_normalized_length(product.data(), na + 1);
+		if (limbs_compare(product.data(), length, a, limbs_normalized_length(a, na)) > 0) {
+			uint64_t one = 1;
+			limbs_sub(q, q, nq, &one, 1);
+			limbs_sub(product.data(), product.data(), length, d, nd);
+		}
+		if (r != nullptr) {
+			std::vector<uint64_t> remainder(na);
+			limbs_sub(remainder.data(), a, na, product.data(), limbs_normalized_length(product.data(), na));
+			std::copy(remainder.begin(), remainder.begin() + nd, r);
+		}
+		return;
+	}
+
+	// The top 2m limbs first, then blocks of up to m limbs: the remainder so
+	// far and the next block make a window below d B^length, so its quotient
+	// has length limbs
+	size_t m = nd;
+	std::vector<uint64_t> reciprocal(m + 1);
+	limbs_reciprocal(reciprocal.data(), d, m);
+	std::vector<uint64_t> window(2 * m), quotient(m + 1), remainder(m);
+	size_t position = na - std::min(na, 2 * m);
+	limbs_divmod_barrett(quotient.data(), remainder.data(), a + position, na - position, d, m, reciprocal.data());
+	std::copy(quotient.begin(), quotient.begin() + (nq - position), q + position);
+	while (position > 0) {
+		size_t length = std::min(m, position);
+		position -= length;
+		std::copy(a + position, a + position + length, window.begin());
+		std::copy(remainder.begin(), remainder.end(), window.begin() + length);
+		limbs_divmod_barrett(quotient.data(), remainder.data(), window.data(), m + length, d, m, reciprocal.data());
+		std::copy(quotient.begin(), quotient.begin() + length, q + position);
+	}
+	if (r != nullptr)
+		std::copy(remainder.begin(), remainder.end(), r);
+}
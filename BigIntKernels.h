@@ -0,0 +1,298 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define BIGINT_X86_64
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+#endif
+
+// Primitives on little-endian arrays of 64-bit limbs: value = sum a[i] 2^(64 i).
+// Unless stated otherwise the result may be the same array as the first
+// operand, and the limbs of a result are written at or after the limbs
+// they are computed from are read.
+
+// sum = a + b + carry, returns the carry out (0 or 1)
+inline unsigned char limb_add_carry(unsigned char carry, uint64_t a, uint64_t b, uint64_t& sum)
+{
+#ifdef BIGINT_X86_64
+	unsigned long long result;
+	carry = _addcarry_u64(carry, a, b, &result);
+	sum = result;
+	return carry;
+#else
+	uint64_t partial = a + b;
+	uint64_t total = partial + carry;
+	sum = total;
+	return (unsigned char)((partial < a) | (total < partial));
+#endif
+}
+
+// difference = a - b - borrow, returns the borrow out (0 or 1)
+inline unsigned char limb_sub_borrow(unsigned char borrow, uint64_t a, uint64_t b, uint64_t& difference)
+{
+#ifdef BIGINT_X86_64
+	unsigned long long result;
+	borrow = _subborrow_u64(borrow, a, b, &result);
+	difference = result;
+	return borrow;
+#else
+	uint64_t partial = a - b;
+	uint64_t total = partial - borrow;
+	difference = total;
+	return (unsigned char)((a < b) | (partial < borrow));
+#endif
+}
+
+// limb_mul_add from four 32 x 32 bit partial products, for targets with
+// neither __int128 nor _umul128
+constexpr uint64_t limb_mul_add_portable(uint64_t a, uint64_t b, uint64_t c, uint64_t d, uint64_t& high)
+{
+	uint64_t aLow = a & 0xFFFFFFFFULL, aHigh = a >> 32;
+	uint64_t bLow = b & 0xFFFFFFFFULL, bHigh = b >> 32;
+	uint64_t lowLow = aLow * bLow;
+	uint64_t lowHigh = aLow * bHigh;
+	uint64_t highLow = aHigh * bLow;
+	uint64_t middle = (lowLow >> 32) + (lowHigh & 0xFFFFFFFFULL) + (highLow & 0xFFFFFFFFULL);
+	uint64_t top = aHigh * bHigh + (lowHigh >> 32) + (highLow >> 32) + (middle >> 32);
+	uint64_t low = (lowLow & 0xFFFFFFFFULL) | (middle << 32);
+	uint64_t sum = low + c;
+	top += sum < low;
+	low = sum;
+	sum = low + d;
+	top += sum < low;
+	high = top;
+	return sum;
+}
+
+// limb_div one quotient bit per step, for targets with neither __int128
+// nor _udiv128. The partial remainder stays below divisor
+constexpr uint64_t limb_div_portable(uint64_t high, uint64_t low, uint64_t divisor, uint64_t& remainder)
+{
+	uint64_t quotient = 0;
+	for (int bit = 63; bit >= 0; bit--) {
+		uint64_t out = high >> 63;
+		high = (high << 1) | (low >> 63);
+		low <<= 1;
+		quotient <<= 1;
+		if (out != 0 || high >= divisor) {
+			high -= divisor;
+			quotient |= 1;
+		}
+	}
+	remainder = high;
+	return quotient;
+}
+
+// a * b + c + d as high:low, which cannot overflow 128 bits; returns low
+inline uint64_t limb_mul_add(uint64_t a, uint64_t b, uint64_t c, uint64_t d, uint64_t& high)
+{
+#if defined(__SIZEOF_INT128__)
+	unsigned __int128 product = (unsigned __int128)a * b + c + d;
+	high = (uint64_t)(product >> 64);
+	return (uint64_t)product;
+#elif defined(_MSC_VER) && defined(_M_X64)
+	unsigned long long productHigh;
+	uint64_t low = _umul128(a, b, &productHigh);
+	uint64_t sum;
+	unsigned char carry = limb_add_carry(0, low, c, sum);
+	productHigh += carry;
+	carry = limb_add_carry(0, sum, d, sum);
+	high = productHigh + carry;
+	return sum;
+#else
+	return limb_mul_add_portable(a, b, c, d, high);
+#endif
+}
+
+// (high:low) / divisor for high < divisor, the remainder goes to remainder
+inline uint64_t limb_div(uint64_t high, uint64_t low, uint64_t divisor, uint64_t& remainder)
+{
+#if defined(__SIZEOF_INT128__)
+	unsigned __int128 dividend = ((unsigned __int128)high << 64) | low;
+	remainder = (uint64_t)(dividend % divisor);
+	return (uint64_t)(dividend / divisor);
+#elif defined(_MSC_VER) && defined(_M_X64) && _MSC_VER >= 1920
+	unsigned long long rest;
+	uint64_t quotient = _udiv128(high, low, divisor, &rest);
+	remainder = rest;
+	return quotient;
+#else
+	return limb_div_portable(high, low, divisor, remainder);
+#endif
+}
+
+// r[0 .. na) = a + b for na >= nb, returns the carry out of the top limb
+inline uint64_t limbs_add(uint64_t* r, const uint64_t* a, size_t na, const uint64_t* b, size_t nb)
+{
+	unsigned char carry = 0;
+	size_t i = 0;
+	// Four limbs per step keep the carry in the flags register
+	for (; i + 4 <= nb; i += 4) {
+		carry = limb_add_carry(carry, a[i], b[i], r[i]);
+		carry = limb_add_carry(carry, a[i + 1], b[i + 1], r[i + 1]);
+		carry = limb_add_carry(carry, a[i + 2], b[i + 2], r[i + 2]);
+		carry = limb_add_carry(carry, a[i + 3], b[i + 3], r[i + 3]);
+	}
+	for (; i < nb; i++) {
+		carry = limb_add_carry(carry, a[i], b[i], r[i]);
+	}
+	for (; i < na && carry; i++) {
+		carry = limb_add_carry(carry, a[i], 0, r[i]);
+	}
+	if (r != a) {
+		for (; i < na; i++) {
+			r[i] = a[i];
+		}
+	}
+	return carry;
+}
+
+// r[0 .. na) = a - b for a >= b (so na >= nb), returns the borrow out of
+// the top limb, which is 0 when a >= b holds
+inline uint64_t limbs_sub(uint64_t* r, const uint64_t* a, size_t na, const uint64_t* b, size_t nb)
+{
+	unsigned char borrow = 0;
+	size_t i = 0;
+	for (; i + 4 <= nb; i += 4) {
+		borrow = limb_sub_borrow(borrow, a[i], b[i], r[i]);
+		borrow = limb_sub_borrow(borrow, a[i + 1], b[i + 1], r[i + 1]);
+		borrow = limb_sub_borrow(borrow, a[i + 2], b[i + 2], r[i + 2]);
+		borrow = limb_sub_borrow(borrow, a[i + 3], b[i + 3], r[i + 3]);
+	}
+	for (; i < nb; i++) {
+		borrow = limb_sub_borrow(borrow, a[i], b[i], r[i]);
+	}
+	for (; i < na && borrow; i++) {
+		borrow = limb_sub_borrow(borrow, a[i], 0, r[i]);
+	}
+	if (r != a) {
+		for (; i < na; i++) {
+			r[i] = a[i];
+		}
+	}
+	return borrow;
+}
+
+// Sign of a - b for arrays without leading zero limbs
+inline int limbs_compare(const uint64_t* a, size_t na, const uint64_t* b, size_t nb)
+{
+	if (na != nb)
+		return na < nb ? -1 : 1;
+	for (size_t i = na; i-- > 0;) {
+		if (a[i] != b[i])
+			return a[i] < b[i] ? -1 : 1;
+	}
+	return 0;
+}
+
+// r[0 .. n) = a * b, returns the limb carried out of the top
+inline uint64_t limbs_mul_1(uint64_t* r, const uint64_t* a, size_t n, uint64_t b)
+{
+	uint64_t carry = 0;
+	for (size_t i = 0; i < n; i++) {
+		r[i] = limb_mul_add(a[i], b, carry, 0, carry);
+	}
+	return carry;
+}
+
+// r[0 .. n) += a * b, returns the limb carried out of the top
+inline uint64_t limbs_addmul_1(uint64_t* r, const uint64_t* a, size_t n, uint64_t b)
+{
+	uint64_t carry = 0;
+	for (size_t i = 0; i < n; i++) {
+		r[i] = limb_mul_add(a[i], b, r[i], carry, carry);
+	}
+	return carry;
+}
+
+// r[0 .. n) -= a * b, returns the limb borrowed from above the top
+inline uint64_t limbs_submul_1(uint64_t* r, const uint64_t* a, size_t n, uint64_t b)
+{
+	uint64_t carry = 0;
+	for (size_t i = 0; i < n; i++) {
+		uint64_t high;
+		uint64_t low = limb_mul_add(a[i], b, carry, 0, high);
+		carry = high + limb_sub_borrow(0, r[i], low, r[i]);
+	}
+	return carry;
+}
+
+// Number of leading zero bits of a nonzero limb
+inline unsigned limb_leading_zeros(uint64_t a)
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+	unsigned long index;
+	_BitScanReverse64(&index, a);
+	return 63 - (unsigned)index;
+#else
+	return (unsigned)__builtin_clzll(a);
+#endif
+}
+
+// r[0 .. n) = a << shift for shift < 64, returns the bits shifted out of the
+// top. r may be a
+inline uint64_t limbs_shift_left(uint64_t* r, const uint64_t* a, size_t n, unsigned shift)
+{
+	if (shift == 0) {
+		for (size_t i = n; i-- > 0;) {
+			r[i] = a[i];
+		}
+		return 0;
+	}
+	uint64_t out = n > 0 ? a[n - 1] >> (64 - shift) : 0;
+	for (size_t i = n; i-- > 1;) {
+		r[i] = (a[i] << shift) | (a[i - 1] >> (64 - shift));
+	}
+	if (n > 0)
+		r[0] = a[0] << shift;
+	return out;
+}
+
+// r[0 .. n) = a >> shift for shift < 64. r may be a
+inline void limbs_shift_right(uint64_t* r, const uint64_t* a, size_t n, unsigned shift)
+{
+	if (shift == 0) {
+		for (size_t i = 0; i < n; i++) {
+			r[i] = a[i];
+		}
+		return;
+	}
+	for (size_t i = 0; i + 1 < n; i++) {
+		r[i] = (a[i] >> shift) | (a[i + 1] << (64 - shift));
+	}
+	if (n > 0)
+		r[n - 1] = a[n - 1] >> shift;
+}
+
+// r[0 .. na + nb) = a * b by rows of limbs_addmul_1. r must not overlap a or b
+inline void limbs_mul_schoolbook(uint64_t* r, const uint64_t* a, size_t na, const uint64_t* b, size_t nb)
+{
+	r[na] = limbs_mul_1(r, a, na, b[0]);
+	for (size_t j = 1; j < nb; j++) {
+		r[na + j] = limbs_addmul_1(r + j, a, na, b[j]);
+	}
+}
+
+// q[0 .. n) = a / d, returns a % d; d must not be zero, q may be a
+inline uint64_t limbs_divmod_1(uint64_t* q, const uint64_t* a, size_t n, uint64_t d)
+{
+	uint64_t remainder = 0;
+	for (size_t i = n; i-- > 0;) {
+		q[i] = limb_div(remainder, a[i], d, remainder);
+	}
+	return remainder;
+}
+
+// a % d without the quotient; d must not be zero
+inline uint64_t limbs_mod_1(const uint64_t* a, size_t n, uint64_t d)
+{
+	uint64_t remainder = 0;
+	for (size_t i = n; i-- > 0;) {
+		limb_div(remainder, a[i], d, remainder);
+	}
+	return remainder;
+}
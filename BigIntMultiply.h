@@ -0,0 +1,476 @@
+#pragma once
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "BigIntKernels.h"
+#include "ThreadPool.h"
+
+// Products of limb arrays in tiers picked by the length of the shorter
+// operand: schoolbook, Karatsuba (3 half-size products instead of 4), Toom-3
+// (5 third-size products instead of 9) and a number-theoretic transform.
+// Squares take the same route with one operand, which saves a transform or
+// an evaluation at every level and uses a schoolbook square at the bottom.
+
+// Tunable parameters of big integer multiplication, see
+// BigIntMultiplyBenchmark
+struct BigIntMultiplySettings
+{
+	// Shorter operands below this many limbs are multiplied by the schoolbook
+	// method
+	size_t karatsubaThreshold;
+	// Shorter operands of this many limbs and more go through Toom-3
+	size_t toomThreshold;
+	// Shorter operands of this many limbs and more go through the NTT
+	size_t nttThreshold;
+
+	static BigIntMultiplySettings& Instance()
+	{
+		static BigIntMultiplySettings settings = { 32, 256, 8192 };
+		return settings;
+	}
+};
+
+// Longest product in limbs the NTT takes. Its three primes allow transforms
+// of 2^23 points and coefficients below about 2^86, which 32-bit pieces of
+// operands this long stay under. Longer products are split by Toom-3 first
+static const size_t NTT_MAX_LIMBS = size_t(1) << 21;
+
+inline void limbs_mul(uint64_t* r, const uint64_t* a, size_t na, const uint64_t* b, size_t nb);
+
+// r[0 .. 2n) = a^2: every cross product once, doubled by a shift, plus the
+// squares on the diagonal. r must not overlap a
+inline void limbs_sqr_schoolbook(uint64_t* r, const uint64_t* a, size_t n)
+{
+	std::fill(r, r + 2 * n, 0);
+	for (size_t i = 0; i + 1 < n; i++) {
+		r[i + n] = limbs_addmul_1(r + 2 * i + 1, a + i + 1, n - i - 1, a[i]);
+	}
+
+	uint64_t shifted = 0;
+	for (size_t k = 0; k < 2 * n; k++) {
+		uint64_t limb = r[k];
+		r[k] = (limb << 1) | shifted;
+		shifted = limb >> 63;
+	}
+
+	unsigned char carry = 0;
+	for (size_t i = 0; i < n; i++) {
+		uint64_t high;
+		uint64_t low = limb_mul_add(a[i], a[i], 0, 0, high);
+		carry = limb_add_carry(carry, r[2 * i], low, r[2 * i]);
+		carry = limb_add_carry(carry, r[2 * i + 1], high, r[2 * i + 1]);
+	}
+}
+
+// a about twice as long as b or longer: pieces of a of b's length times b
+inline void limbs_mul_unbalanced(uint64_t* r, const uint64_t* a, size_t na, const uint64_t* b, size_t nb)
+{
+	std::fill(r, r + na + nb, 0);
+	std::vector<uint64_t> product(2 * nb);
+	for (size_t offset = 0; offset < na; offset += nb) {
+		size_t piece = std::min(nb, na - offset);
+		limbs_mul(product.data(), a + offset, piece, b, nb);
+		limbs_add(r + offset, r + offset, na + nb - offset, product.data(), piece + nb);
+	}
+}
+
+// a = a0 + B^h a1, b = b0 + B^h b1 with h = ceil(na / 2) < nb:
+// a b = z0 + B^h ((a0 + a1)(b0 + b1) - z0 - z2) + B^2h z2
+inline void limbs_mul_karatsuba(uint64_t* r, const uint64_t* a, size_t na, const uint64_t* b, size_t nb)
+{
+	bool square = a == b && na == nb;
+	size_t h = (na + 1) / 2;
+	size_t na1 = na - h;
+	size_t nb1 = nb - h;
+	std::vector<uint64_t> sa(h + 1), sb(square ? 0 : h + 1);
+	sa[h] = limbs_add(sa.data(), a, h, a + h, na1);
+	if (!square)
+		sb[h] = limbs_add(sb.data(), b, h, b + h, nb1);
+	const uint64_t* sbData = square ? sa.data() : sb.data();
+
+	// z0 and z2 go straight to their places in r, the three products are
+	// independent and large ones go to the pool
+	std::vector<uint64_t> z1(2 * h + 2);
+	size_t grain = h * h >= PARALLEL_MIN_ELEMENTS ? 1 : 3;
+	ThreadPool::Instance().ParallelFor(3, grain, [&](size_t begin, size_t end) {
+		for (size_t product = begin; product < end; product++) {
+			if (product == 0)
+				limbs_mul(r, a, h, b, h);
+			else if (product == 1)
+				limbs_mul(r + 2 * h, a + h, na1, b + h, nb1);
+			else
+				limbs_mul(z1.data(), sa.data(), h + 1, sbData, h + 1);
+		}
+	});
+
+	limbs_sub(z1.data(), z1.data(), z1.size(), r, 2 * h);
+	limbs_sub(z1.data(), z1.data(), z1.size(), r + 2 * h, na1 + nb1);
+	size_t length = z1.size();
+	while (length > 0 && z1[length - 1] == 0) {
+		length--;
+	}
+	assert(length <= na + nb - h);
+	limbs_add(r + h, r + h, na + nb - h, z1.data(), length);
+}
+
+// Signed number for the evaluation and interpolation steps of Toom-3: a
+// sign and a magnitude without leading zero limbs
+struct SignedLimbs
+{
+	std::vector<uint64_t> limbs;
+	bool negative;
+
+	SignedLimbs() : negative(false) {}
+
+	SignedLimbs(const uint64_t* a, size_t n) : limbs(a, a + n), negative(false)
+	{
+		trim();
+	}
+
+	void trim()
+	{
+		while (!limbs.empty() && limbs.back() == 0) {
+			limbs.pop_back();
+		}
+		if (limbs.empty())
+			negative = false;
+	}
+
+	// x +- y
+	static SignedLimbs add(const SignedLimbs& x, const SignedLimbs& y, bool subtract)
+	{
+		bool yNegative = y.negative != subtract;
+		SignedLimbs result;
+		if (x.negative == yNegative) {
+			const SignedLimbs& larger = x.limbs.size() >= y.limbs.size() ? x : y;
+			const SignedLimbs& smaller = x.limbs.size() >= y.limbs.size() ? y : x;
+			result.limbs.resize(larger.limbs.size() + 1);
+			result.limbs.back() = limbs_add(result.limbs.data(), larger.limbs.data(), larger.limbs.size(), smaller.limbs.data(), smaller.limbs.size());
+			result.negative = x.negative;
+		}
+		else {
+			int order = limbs_compare(x.limbs.data(), x.limbs.size(), y.limbs.data(), y.limbs.size());
+			if (order == 0)
+				return result;
+			const SignedLimbs& larger = order > 0 ? x : y;
+			const SignedLimbs& smaller = order > 0 ? y : x;
+			result.limbs.resize(larger.limbs.size());
+			limbs_sub(result.limbs.data(), larger.limbs.data(), larger.limbs.size(), smaller.limbs.data(), smaller.limbs.size());
+			result.negative = order > 0 ? x.negative : yNegative;
+		}
+		result.trim();
+		return result;
+	}
+
+	static SignedLimbs multiply(const SignedLimbs& x, const SignedLimbs& y)
+	{
+		SignedLimbs result;
+		if (x.limbs.empty() || y.limbs.empty())
+			return result;
+		result.limbs.resize(x.limbs.size() + y.limbs.size());
+		limbs_mul(result.limbs.data(), x.limbs.data(), x.limbs.size(), y.limbs.data(), y.limbs.size());
+		result.negative = x.negative != y.negative;
+		result.trim();
+		return result;
+	}
+
+	void shift_left_1()
+	{
+		limbs.push_back(0);
+		uint64_t shifted = 0;
+		for (size_t i = 0; i < limbs.size(); i++) {
+			uint64_t limb = limbs[i];
+			limbs[i] = (limb << 1) | shifted;
+			shifted = limb >> 63;
+		}
+		trim();
+	}
+
+	// Division by 2, which must be exact
+	void shift_right_1()
+	{
+		assert(limbs.empty() || (limbs[0] & 1) == 0);
+		for (size_t i = 0; i < limbs.size(); i++) {
+			uint64_t next = i + 1 < limbs.size() ? limbs[i + 1] : 0;
+			limbs[i] = (limbs[i] >> 1) | (next << 63);
+		}
+		trim();
+	}
+
+	// Division by a limb, which must be exact
+	void divide_exact(uint64_t divisor)
+	{
+		uint64_t remainder = limbs_divmod_1(limbs.data(), limbs.data(), limbs.size(), divisor);
+		assert(remainder == 0);
+		(void)remainder;
+		trim();
+	}
+};
+
+// Values at 0, 1, -1, -2 and infinity of a0 + a1 x + a2 x^2 for the pieces
+// of a of k limbs (the last one shorter)
+inline void toom3_evaluate(const uint64_t* a, size_t n, size_t k, SignedLimbs values[5])
+{
+	SignedLimbs a0(a, k), a1(a + k, k), a2(a + 2 * k, n - 2 * k);
+	SignedLimbs sum02 = SignedLimbs::add(a0, a2, false);
+	values[1] = SignedLimbs::add(sum02, a1, false);
+	values[2] = SignedLimbs::add(sum02, a1, true);
+	values[3] = SignedLimbs::add(values[2], a2, false);
+	values[3].shift_left_1();
+	values[3] = SignedLimbs::add(values[3], a0, true);
+	values[0] = a0;
+	values[4] = a2;
+}
+
+// Toom-3 with k = ceil(na / 3) < nb / 2: five products of the values at 0,
+// 1, -1, -2 and infinity, interpolated as in Bodrato's sequence
+inline void limbs_mul_toom3(uint64_t* r, const uint64_t* a, size_t na, const uint64_t* b, size_t nb)
+{
+	bool square = a == b && na == nb;
+	size_t k = (na + 2) / 3;
+	SignedLimbs va[5], vb[5], w[5];
+	toom3_evaluate(a, na, k, va);
+	if (!square)
+		toom3_evaluate(b, nb, k, vb);
+
+	size_t grain = k * k >= PARALLEL_MIN_ELEMENTS ? 1 : 5;
+	ThreadPool::Instance().ParallelFor(5, grain, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			w[i] = SignedLimbs::multiply(va[i], square ? va[i] : vb[i]);
+		}
+	});
+
+	// w = r(0), r(1), r(-1), r(-2), r(inf) into the coefficients c0 .. c4
+	SignedLimbs c3 = SignedLimbs::add(w[3], w[1], true);
+	c3.divide_exact(3);
+	SignedLimbs c1 = SignedLimbs::add(w[1], w[2], true);
+	c1.shift_right_1();
+	SignedLimbs c2 = SignedLimbs::add(w[2], w[0], true);
+	c3 = SignedLimbs::add(c2, c3, true);
+	c3.shift_right_1();
+	SignedLimbs doubled4 = w[4];
+	doubled4.shift_left_1();
+	c3 = SignedLimbs::add(c3, doubled4, false);
+	c2 = SignedLimbs::add(SignedLimbs::add(c2, c1, false), w[4], true);
+	c1 = SignedLimbs::add(c1, c3, true);
+
+	// The coefficients of a product of non-negative pieces are non-negative
+	const SignedLimbs* coefficients[5] = { &w[0], &c1, &c2, &c3, &w[4] };
+	std::fill(r, r + na + nb, 0);
+	for (size_t i = 0; i < 5; i++) {
+		const SignedLimbs& c = *coefficients[i];
+		assert(!c.negative && i * k + c.limbs.size() <= na + nb);
+		if (!c.limbs.empty())
+			limbs_add(r + i * k, r + i * k, na + nb - i * k, c.limbs.data(), c.limbs.size());
+	}
+}
+
+// Arithmetic modulo an NTT prime P = c 2^m + 1 with primitive root G
+template <uint32_t P>
+inline uint32_t ntt_mul(uint32_t a, uint32_t b)
+{
+	return (uint32_t)((uint64_t)a * b % P);
+}
+
+template <uint32_t P>
+inline uint32_t ntt_power(uint32_t base, uint64_t exponent)
+{
+	uint32_t result = 1;
+	for (; exponent > 0; exponent >>= 1) {
+		if (exponent & 1)
+			result = ntt_mul<P>(result, base);
+		base = ntt_mul<P>(base, base);
+	}
+	return result;
+}
+
+// Product modulo P by the Shoup quotient wq = floor(w 2^32 / P) of w:
+// two multiplications and a subtraction instead of a division
+template <uint32_t P>
+inline uint32_t ntt_mul_shoup(uint32_t x, uint32_t w, uint32_t wq)
+{
+	uint32_t q = (uint32_t)(((uint64_t)x * wq) >> 32);
+	uint32_t product = x * w - q * P;
+	return product >= P ? product - P : product;
+}
+
+// In-place radix-2 NTT modulo P of a.size() = n, a power of two. The
+// forward transform takes the natural order to the bit-reversed one and the
+// inverse transform goes back, so a convolution needs no reordering. The
+// inverse transform is not scaled by 1 / n
+template <uint32_t P, uint32_t G>
+inline void ntt(std::vector<uint32_t>& a, bool inverse)
+{
+	size_t n = a.size();
+	// Stage len = 2 half uses roots[half .. len), the powers of a primitive
+	// len-th root of unity, and their Shoup quotients
+	std::vector<uint32_t> roots(std::max<size_t>(2, n)), quotients(roots.size());
+	uint32_t root = ntt_power<P>(G, (P - 1) / n);
+	if (inverse)
+		root = ntt_power<P>(root, P - 2);
+	for (size_t half = n / 2; half >= 1; half /= 2) {
+		roots[half] = 1;
+		for (size_t j = 1; j < half; j++) {
+			roots[half + j] = half == n / 2 ? ntt_mul<P>(roots[half + j - 1], root) : roots[2 * half + 2 * j];
+		}
+	}
+	for (size_t i = 1; i < n; i++) {
+		quotients[i] = (uint32_t)(((uint64_t)roots[i] << 32) / P);
+	}
+
+	if (!inverse) {
+		// Decimation in frequency: x, y -> x + y, (x - y) w
+		for (size_t half = n / 2; half >= 1; half /= 2) {
+			const uint32_t* w = roots.data() + half;
+			const uint32_t* wq = quotients.data() + half;
+			for (size_t start = 0; start < n; start += 2 * half) {
+				uint32_t* x = a.data() + start;
+				uint32_t* y = x + half;
+				for (size_t j = 0; j < half; j++) {
+					uint32_t u = x[j], v = y[j];
+					uint32_t sum = u + v;
+					x[j] = sum >= P ? sum - P : sum;
+					y[j] = ntt_mul_shoup<P>(u >= v ? u - v : u + P - v, w[j], wq[j]);
+				}
+			}
+		}
+	}
+	else {
+		// Decimation in time: x, y -> x + y w, x - y w
+		for (size_t half = 1; half < n; half *= 2) {
+			const uint32_t* w = roots.data() + half;
+			const uint32_t* wq = quotients.data() + half;
+			for (size_t start = 0; start < n; start += 2 * half) {
+				uint32_t* x = a.data() + start;
+				uint32_t* y = x + half;
+				for (size_t j = 0; j < half; j++) {
+					uint32_t u = x[j];
+					uint32_t v = ntt_mul_shoup<P>(y[j], w[j], wq[j]);
+					uint32_t sum = u + v;
+					x[j] = sum >= P ? sum - P : sum;
+					y[j] = u >= v ? u - v : u + P - v;
+				}
+			}
+		}
+	}
+}
+
+// Cyclic convolution modulo P of a and b split into 32-bit pieces
+template <uint32_t P, uint32_t G>
+inline void ntt_convolve(const uint64_t* a, size_t na, const uint64_t* b, size_t nb, size_t size, std::vector<uint32_t>& result)
+{
+	bool square = a == b && na == nb;
+	auto split = [size](const uint64_t* x, size_t n, std::vector<uint32_t>& pieces) {
+		pieces.assign(size, 0);
+		for (size_t i = 0; i < n; i++) {
+			pieces[2 * i] = (uint32_t)x[i] % P;
+			pieces[2 * i + 1] = (uint32_t)(x[i] >> 32) % P;
+		}
+		ntt<P, G>(pieces, false);
+	};
+
+	// The 1 / size of the inverse transform goes into the pointwise products
+	split(a, na, result);
+	uint32_t scale = ntt_power<P>((uint32_t)(size % P), P - 2);
+	if (square) {
+		for (size_t i = 0; i < size; i++) {
+			result[i] = ntt_mul<P>(ntt_mul<P>(result[i], result[i]), scale);
+		}
+	}
+	else {
+		std::vector<uint32_t> other;
+		split(b, nb, other);
+		for (size_t i = 0; i < size; i++) {
+			result[i] = ntt_mul<P>(ntt_mul<P>(result[i], other[i]), scale);
+		}
+	}
+	ntt<P, G>(result, true);
+}
+
+// Product through convolutions of the 32-bit pieces modulo three primes,
+// combined by Garner's method into the exact coefficients, each below
+// 2^32 min(na, nb) 2^64, and carried into limbs
+inline void limbs_mul_ntt(uint64_t* r, const uint64_t* a, size_t na, const uint64_t* b, size_t nb)
+{
+	const uint32_t P0 = 998244353, P1 = 167772161, P2 = 469762049;
+	size_t pieces = 2 * (na + nb);
+	size_t size = 1;
+	while (size < pieces - 1) {
+		size <<= 1;
+	}
+
+	std::vector<uint32_t> residues[3];
+	size_t grain = size >= PARALLEL_MIN_ELEMENTS ? 1 : 3;
+	ThreadPool::Instance().ParallelFor(3, grain, [&](size_t begin, size_t end) {
+		for (size_t prime = begin; prime < end; prime++) {
+			if (prime == 0)
+				ntt_convolve<P0, 3>(a, na, b, nb, size, residues[0]);
+			else if (prime == 1)
+				ntt_convolve<P1, 3>(a, na, b, nb, size, residues[1]);
+			else
+				ntt_convolve<P2, 3>(a, na, b, nb, size, residues[2]);
+		}
+	});
+
+	// x = x0 + P0 t1 + P0 P1 t2 with t1 < P1, t2 < P2
+	const uint32_t inverseP0 = ntt_power<P1>(P0 % P1, P1 - 2);
+	const uint32_t inverseP0P1 = ntt_power<P2>(ntt_mul<P2>(P0 % P2, P1 % P2), P2 - 2);
+	const uint64_t P0P1 = (uint64_t)P0 * P1;
+	uint64_t carryLow = 0, carryHigh = 0;
+	for (size_t j = 0; j < pieces; j++) {
+		uint64_t valueLow = 0, valueHigh = 0;
+		if (j + 1 < pieces) {
+			uint32_t x0 = residues[0][j], x1 = residues[1][j], x2 = residues[2][j];
+			uint32_t t1 = ntt_mul<P1>((x1 + P1 - x0 % P1) % P1, inverseP0);
+			uint64_t low = x0 + (uint64_t)t1 * P0;
+			uint32_t t2 = ntt_mul<P2>((uint32_t)((x2 + P2 - low % P2) % P2), inverseP0P1);
+			valueLow = limb_mul_add(t2, P0P1, low, 0, valueHigh);
+		}
+
+		unsigned char carry = limb_add_carry(0, carryLow, valueLow, carryLow);
+		limb_add_carry(carry, carryHigh, valueHigh, carryHigh);
+		uint64_t piece = carryLow & 0xffffffffULL;
+		carryLow = (carryLow >> 32) | (carryHigh << 32);
+		carryHigh >>= 32;
+		if (j % 2 == 0)
+			r[j / 2] = piece;
+		else
+			r[j / 2] |= piece << 32;
+	}
+}
+
+// r[0 .. na + nb) = a * b, r must not overlap a or b. Squares (a == b,
+// na == nb) stay squares down every tier
+inline void limbs_mul(uint64_t* r, const uint64_t* a, size_t na, const uint64_t* b, size_t nb)
+{
+	if (na < nb) {
+		std::swap(a, b);
+		std::swap(na, nb);
+	}
+	bool square = a == b && na == nb;
+	const BigIntMultiplySettings& settings = BigIntMultiplySettings::Instance();
+	// Karatsuba's sums of halves are no shorter than operands below 4 limbs
+	if (nb < std::max<size_t>(4, settings.karatsubaThreshold)) {
+		if (square)
+			limbs_sqr_schoolbook(r, a, na);
+		else
+			limbs_mul_schoolbook(r, a, na, b, nb);
+		return;
+	}
+	if (na + 1 >= 2 * nb) {
+		limbs_mul_unbalanced(r, a, na, b, nb);
+		return;
+	}
+	if (nb >= settings.nttThreshold && na + nb <= NTT_MAX_LIMBS) {
+		limbs_mul_ntt(r, a, na, b, nb);
+		return;
+	}
+	// Toom-3 needs the top piece of b non-empty
+	if (nb >= std::max<size_t>(3, settings.toomThreshold) && nb > 2 * ((na + 2) / 3)) {
+		limbs_mul_toom3(r, a, na, b, nb);
+		return;
+	}
+	limbs_mul_karatsuba(r, a, na, b, nb);
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <vector>
+#include "QSMatrix.h"
+#include "RowKernels.h"
+
+// Companion matrix of a polynomial a_0 + a_1 x + ... + a_n x^n, in the
+// layout of Polynomial::GeneratePolynomialComplexMatrix: the first row is
+// -(a_{n-1}, ..., a_0) / a_n and ones run below the diagonal. Its
+// eigenvalues are the roots of the polynomial. Only the first row is
+// stored, applying it to a vector takes O(n) time and memory.
+template <typename T>
+class CompanionOperator
+{
+private:
+	std::vector<T> firstRow;
+
+public:
+	typedef T value_type;
+
+	// coefficients holds a_0, ..., a_n with a_n not zero
+	explicit CompanionOperator(const std::vector<T>& coefficients)
+	{
+		size_t n = coefficients.size() - 1;
+		firstRow.resize(n);
+		for (size_t j = 0; j < n; j++) {
+			firstRow[j] = -coefficients[n - 1 - j] / coefficients[n];
+		}
+	}
+
+	unsigned size() const { return (unsigned)firstRow.size(); }
+	const std::vector<T>& first_row() const { return firstRow; }
+
+	T operator()(unsigned row, unsigned col) const
+	{
+		if (row == 0)
+			return firstRow[col];
+		return row == col + 1 ? T(1) : T();
+	}
+
+	QSMatrix<T> to_matrix() const
+	{
+		unsigned n = size();
+		QSMatrix<T> result(n, n, T());
+		for (unsigned j = 0; j < n; j++) {
+			result(0, j) = firstRow[j];
+		}
+		for (unsigned i = 1; i < n; i++) {
+			result(i, i - 1) = T(1);
+		}
+		return result;
+	}
+
+	// result = C * x: one dot product for the first row, a shift for the rest.
+	// result must not alias x
+	void apply(const std::vector<T>& x, std::vector<T>& result) const
+	{
+		unsigned n = size();
+		result.resize(n);
+		if (n == 0)
+			return;
+		result[0] = row_dot(n, firstRow.data(), x.data());
+		for (unsigned i = 1; i < n; i++) {
+			result[i] = x[i - 1];
+		}
+	}
+
+	std::vector<T> operator*(const std::vector<T>& x) const
+	{
+		std::vector<T> result;
+		apply(x, result);
+		return result;
+	}
+};
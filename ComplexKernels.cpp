@@ -0,0 +1,790 @@
+#include "ComplexKernels.h"
+#include <atomic>
+#include "Gemm.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define COMPLEX_KERNELS_X86
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define TARGET_AVX2
+#define TARGET_AVX512
+#else
+#include <cpuid.h>
+#define TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define TARGET_AVX512 __attribute__((target("avx512f,avx512dq,fma")))
+#endif
+#endif
+
+typedef std::complex<double> cd;
+
+// ---------------------------------------------------------------------------
+// Scalar kernels
+
+static void axpy_scalar(size_t n, cd alpha, const cd* x, cd* y)
+{
+	double ar = alpha.real(), ai = alpha.imag();
+	for (size_t i = 0; i < n; i++) {
+		double xr = x[i].real(), xi = x[i].imag();
+		y[i] = cd(y[i].real() + ar * xr - ai * xi, y[i].imag() + ar * xi + ai * xr);
+	}
+}
+
+static void add_scalar(size_t n, const cd* x, const cd* y, cd* r)
+{
+	for (size_t i = 0; i < n; i++) {
+		r[i] = x[i] + y[i];
+	}
+}
+
+static void sub_scalar(size_t n, const cd* x, const cd* y, cd* r)
+{
+	for (size_t i = 0; i < n; i++) {
+		r[i] = x[i] - y[i];
+	}
+}
+
+static void scale_scalar(size_t n, cd alpha, const cd* x, cd* r)
+{
+	double ar = alpha.real(), ai = alpha.imag();
+	for (size_t i = 0; i < n; i++) {
+		double xr = x[i].real(), xi = x[i].imag();
+		r[i] = cd(ar * xr - ai * xi, ar * xi + ai * xr);
+	}
+}
+
+static cd dot_scalar(size_t n, const cd* x, const cd* y)
+{
+	double re = 0, im = 0;
+	for (size_t i = 0; i < n; i++) {
+		double xr = x[i].real(), xi = x[i].imag();
+		double yr = y[i].real(), yi = y[i].imag();
+		re += xr * yr - xi * yi;
+		im += xr * yi + xi * yr;
+	}
+	return cd(re, im);
+}
+
+static void horner_scalar(size_t degree, const cd* a, size_t n, const cd* x, cd* values, cd* derivatives)
+{
+	for (size_t i = 0; i < n; i++) {
+		double xr = x[i].real(), xi = x[i].imag();
+		double pr = a[degree].real(), pi = a[degree].imag();
+		double dr = 0, di = 0;
+		for (size_t k = degree; k-- > 0;) {
+			double tr = dr * xr - di * xi + pr;
+			di = dr * xi + di * xr + pi;
+			dr = tr;
+			tr = pr * xr - pi * xi + a[k].real();
+			pi = pr * xi + pi * xr + a[k].imag();
+			pr = tr;
+		}
+		values[i] = cd(pr, pi);
+		if (derivatives != nullptr)
+			derivatives[i] = cd(dr, di);
+	}
+}
+
+static const ComplexKernelTable scalarTable = {
+	axpy_scalar, add_scalar, sub_scalar, scale_scalar, dot_scalar, ComplexMicroKernel::micro_scalar, horner_scalar
+};
+
+#ifdef COMPLEX_KERNELS_X86
+
+// ---------------------------------------------------------------------------
+// SSE2 kernels, one complex number per register
+
+// Sign mask flipping the real lane
+static inline __m128d sse2_negate_real(__m128d v)
+{
+	return _mm_xor_pd(v, _mm_set_pd(0.0, -0.0));
+}
+
+// alpha * x for a single complex number, alpha given as (ar, ar) and (-ai, ai)
+static inline __m128d sse2_mul(__m128d x, __m128d arDup, __m128d aiSigned)
+{
+	__m128d swapped = _mm_shuffle_pd(x, x, 1);
+	return _mm_add_pd(_mm_mul_pd(x, arDup), _mm_mul_pd(swapped, aiSigned));
+}
+
+static void axpy_sse2(size_t n, cd alpha, const cd* x, cd* y)
+{
+	const double* xp = reinterpret_cast<const double*>(x);
+	double* yp = reinterpret_cast<double*>(y);
+	__m128d arDup = _mm_set1_pd(alpha.real());
+	__m128d aiSigned = _mm_set_pd(alpha.imag(), -alpha.imag());
+	for (size_t i = 0; i < n; i++) {
+		__m128d product = sse2_mul(_mm_loadu_pd(xp + 2 * i), arDup, aiSigned);
+		_mm_storeu_pd(yp + 2 * i, _mm_add_pd(_mm_loadu_pd(yp + 2 * i), product));
+	}
+}
+
+static void add_sse2(size_t n, const cd* x, const cd* y, cd* r)
+{
+	const double* xp = reinterpret_cast<const double*>(x);
+	const double* yp = reinterpret_cast<const double*>(y);
+	double* rp = reinterpret_cast<double*>(r);
+	for (size_t i = 0; i < 2 * n; i += 2) {
+		_mm_storeu_pd(rp + i, _mm_add_pd(_mm_loadu_pd(xp + i), _mm_loadu_pd(yp + i)));
+	}
+}
+
+static void sub_sse2(size_t n, const cd* x, const cd* y, cd* r)
+{
+	const double* xp = reinterpret_cast<const double*>(x);
+	const double* yp = reinterpret_cast<const double*>(y);
+	double* rp = reinterpret_cast<double*>(r);
+	for (size_t i = 0; i < 2 * n; i += 2) {
+		_mm_storeu_pd(rp + i, _mm_sub_pd(_mm_loadu_pd(xp + i), _mm_loadu_pd(yp + i)));
+	}
+}
+
+static void scale_sse2(size_t n, cd alpha, const cd* x, cd* r)
+{
+	const double* xp = reinterpret_cast<const double*>(x);
+	double* rp = reinterpret_cast<double*>(r);
+	__m128d arDup = _mm_set1_pd(alpha.real());
+	__m128d aiSigned = _mm_set_pd(alpha.imag(), -alpha.imag());
+	for (size_t i = 0; i < n; i++) {
+		_mm_storeu_pd(rp + 2 * i, sse2_mul(_mm_loadu_pd(xp + 2 * i), arDup, aiSigned));
+	}
+}
+
+static cd dot_sse2(size_t n, const cd* x, const cd* y)
+{
+	const double* xp = reinterpret_cast<const double*>(x);
+	const double* yp = reinterpret_cast<const double*>(y);
+	// acc1 = sum (xr*yr, xi*yr), acc2 = sum (xi*yi, xr*yi)
+	__m128d acc1 = _mm_setzero_pd();
+	__m128d acc2 = _mm_setzero_pd();
+	for (size_t i = 0; i < n; i++) {
+		__m128d xv = _mm_loadu_pd(xp + 2 * i);
+		__m128d yv = _mm_loadu_pd(yp + 2 * i);
+		acc1 = _mm_add_pd(acc1, _mm_mul_pd(xv, _mm_unpacklo_pd(yv, yv)));
+		acc2 = _mm_add_pd(acc2, _mm_mul_pd(_mm_shuffle_pd(xv, xv, 1), _mm_unpackhi_pd(yv, yv)));
+	}
+	double result[2];
+	_mm_storeu_pd(result, _mm_add_pd(acc1, sse2_negate_real(acc2)));
+	return cd(result[0], result[1]);
+}
+
+// One Horner step p = p * x + a (and d = d * x + p before it) on two
+// points, real and imaginary parts in separate registers
+template <bool withDerivative>
+static inline void sse2_horner_step(__m128d& pr, __m128d& pi, __m128d& dr, __m128d& di, __m128d xr, __m128d xi, __m128d ar, __m128d ai)
+{
+	if (withDerivative) {
+		__m128d tr = _mm_add_pd(_mm_sub_pd(_mm_mul_pd(dr, xr), _mm_mul_pd(di, xi)), pr);
+		di = _mm_add_pd(_mm_add_pd(_mm_mul_pd(dr, xi), _mm_mul_pd(di, xr)), pi);
+		dr = tr;
+	}
+	__m128d tr = _mm_add_pd(_mm_sub_pd(_mm_mul_pd(pr, xr), _mm_mul_pd(pi, xi)), ar);
+	pi = _mm_add_pd(_mm_add_pd(_mm_mul_pd(pr, xi), _mm_mul_pd(pi, xr)), ai);
+	pr = tr;
+}
+
+// Horner's rule on four points, two independent chains of two points
+template <bool withDerivative>
+static void sse2_horner_block(size_t degree, const cd* a, const double* xp, double* vp, double* dp)
+{
+	__m128d x0 = _mm_loadu_pd(xp), x1 = _mm_loadu_pd(xp + 2), x2 = _mm_loadu_pd(xp + 4), x3 = _mm_loadu_pd(xp + 6);
+	__m128d xr0 = _mm_unpacklo_pd(x0, x1), xi0 = _mm_unpackhi_pd(x0, x1);
+	__m128d xr1 = _mm_unpacklo_pd(x2, x3), xi1 = _mm_unpackhi_pd(x2, x3);
+	__m128d pr0 = _mm_set1_pd(a[degree].real()), pi0 = _mm_set1_pd(a[degree].imag());
+	__m128d pr1 = pr0, pi1 = pi0;
+	__m128d dr0 = _mm_setzero_pd(), di0 = dr0, dr1 = dr0, di1 = dr0;
+	for (size_t k = degree; k-- > 0;) {
+		__m128d ar = _mm_set1_pd(a[k].real()), ai = _mm_set1_pd(a[k].imag());
+		sse2_horner_step<withDerivative>(pr0, pi0, dr0, di0, xr0, xi0, ar, ai);
+		sse2_horner_step<withDerivative>(pr1, pi1, dr1, di1, xr1, xi1, ar, ai);
+	}
+	_mm_storeu_pd(vp, _mm_unpacklo_pd(pr0, pi0));
+	_mm_storeu_pd(vp + 2, _mm_unpackhi_pd(pr0, pi0));
+	_mm_storeu_pd(vp + 4, _mm_unpacklo_pd(pr1, pi1));
+	_mm_storeu_pd(vp + 6, _mm_unpackhi_pd(pr1, pi1));
+	if (withDerivative) {
+		_mm_storeu_pd(dp, _mm_unpacklo_pd(dr0, di0));
+		_mm_storeu_pd(dp + 2, _mm_unpackhi_pd(dr0, di0));
+		_mm_storeu_pd(dp + 4, _mm_unpacklo_pd(dr1, di1));
+		_mm_storeu_pd(dp + 6, _mm_unpackhi_pd(dr1, di1));
+	}
+}
+
+static void horner_sse2(size_t degree, const cd* a, size_t n, const cd* x, cd* values, cd* derivatives)
+{
+	const double* xp = reinterpret_cast<const double*>(x);
+	double* vp = reinterpret_cast<double*>(values);
+	double* dp = reinterpret_cast<double*>(derivatives);
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4) {
+		if (derivatives != nullptr)
+			sse2_horner_block<true>(degree, a, xp + 2 * i, vp + 2 * i, dp + 2 * i);
+		else
+			sse2_horner_block<false>(degree, a, xp + 2 * i, vp + 2 * i, nullptr);
+	}
+	horner_scalar(degree, a, n - i, x + i, values + i, derivatives != nullptr ? derivatives + i : nullptr);
+}
+
+static const ComplexKernelTable sse2Table = {
+	axpy_sse2, add_sse2, sub_sse2, scale_sse2, dot_sse2, ComplexMicroKernel::micro_scalar, horner_sse2
+};
+
+// ---------------------------------------------------------------------------
+// AVX2 + FMA kernels, two complex numbers per register
+
+// alpha * x for two complex numbers: (xr*ar - xi*ai, xi*ar + xr*ai)
+TARGET_AVX2 static inline __m256d avx2_mul(__m256d x, __m256d arDup, __m256d aiDup)
+{
+	__m256d swapped = _mm256_permute_pd(x, 0x5);
+	return _mm256_fmaddsub_pd(x, arDup, _mm256_mul_pd(swapped, aiDup));
+}
+
+TARGET_AVX2 static void axpy_avx2(size_t n, cd alpha, const cd* x, cd* y)
+{
+	const double* xp = reinterpret_cast<const double*>(x);
+	double* yp = reinterpret_cast<double*>(y);
+	__m256d arDup = _mm256_set1_pd(alpha.real());
+	__m256d aiDup = _mm256_set1_pd(alpha.imag());
+	size_t i = 0;
+	for (; i + 2 <= n; i += 2) {
+		__m256d product = avx2_mul(_mm256_loadu_pd(xp + 2 * i), arDup, aiDup);
+		_mm256_storeu_pd(yp + 2 * i, _mm256_add_pd(_mm256_loadu_pd(yp + 2 * i), product));
+	}
+	axpy_scalar(n - i, alpha, x + i, y + i);
+}
+
+TARGET_AVX2 static void add_avx2(size_t n, const cd* x, const cd* y, cd* r)
+{
+	const double* xp = reinterpret_cast<const double*>(x);
+	const double* yp = reinterpret_cast<const double*>(y);
+	double* rp = reinterpret_cast<double*>(r);
+	size_t i = 0;
+	for (; i + 4 <= 2 * n; i += 4) {
+		_mm256_storeu_pd(rp + i, _mm256_add_pd(_mm256_loadu_pd(xp + i), _mm256_loadu_pd(yp + i)));
+	}
+	add_scalar(n - i / 2, x + i / 2, y + i / 2, r + i / 2);
+}
+
+TARGET_AVX2 static void sub_avx2(size_t n, const cd* x, const cd* y, cd* r)
+{
+	const double* xp = reinterpret_cast<const double*>(x);
+	const double* yp = reinterpret_cast<const double*>(y);
+	double* rp = reinterpret_cast<double*>(r);
+	size_t i = 0;
+	for (; i + 4 <= 2 * n; i += 4) {
+		_mm256_storeu_pd(rp + i, _mm256_sub_pd(_mm256_loadu_pd(xp + i), _mm256_loadu_pd(yp + i)));
+	}
+	sub_scalar(n - i / 2, x + i / 2, y + i / 2, r + i / 2);
+}
+
+TARGET_AVX2 static void scale_avx2(size_t n, cd alpha, const cd* x, cd* r)
+{
+	const double* xp = reinterpret_cast<const double*>(x);
+	double* rp = reinterpret_cast<double*>(r);
+	__m256d arDup = _mm256_set1_pd(alpha.real());
+	__m256d aiDup = _mm256_set1_pd(alpha.imag());
+	size_t i = 0;
+	for (; i + 2 <= n; i += 2) {
+		_mm256_storeu_pd(rp + 2 * i, avx2_mul(_mm256_loadu_pd(xp + 2 * i), arDup, aiDup));
+	}
+	scale_scalar(n - i, alpha, x + i, r + i);
+}
+
+TARGET_AVX2 static cd dot_avx2(size_t n, const cd* x, const cd* y)
+{
+	const double* xp = reinterpret_cast<const double*>(x);
+	const double* yp = reinterpret_cast<const double*>(y);
+	// Two independent accumulator pairs to hide the FMA latency
+	__m256d acc1 = _mm256_setzero_pd(), acc2 = _mm256_setzero_pd();
+	__m256d acc3 = _mm256_setzero_pd(), acc4 = _mm256_setzero_pd();
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4) {
+		__m256d xv = _mm256_loadu_pd(xp + 2 * i);
+		__m256d yv = _mm256_loadu_pd(yp + 2 * i);
+		acc1 = _mm256_fmadd_pd(xv, _mm256_movedup_pd(yv), acc1);
+		acc2 = _mm256_fmadd_pd(_mm256_permute_pd(xv, 0x5), _mm256_permute_pd(yv, 0xF), acc2);
+		xv = _mm256_loadu_pd(xp + 2 * i + 4);
+		yv = _mm256_loadu_pd(yp + 2 * i + 4);
+		acc3 = _mm256_fmadd_pd(xv, _mm256_movedup_pd(yv), acc3);
+		acc4 = _mm256_fmadd_pd(_mm256_permute_pd(xv, 0x5), _mm256_permute_pd(yv, 0xF), acc4);
+	}
+	__m256d sum = _mm256_addsub_pd(_mm256_add_pd(acc1, acc3), _mm256_add_pd(acc2, acc4));
+	__m128d pair = _mm_add_pd(_mm256_castpd256_pd128(sum), _mm256_extractf128_pd(sum, 1));
+	double result[2];
+	_mm_storeu_pd(result, pair);
+	return cd(result[0], result[1]) + dot_scalar(n - i, x + i, y + i);
+}
+
+// Add four (re, im) column pairs to a row of C
+TARGET_AVX2 static inline void avx2_store_row(cd* cRow, __m256d re, __m256d im)
+{
+	double* cp = reinterpret_cast<double*>(cRow);
+	__m256d lo = _mm256_unpacklo_pd(re, im);
+	__m256d hi = _mm256_unpackhi_pd(re, im);
+	__m256d c01 = _mm256_permute2f128_pd(lo, hi, 0x20);
+	__m256d c23 = _mm256_permute2f128_pd(lo, hi, 0x31);
+	_mm256_storeu_pd(cp, _mm256_add_pd(_mm256_loadu_pd(cp), c01));
+	_mm256_storeu_pd(cp + 4, _mm256_add_pd(_mm256_loadu_pd(cp + 4), c23));
+}
+
+TARGET_AVX2 static void gemm_micro_avx2(unsigned kc, const double* ap, const double* bp, cd* c, unsigned ldc, unsigned mr, unsigned nr)
+{
+	static_assert(ComplexMicroKernel::MR == 4 && ComplexMicroKernel::NR == 4, "AVX2 micro-kernel is written for 4x4 tiles");
+	__m256d re0 = _mm256_setzero_pd(), im0 = _mm256_setzero_pd();
+	__m256d re1 = _mm256_setzero_pd(), im1 = _mm256_setzero_pd();
+	__m256d re2 = _mm256_setzero_pd(), im2 = _mm256_setzero_pd();
+	__m256d re3 = _mm256_setzero_pd(), im3 = _mm256_setzero_pd();
+
+	for (unsigned p = 0; p < kc; p++) {
+		__m256d bRe = _mm256_load_pd(bp);
+		__m256d bIm = _mm256_load_pd(bp + 4);
+		__m256d aRe, aIm;
+
+#define COMPLEX_AVX2_ROW(i, re, im) \
+		aRe = _mm256_broadcast_sd(ap + 2 * i); \
+		aIm = _mm256_broadcast_sd(ap + 2 * i + 1); \
+		re = _mm256_fmadd_pd(aRe, bRe, re); \
+		re = _mm256_fnmadd_pd(aIm, bIm, re); \
+		im = _mm256_fmadd_pd(aRe, bIm, im); \
+		im = _mm256_fmadd_pd(aIm, bRe, im);
+
+		COMPLEX_AVX2_ROW(0, re0, im0)
+		COMPLEX_AVX2_ROW(1, re1, im1)
+		COMPLEX_AVX2_ROW(2, re2, im2)
+		COMPLEX_AVX2_ROW(3, re3, im3)
+#undef COMPLEX_AVX2_ROW
+
+		ap += 8;
+		bp += 8;
+	}
+
+	if (mr == 4 && nr == 4) {
+		avx2_store_row(c, re0, im0);
+		avx2_store_row(c + ldc, re1, im1);
+		avx2_store_row(c + 2 * (size_t)ldc, re2, im2);
+		avx2_store_row(c + 3 * (size_t)ldc, re3, im3);
+		return;
+	}
+
+	// Edge tile: spill the accumulators and add only the valid part
+	double re[4][4], im[4][4];
+	_mm256_storeu_pd(re[0], re0); _mm256_storeu_pd(im[0], im0);
+	_mm256_storeu_pd(re[1], re1); _mm256_storeu_pd(im[1], im1);
+	_mm256_storeu_pd(re[2], re2); _mm256_storeu_pd(im[2], im2);
+	_mm256_storeu_pd(re[3], re3); _mm256_storeu_pd(im[3], im3);
+	for (unsigned i = 0; i < mr; i++) {
+		for (unsigned j = 0; j < nr; j++) {
+			c[(size_t)i * ldc + j] += cd(re[i][j], im[i][j]);
+		}
+	}
+}
+
+// Horner step on 4 points, real and imaginary parts in separate registers
+template <bool withDerivative>
+TARGET_AVX2 static inline void avx2_horner_step(__m256d& pr, __m256d& pi, __m256d& dr, __m256d& di, __m256d xr, __m256d xi, __m256d ar, __m256d ai)
+{
+	if (withDerivative) {
+		__m256d tr = _mm256_fmadd_pd(dr, xr, _mm256_fnmadd_pd(di, xi, pr));
+		di = _mm256_fmadd_pd(dr, xi, _mm256_fmadd_pd(di, xr, pi));
+		dr = tr;
+	}
+	__m256d tr = _mm256_fmadd_pd(pr, xr, _mm256_fnmadd_pd(pi, xi, ar));
+	pi = _mm256_fmadd_pd(pr, xi, _mm256_fmadd_pd(pi, xr, ai));
+	pr = tr;
+}
+
+// Horner's rule on 8 points, two independent chains of 4. Unpacking
+// pairs of loads puts the points in a shuffled lane order that the
+// unpacking on store undoes
+template <bool withDerivative>
+TARGET_AVX2 static void avx2_horner_block(size_t degree, const cd* a, const double* xp, double* vp, double* dp)
+{
+	__m256d x0 = _mm256_loadu_pd(xp), x1 = _mm256_loadu_pd(xp + 4);
+	__m256d x2 = _mm256_loadu_pd(xp + 8), x3 = _mm256_loadu_pd(xp + 12);
+	__m256d xr0 = _mm256_unpacklo_pd(x0, x1), xi0 = _mm256_unpackhi_pd(x0, x1);
+	__m256d xr1 = _mm256_unpacklo_pd(x2, x3), xi1 = _mm256_unpackhi_pd(x2, x3);
+	__m256d pr0 = _mm256_set1_pd(a[degree].real()), pi0 = _mm256_set1_pd(a[degree].imag());
+	__m256d pr1 = pr0, pi1 = pi0;
+	__m256d dr0 = _mm256_setzero_pd(), di0 = dr0, dr1 = dr0, di1 = dr0;
+	for (size_t k = degree; k-- > 0;) {
+		__m256d ar = _mm256_set1_pd(a[k].real()), ai = _mm256_set1_pd(a[k].imag());
+		avx2_horner_step<withDerivative>(pr0, pi0, dr0, di0, xr0, xi0, ar, ai);
+		avx2_horner_step<withDerivative>(pr1, pi1, dr1, di1, xr1, xi1, ar, ai);
+	}
+	_mm256_storeu_pd(vp, _mm256_unpacklo_pd(pr0, pi0));
+	_mm256_storeu_pd(vp + 4, _mm256_unpackhi_pd(pr0, pi0));
+	_mm256_storeu_pd(vp + 8, _mm256_unpacklo_pd(pr1, pi1));
+	_mm256_storeu_pd(vp + 12, _mm256_unpackhi_pd(pr1, pi1));
+	if (withDerivative) {
+		_mm256_storeu_pd(dp, _mm256_unpacklo_pd(dr0, di0));
+		_mm256_storeu_pd(dp + 4, _mm256_unpackhi_pd(dr0, di0));
+		_mm256_storeu_pd(dp + 8, _mm256_unpacklo_pd(dr1, di1));
+		_mm256_storeu_pd(dp + 12, _mm256_unpackhi_pd(dr1, di1));
+	}
+}
+
+TARGET_AVX2 static void horner_avx2(size_t degree, const cd* a, size_t n, const cd* x, cd* values, cd* derivatives)
+{
+	const double* xp = reinterpret_cast<const double*>(x);
+	double* vp = reinterpret_cast<double*>(values);
+	double* dp = reinterpret_cast<double*>(derivatives);
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		if (derivatives != nullptr)
+			avx2_horner_block<true>(degree, a, xp + 2 * i, vp + 2 * i, dp + 2 * i);
+		else
+			avx2_horner_block<false>(degree, a, xp + 2 * i, vp + 2 * i, nullptr);
+	}
+	horner_scalar(degree, a, n - i, x + i, values + i, derivatives != nullptr ? derivatives + i : nullptr);
+}
+
+static const ComplexKernelTable avx2Table = {
+	axpy_avx2, add_avx2, sub_avx2, scale_avx2, dot_avx2, gemm_micro_avx2, horner_avx2
+};
+
+// ---------------------------------------------------------------------------
+// AVX-512 kernels, four complex numbers per register, masked tails
+
+// GCC 12 builds _mm512_undefined_pd as a self-initialized variable, and the
+// permute, unpack, movedup, extract and reduce intrinsics that start from
+// it report it as (maybe) uninitialized wherever they are inlined. No
+// lane of that value reaches a result, so the warnings are off here
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+TARGET_AVX512 static inline __m512d avx512_mul(__m512d x, __m512d arDup, __m512d aiDup)
+{
+	__m512d swapped = _mm512_permute_pd(x, 0x55);
+	return _mm512_fmaddsub_pd(x, arDup, _mm512_mul_pd(swapped, aiDup));
+}
+
+// Mask of the first 2 * count doubles
+static inline __mmask8 avx512_tail_mask(size_t count)
+{
+	return (__mmask8)((1u << (2 * count)) - 1);
+}
+
+TARGET_AVX512 static void axpy_avx512(size_t n, cd alpha, const cd* x, cd* y)
+{
+	const double* xp = reinterpret_cast<const double*>(x);
+	double* yp = reinterpret_cast<double*>(y);
+	__m512d arDup = _mm512_set1_pd(alpha.real());
+	__m512d aiDup = _mm512_set1_pd(alpha.imag());
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4) {
+		__m512d product = avx512_mul(_mm512_loadu_pd(xp + 2 * i), arDup, aiDup);
+		_mm512_storeu_pd(yp + 2 * i, _mm512_add_pd(_mm512_loadu_pd(yp + 2 * i), product));
+	}
+	if (i < n) {
+		__mmask8 mask = avx512_tail_mask(n - i);
+		__m512d product = avx512_mul(_mm512_maskz_loadu_pd(mask, xp + 2 * i), arDup, aiDup);
+		_mm512_mask_storeu_pd(yp + 2 * i, mask, _mm512_add_pd(_mm512_maskz_loadu_pd(mask, yp + 2 * i), product));
+	}
+}
+
+TARGET_AVX512 static void add_avx512(size_t n, const cd* x, const cd* y, cd* r)
+{
+	const double* xp = reinterpret_cast<const double*>(x);
+	const double* yp = reinterpret_cast<const double*>(y);
+	double* rp = reinterpret_cast<double*>(r);
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4) {
+		_mm512_storeu_pd(rp + 2 * i, _mm512_add_pd(_mm512_loadu_pd(xp + 2 * i), _mm512_loadu_pd(yp + 2 * i)));
+	}
+	if (i < n) {
+		__mmask8 mask = avx512_tail_mask(n - i);
+		__m512d sum = _mm512_add_pd(_mm512_maskz_loadu_pd(mask, xp + 2 * i), _mm512_maskz_loadu_pd(mask, yp + 2 * i));
+		_mm512_mask_storeu_pd(rp + 2 * i, mask, sum);
+	}
+}
+
+TARGET_AVX512 static void sub_avx512(size_t n, const cd* x, const cd* y, cd* r)
+{
+	const double* xp = reinterpret_cast<const double*>(x);
+	const double* yp = reinterpret_cast<const double*>(y);
+	double* rp = reinterpret_cast<double*>(r);
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4) {
+		_mm512_storeu_pd(rp + 2 * i, _mm512_sub_pd(_mm512_loadu_pd(xp + 2 * i), _mm512_loadu_pd(yp + 2 * i)));
+	}
+	if (i < n) {
+		__mmask8 mask = avx512_tail_mask(n - i);
+		__m512d difference = _mm512_sub_pd(_mm512_maskz_loadu_pd(mask, xp + 2 * i), _mm512_maskz_loadu_pd(mask, yp + 2 * i));
+		_mm512_mask_storeu_pd(rp + 2 * i, mask, difference);
+	}
+}
+
+TARGET_AVX512 static void scale_avx512(size_t n, cd alpha, const cd* x, cd* r)
+{
+	const double* xp = reinterpret_cast<const double*>(x);
+	double* rp = reinterpret_cast<double*>(r);
+	__m512d arDup = _mm512_set1_pd(alpha.real());
+	__m512d aiDup = _mm512_set1_pd(alpha.imag());
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4) {
+		_mm512_storeu_pd(rp + 2 * i, avx512_mul(_mm512_loadu_pd(xp + 2 * i), arDup, aiDup));
+	}
+	if (i < n) {
+		__mmask8 mask = avx512_tail_mask(n - i);
+		_mm512_mask_storeu_pd(rp + 2 * i, mask, avx512_mul(_mm512_maskz_loadu_pd(mask, xp + 2 * i), arDup, aiDup));
+	}
+}
+
+TARGET_AVX512 static cd dot_avx512(size_t n, const cd* x, const cd* y)
+{
+	const double* xp = reinterpret_cast<const double*>(x);
+	const double* yp = reinterpret_cast<const double*>(y);
+	__m512d acc1 = _mm512_setzero_pd();
+	__m512d acc2 = _mm512_setzero_pd();
+	size_t i = 0;
+	for (; i < n; i += 4) {
+		__mmask8 mask = i + 4 <= n ? (__mmask8)0xFF : avx512_tail_mask(n - i);
+		__m512d xv = _mm512_maskz_loadu_pd(mask, xp + 2 * i);
+		__m512d yv = _mm512_maskz_loadu_pd(mask, yp + 2 * i);
+		acc1 = _mm512_fmadd_pd(xv, _mm512_movedup_pd(yv), acc1);
+		acc2 = _mm512_fmadd_pd(_mm512_permute_pd(xv, 0x55), _mm512_permute_pd(yv, 0xFF), acc2);
+	}
+	// Real lanes take acc1 - acc2, imaginary lanes acc1 + acc2
+	__m512d sum = _mm512_fmaddsub_pd(_mm512_set1_pd(1.0), acc1, acc2);
+	return cd(_mm512_mask_reduce_add_pd(0x55, sum), _mm512_mask_reduce_add_pd(0xAA, sum));
+}
+
+// One zmm per row of the tile holds [re0..re3 | im0..im3]. With
+// b = [bRe | bIm] and bSwap = [-bIm | bRe] a row update is two FMAs:
+// acc += aRe * b + aIm * bSwap.
+TARGET_AVX512 static void gemm_micro_avx512(unsigned kc, const double* ap, const double* bp, cd* c, unsigned ldc, unsigned mr, unsigned nr)
+{
+	const __m512i swapHalves = _mm512_set_epi64(3, 2, 1, 0, 7, 6, 5, 4);
+	const __m512d negateLow = _mm512_set_pd(0.0, 0.0, 0.0, 0.0, -0.0, -0.0, -0.0, -0.0);
+	__m512d acc0 = _mm512_setzero_pd();
+	__m512d acc1 = _mm512_setzero_pd();
+	__m512d acc2 = _mm512_setzero_pd();
+	__m512d acc3 = _mm512_setzero_pd();
+
+	for (unsigned p = 0; p < kc; p++) {
+		__m512d b = _mm512_load_pd(bp);
+		__m512d bSwap = _mm512_xor_pd(_mm512_permutexvar_pd(swapHalves, b), negateLow);
+		acc0 = _mm512_fmadd_pd(_mm512_set1_pd(ap[0]), b, acc0);
+		acc0 = _mm512_fmadd_pd(_mm512_set1_pd(ap[1]), bSwap, acc0);
+		acc1 = _mm512_fmadd_pd(_mm512_set1_pd(ap[2]), b, acc1);
+		acc1 = _mm512_fmadd_pd(_mm512_set1_pd(ap[3]), bSwap, acc1);
+		acc2 = _mm512_fmadd_pd(_mm512_set1_pd(ap[4]), b, acc2);
+		acc2 = _mm512_fmadd_pd(_mm512_set1_pd(ap[5]), bSwap, acc2);
+		acc3 = _mm512_fmadd_pd(_mm512_set1_pd(ap[6]), b, acc3);
+		acc3 = _mm512_fmadd_pd(_mm512_set1_pd(ap[7]), bSwap, acc3);
+		ap += 8;
+		bp += 8;
+	}
+
+	if (mr == 4 && nr == 4) {
+		avx2_store_row(c, _mm512_castpd512_pd256(acc0), _mm512_extractf64x4_pd(acc0, 1));
+		avx2_store_row(c + ldc, _mm512_castpd512_pd256(acc1), _mm512_extractf64x4_pd(acc1, 1));
+		avx2_store_row(c + 2 * (size_t)ldc, _mm512_castpd512_pd256(acc2), _mm512_extractf64x4_pd(acc2, 1));
+		avx2_store_row(c + 3 * (size_t)ldc, _mm512_castpd512_pd256(acc3), _mm512_extractf64x4_pd(acc3, 1));
+		return;
+	}
+
+	double acc[4][8];
+	_mm512_storeu_pd(acc[0], acc0);
+	_mm512_storeu_pd(acc[1], acc1);
+	_mm512_storeu_pd(acc[2], acc2);
+	_mm512_storeu_pd(acc[3], acc3);
+	for (unsigned i = 0; i < mr; i++) {
+		for (unsigned j = 0; j < nr; j++) {
+			c[(size_t)i * ldc + j] += cd(acc[i][j], acc[i][4 + j]);
+		}
+	}
+}
+
+// Horner step on 8 points, real and imaginary parts in separate registers
+template <bool withDerivative>
+TARGET_AVX512 static inline void avx512_horner_step(__m512d& pr, __m512d& pi, __m512d& dr, __m512d& di, __m512d xr, __m512d xi, __m512d ar, __m512d ai)
+{
+	if (withDerivative) {
+		__m512d tr = _mm512_fmadd_pd(dr, xr, _mm512_fnmadd_pd(di, xi, pr));
+		di = _mm512_fmadd_pd(dr, xi, _mm512_fmadd_pd(di, xr, pi));
+		dr = tr;
+	}
+	__m512d tr = _mm512_fmadd_pd(pr, xr, _mm512_fnmadd_pd(pi, xi, ar));
+	pi = _mm512_fmadd_pd(pr, xi, _mm512_fmadd_pd(pi, xr, ai));
+	pr = tr;
+}
+
+// Horner's rule on 16 points, two independent chains of 8. Unpacking
+// pairs of loads puts the points in a shuffled lane order that the
+// unpacking on store undoes
+template <bool withDerivative>
+TARGET_AVX512 static void avx512_horner_block(size_t degree, const cd* a, const double* xp, double* vp, double* dp)
+{
+	__m512d x0 = _mm512_loadu_pd(xp), x1 = _mm512_loadu_pd(xp + 8);
+	__m512d x2 = _mm512_loadu_pd(xp + 16), x3 = _mm512_loadu_pd(xp + 24);
+	__m512d xr0 = _mm512_unpacklo_pd(x0, x1), xi0 = _mm512_unpackhi_pd(x0, x1);
+	__m512d xr1 = _mm512_unpacklo_pd(x2, x3), xi1 = _mm512_unpackhi_pd(x2, x3);
+	__m512d pr0 = _mm512_set1_pd(a[degree].real()), pi0 = _mm512_set1_pd(a[degree].imag());
+	__m512d pr1 = pr0, pi1 = pi0;
+	__m512d dr0 = _mm512_setzero_pd(), di0 = dr0, dr1 = dr0, di1 = dr0;
+	for (size_t k = degree; k-- > 0;) {
+		__m512d ar = _mm512_set1_pd(a[k].real()), ai = _mm512_set1_pd(a[k].imag());
+		avx512_horner_step<withDerivative>(pr0, pi0, dr0, di0, xr0, xi0, ar, ai);
+		avx512_horner_step<withDerivative>(pr1, pi1, dr1, di1, xr1, xi1, ar, ai);
+	}
+	_mm512_storeu_pd(vp, _mm512_unpacklo_pd(pr0, pi0));
+	_mm512_storeu_pd(vp + 8, _mm512_unpackhi_pd(pr0, pi0));
+	_mm512_storeu_pd(vp + 16, _mm512_unpacklo_pd(pr1, pi1));
+	_mm512_storeu_pd(vp + 24, _mm512_unpackhi_pd(pr1, pi1));
+	if (withDerivative) {
+		_mm512_storeu_pd(dp, _mm512_unpacklo_pd(dr0, di0));
+		_mm512_storeu_pd(dp + 8, _mm512_unpackhi_pd(dr0, di0));
+		_mm512_storeu_pd(dp + 16, _mm512_unpacklo_pd(dr1, di1));
+		_mm512_storeu_pd(dp + 24, _mm512_unpackhi_pd(dr1, di1));
+	}
+}
+
+TARGET_AVX512 static void horner_avx512(size_t degree, const cd* a, size_t n, const cd* x, cd* values, cd* derivatives)
+{
+	const double* xp = reinterpret_cast<const double*>(x);
+	double* vp = reinterpret_cast<double*>(values);
+	double* dp = reinterpret_cast<double*>(derivatives);
+	size_t i = 0;
+	for (; i + 16 <= n; i += 16) {
+		if (derivatives != nullptr)
+			avx512_horner_block<true>(degree, a, xp + 2 * i, vp + 2 * i, dp + 2 * i);
+		else
+			avx512_horner_block<false>(degree, a, xp + 2 * i, vp + 2 * i, nullptr);
+	}
+	horner_scalar(degree, a, n - i, x + i, values + i, derivatives != nullptr ? derivatives + i : nullptr);
+}
+
+static const ComplexKernelTable avx512Table = {
+	axpy_avx512, add_avx512, sub_avx512, scale_avx512, dot_avx512, gemm_micro_avx512, horner_avx512
+};
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+// ---------------------------------------------------------------------------
+// CPU feature detection
+
+static void cpuid(unsigned leaf, unsigned subleaf, unsigned regs[4])
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+	int info[4];
+	__cpuidex(info, (int)leaf, (int)subleaf);
+	for (int i = 0; i < 4; i++)
+		regs[i] = (unsigned)info[i];
+#else
+	__cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+// Register state the OS saves on context switch (XCR0)
+static unsigned long long xgetbv0()
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+	return _xgetbv(0);
+#else
+	unsigned eax, edx;
+	__asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+	return ((unsigned long long)edx << 32) | eax;
+#endif
+}
+
+#endif // COMPLEX_KERNELS_X86
+
+SimdLevel ComplexKernels::DetectLevel()
+{
+#ifdef COMPLEX_KERNELS_X86
+	unsigned regs[4];
+	cpuid(0, 0, regs);
+	unsigned maxLeaf = regs[0];
+
+	cpuid(1, 0, regs);
+	bool sse2 = (regs[3] >> 26) & 1;
+	bool fma = (regs[2] >> 12) & 1;
+	bool osxsave = (regs[2] >> 27) & 1;
+	bool avx = (regs[2] >> 28) & 1;
+	if (!sse2)
+		return SIMD_SCALAR;
+	if (!osxsave || !avx || !fma || maxLeaf < 7)
+		return SIMD_SSE2;
+
+	unsigned long long xcr0 = xgetbv0();
+	// XMM and YMM state
+	if ((xcr0 & 0x6) != 0x6)
+		return SIMD_SSE2;
+
+	cpuid(7, 0, regs);
+	bool avx2 = (regs[1] >> 5) & 1;
+	bool avx512f = (regs[1] >> 16) & 1;
+	bool avx512dq = (regs[1] >> 17) & 1;
+	if (!avx2)
+		return SIMD_SSE2;
+	// Opmask, upper ZMM0-15 and ZMM16-31 state
+	if (avx512f && avx512dq && (xcr0 & 0xE0) == 0xE0)
+		return SIMD_AVX512;
+	return SIMD_AVX2;
+#else
+	return SIMD_SCALAR;
+#endif
+}
+
+static const ComplexKernelTable* TableFor(SimdLevel level)
+{
+#ifdef COMPLEX_KERNELS_X86
+	switch (level)
+	{
+		case SIMD_AVX512:
+			return &avx512Table;
+		case SIMD_AVX2:
+			return &avx2Table;
+		case SIMD_SSE2:
+			return &sse2Table;
+		default:
+			return &scalarTable;
+	}
+#else
+	return &scalarTable;
+#endif
+}
+
+static std::atomic<int> selectedLevel(-1);
+
+SimdLevel ComplexKernels::Level()
+{
+	int level = selectedLevel.load(std::memory_order_acquire);
+	if (level < 0) {
+		level = DetectLevel();
+		selectedLevel.store(level, std::memory_order_release);
+	}
+	return (SimdLevel)level;
+}
+
+const ComplexKernelTable& ComplexKernels::Get()
+{
+	return *TableFor(Level());
+}
+
+void ComplexKernels::Select(SimdLevel level)
+{
+	SimdLevel detected = DetectLevel();
+	selectedLevel.store(level < detected ? level : detected, std::memory_order_release);
+}
+
+const char* ComplexKernels::LevelName(SimdLevel level)
+{
+	switch (level)
+	{
+		case SIMD_AVX512:
+			return "AVX-512";
+		case SIMD_AVX2:
+			return "AVX2+FMA";
+		case SIMD_SSE2:
+			return "SSE2";
+		default:
+			return "scalar";
+	}
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <complex>
+#include <cstddef>
+
+// Instruction set levels the complex kernels are built for
+enum SimdLevel
+{
+	SIMD_SCALAR = 0,
+	SIMD_SSE2 = 1,
+	SIMD_AVX2 = 2,
+	SIMD_AVX512 = 3
+};
+
+// Hand-vectorized kernels over arrays of complex<double>. The arithmetic
+// is the textbook one, without the inf/nan recovery of std::complex.
+struct ComplexKernelTable
+{
+	// y[i] += alpha * x[i]
+	void (*axpy)(size_t n, std::complex<double> alpha, const std::complex<double>* x, std::complex<double>* y);
+	// r[i] = x[i] + y[i]
+	void (*add)(size_t n, const std::complex<double>* x, const std::complex<double>* y, std::complex<double>* r);
+	// r[i] = x[i] - y[i]
+	void (*sub)(size_t n, const std::complex<double>* x, const std::complex<double>* y, std::complex<double>* r);
+	// r[i] = alpha * x[i]
+	void (*scale)(size_t n, std::complex<double> alpha, const std::complex<double>* x, std::complex<double>* r);
+	// sum of x[i] * y[i], without conjugation
+	std::complex<double> (*dot)(size_t n, const std::complex<double>* x, const std::complex<double>* y);
+	// GEMM micro-kernel over the panels packed by ComplexMicroKernel
+	void (*gemm_micro)(unsigned kc, const double* ap, const double* bp, std::complex<double>* c, unsigned ldc, unsigned mr, unsigned nr);
+	// values[i] = P(x[i]) for P = a[0] + a[1] x + ... + a[degree] x^degree by
+	// Horner's rule, and derivatives[i] = P'(x[i]) unless derivatives is null
+	void (*horner)(size_t degree, const std::complex<double>* a, size_t n, const std::complex<double>* x, std::complex<double>* values, std::complex<double>* derivatives);
+};
+
+// Runtime dispatch of the complex kernels by the CPUID of the host
+class ComplexKernels
+{
+public:
+	// Kernels for the selected level, detected on first use
+	static const ComplexKernelTable& Get();
+	static SimdLevel Level();
+
+	// Best level supported by the CPU and the OS
+	static SimdLevel DetectLevel();
+
+	// Force a level (e.g. for comparisons), clamped to the detected one
+	static void Select(SimdLevel level);
+
+	static const char* LevelName(SimdLevel level);
+};
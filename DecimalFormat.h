@@ -0,0 +1,78 @@
+#pragma once
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "BigIntKernels.h"
+
+// Decimal digits of machine words written straight into a caller's buffer,
+// two digits per division and table lookup, with no intermediate strings,
+// and read back two digits per step.
+
+// "00" "01" .. "99"
+static const char DECIMAL_DIGIT_PAIRS[] =
+	"00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+	"40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+	"8081828384858687888990919293949596979899";
+
+// Most decimal digits of a 64-bit value
+static const unsigned UINT64_DECIMAL_DIGITS = 20;
+
+// 10^0 .. 10^19
+static const uint64_t UINT64_POWERS_OF_TEN[UINT64_DECIMAL_DIGITS] = {
+	1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL,
+	100000000ULL, 1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL,
+	10000000000000ULL, 100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL,
+	100000000000000000ULL, 1000000000000000000ULL, 10000000000000000000ULL
+};
+
+// Number of decimal digits of value, 1 for 0
+inline unsigned decimal_digit_count(uint64_t value)
+{
+	// floor(bits log10(2)), log10(2) ~ 1233 / 4096, is the digit count or one
+	// below it. value | 1 counts 0 as 1
+	uint64_t odd = value | 1;
+	unsigned estimate = ((64 - limb_leading_zeros(odd)) * 1233) >> 12;
+	return estimate + 1 - (odd < UINT64_POWERS_OF_TEN[estimate] ? 1 : 0);
+}
+
+// Writes value < 10^width as exactly width digits, zero-padded; returns width
+inline size_t format_decimal_padded(char* buffer, uint64_t value, size_t width)
+{
+	char* position = buffer + width;
+	while (position - buffer >= 2) {
+		position -= 2;
+		memcpy(position, DECIMAL_DIGIT_PAIRS + 2 * (value % 100), 2);
+		value /= 100;
+	}
+	if (position != buffer)
+		*buffer = (char)('0' + value);
+	return width;
+}
+
+// Writes the digits of value without leading zeros ("0" for 0); returns their
+// number, at most UINT64_DECIMAL_DIGITS
+inline size_t format_decimal(char* buffer, uint64_t value)
+{
+	return format_decimal_padded(buffer, value, decimal_digit_count(value));
+}
+
+// Value of count <= 19 decimal digits, two per step
+inline uint64_t parse_decimal(const char* digits, size_t count)
+{
+	assert(count < UINT64_DECIMAL_DIGITS);
+	uint64_t value = 0;
+	size_t i = 0;
+	if (count % 2 != 0) {
+		assert(digits[0] >= '0' && digits[0] <= '9' && "not a decimal digit");
+		value = (uint64_t)(digits[0] - '0');
+		i = 1;
+	}
+	for (; i < count; i += 2) {
+		unsigned high = (unsigned)(digits[i] - '0');
+		unsigned low = (unsigned)(digits[i + 1] - '0');
+		assert(high <= 9 && low <= 9 && "not a decimal digit");
+		value = value * 100 + high * 10 + low;
+	}
+	return value;
+}
@@ -4,9 +4,25 @@
 #include <complex>
 #include <random>
 #include <assert.h>
+#include "HermitianEigen.h"
+#include "HessenbergQR.h"
+#include "Toeplitz.h"
 
 using namespace std;
 
+//    
+enum EigenMethod
+{
+	//    
+	EIGEN_BERKOWITZ = 0,
+	// QR     (. HessenbergQR.h)
+	EIGEN_HESSENBERG_QR = 1,
+	//   QL    (. HermitianEigen.h)
+	EIGEN_HERMITIAN = 2,
+	// EIGEN_HERMITIAN   ,  EIGEN_HESSENBERG_QR
+	EIGEN_AUTO = 3
+};
+
 class Eigenvalues
 {
 public:
@@ -69,12 +85,7 @@ public:
 	//    
 	QSMatrix <complex<double>> GetMatrixPow(const QSMatrix <complex<double>> &matrix, int matrixDegree)
 	{
-		QSMatrix <complex<double>> powMatrix = matrix;
-		for (int i = 1; i < matrixDegree; i++) {
-			powMatrix = powMatrix * matrix;
-		}
-
-		return powMatrix;
+		return pow(matrix, matrixDegree);
 	}
 
 	//    
@@ -82,17 +93,11 @@ public:
 	{
 		int aSize = a.size();
 		int bSize = b.size();
-		complex<double> result(0, 0);
-
 		if (aSize != bSize) {
 			assert("Vectors sizes are not equal");
 		}
 
-		for (int i = 0; i < aSize; i++) {
-			result += a[i] * b[i];
-		}
-
-		return result;
+		return row_dot(aSize, a.data(), b.data());
 	}
 
 	//    
@@ -106,16 +111,12 @@ public:
 			assert("Vector size doesn't match matrix count rows");
 		}
 
-		vector<complex<double>> result;
+		vector<complex<double>> result(matrixCols, 0);
 
-		for (int i = 0; i < matrixCols; i++)
+		//    : result += r[j] * A[j]
+		for (int j = 0; j < matrixRows; j++)
 		{
-			complex<double> temp(0, 0);
-			for (int j = 0; j < matrixRows; j++)
-			{
-				temp += rVector[j] * lMatrix(j, i);
-			}
-			result.push_back(temp);
+			row_axpy(matrixCols, rVector[j], lMatrix.data() + j * lMatrix.stride(), result.data());
 		}
 
 		return result;
@@ -134,7 +135,45 @@ public:
 		return -result;
 	}
 
+	//    T : 1, -a11, -R*C, -R*A1*C, ..., -R*A1^(n-2)*C
+	//   R*A1^k       ,
+	//          O(n^2)
+	vector <complex<double>> GetTColumn(const QSMatrix <complex<double>> &matrixInstance)
+	{
+		int matrixSize = matrixInstance.get_rows();
+		vector <complex<double>> tColumn(matrixSize + 1, 0);
+		tColumn[0] = 1;
+		tColumn[1] = -matrixInstance(0, 0);
+
+		if (matrixSize == 1)
+		{
+			return tColumn;
+		}
+
+		QSMatrix <complex<double>> subMatrix = this->GetSubmatrix(matrixInstance);
+		vector <complex<double>> cVector = this->GetCVector(matrixInstance);
+		int subMatrixSize = subMatrix.get_rows();
+
+		// krylovVector = R*A1^k, nextVector -   R*A1^(k+1)
+		vector <complex<double>> krylovVector = this->GetRVector(matrixInstance);
+		vector <complex<double>> nextVector(subMatrixSize, 0);
+
+		for (int k = 0; k + 2 <= matrixSize; k++) {
+			if (k > 0) {
+				fill(nextVector.begin(), nextVector.end(), complex<double>(0, 0));
+				for (int j = 0; j < subMatrixSize; j++) {
+					row_axpy(subMatrixSize, krylovVector[j], subMatrix.data() + j * subMatrix.stride(), nextVector.data());
+				}
+				krylovVector.swap(nextVector);
+			}
+			tColumn[k + 2] = -this->VectorComposition(krylovVector, cVector);
+		}
+
+		return tColumn;
+	}
+
 	//     
+	//  Ҹ:  (i, j)   i - j   
 	QSMatrix <complex<double>> GetTSubMatrix(const QSMatrix <complex<double>> &matrixInstance)
 	{
 		int matrixRows = matrixInstance.get_rows();
@@ -153,43 +192,12 @@ public:
 
 		int tMatrixRows = matrixSize + 1;
 		int tMatrixCols = matrixSize;
-		complex<double> tMatrixFirstElement = -matrixInstance(0, 0);
+		vector <complex<double>> tColumn = this->GetTColumn(matrixInstance);
 		QSMatrix <complex<double>> tMatrix(tMatrixRows, tMatrixCols, 0);
 
-		if (matrixSize == 1)
-		{
-			tMatrix(0, 0) = 1;
-			tMatrix(1, 0) = tMatrixFirstElement;
-			return tMatrix;
-		}
-
-		QSMatrix <complex<double>> subMatrix = this->GetSubmatrix(matrixInstance);
-		vector <complex<double>> rVector = this->GetRVector(matrixInstance);
-		vector <complex<double>> cVector = this->GetCVector(matrixInstance);
-
-		for (int i = 0; i < tMatrixRows; i++) {
-			for (int j = 0; j < tMatrixCols; j++) {
-				//    
-				if (i < j) {
-					tMatrix(i, j) = 0;
-					continue;
-				}
-
-				//    
-				if (i == j) {
-					tMatrix(i, j) = 1;
-					continue;
-				}
-
-				//    
-				if (i - 1 == j || j + 1 == i) {
-					tMatrix(i, j) = tMatrixFirstElement;
-					continue;
-				}
-
-				//    -R*A1^(k-2)*C
-				int kDiagonal = (i - j) - 2;
-				tMatrix(i, j) = this->GetDiagonalComposition(rVector, cVector, subMatrix, kDiagonal);
+		for (int j = 0; j < tMatrixCols; j++) {
+			for (int i = j; i < tMatrixRows; i++) {
+				tMatrix(i, j) = tColumn[i - j];
 			}
 		}
 
@@ -197,32 +205,58 @@ public:
 	}
 
 	//     
+	// T       , 
+	//      (. Toeplitz.h)
 	Polynomial <complex<double>> GetEigenPolynomial(const QSMatrix <complex<double>> &matrix)
 	{
 		QSMatrix <complex<double>> processingMatrix = matrix;
-		vector <QSMatrix<complex<double>>> tMatrixes;
+		vector <LowerToeplitz<complex<double>>> tMatrixes;
 
 		while (processingMatrix.get_rows() > 1 && processingMatrix.get_cols() > 1)
 		{
-			QSMatrix <complex<double>> tMatrix = this->GetTSubMatrix(processingMatrix);
+			unsigned matrixSize = processingMatrix.get_rows();
+			tMatrixes.push_back(LowerToeplitz<complex<double>>(matrixSize + 1, matrixSize, this->GetTColumn(processingMatrix)));
 			processingMatrix = this->GetSubmatrix(processingMatrix);
-			tMatrixes.push_back(tMatrix);
 		}
 
-		QSMatrix <complex<double>> tMatrix = this->GetTSubMatrix(processingMatrix);
-		tMatrixes.push_back(tMatrix);
+		tMatrixes.push_back(LowerToeplitz<complex<double>>(2, 1, this->GetTColumn(processingMatrix)));
+
+		vector <complex<double>> coeffColumn = toeplitz_chain_column(tMatrixes);
+		vector <complex<double>> coeffVector(coeffColumn.rbegin(), coeffColumn.rend());
+
+		return Polynomial <complex<double>> (coeffVector);
+	}
 
-		QSMatrix <complex<double>> coeffMatrix = tMatrixes[0];
-		vector <complex<double>> coeffVector;
+	//       
+	//  eigenvectors  ,   i-   
+	//  i- 
+	vector <double> GetHermitianEigenvalues(const QSMatrix <complex<double>> &matrix, QSMatrix <complex<double>> *eigenvectors = nullptr)
+	{
+		vector <double> eigenvalues;
+		bool converged = hermitian_eigen(matrix, eigenvalues, eigenvectors);
+		assert(converged && "QL iteration did not converge");
+		(void)converged;
+		return eigenvalues;
+	}
 
-		for (int i = 1; i < tMatrixes.size(); i++) {
-			coeffMatrix = coeffMatrix * tMatrixes[i];
+	//    
+	//      :  
+	//     
+	vector <complex<double>> GetEigenvalues(const QSMatrix <complex<double>> &matrix, EigenMethod method = EIGEN_AUTO)
+	{
+		if (method == EIGEN_BERKOWITZ) {
+			return this->GetEigenPolynomial(matrix).FindComplexRoots();
 		}
 
-		for (int i = coeffMatrix.get_rows() - 1; i >= 0; i--) {
-			coeffVector.push_back(coeffMatrix(i, 0));
+		if (method == EIGEN_HERMITIAN || (method == EIGEN_AUTO && is_hermitian(matrix))) {
+			vector <double> realEigenvalues = this->GetHermitianEigenvalues(matrix);
+			return vector <complex<double>>(realEigenvalues.begin(), realEigenvalues.end());
 		}
-		
-		return Polynomial <complex<double>> (coeffVector);
+
+		vector <complex<double>> eigenvalues;
+		bool converged = hessenberg_qr_eigenvalues(matrix, eigenvalues);
+		assert(converged && "QR iteration did not converge");
+		(void)converged;
+		return eigenvalues;
 	}
 };
\ No newline at end of file
@@ -0,0 +1,188 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include "ThreadPool.h"
+
+// Radix-4 FFT and convolution of coefficient sequences.
+
+// Settings of convolve() for complex<double>
+struct ConvolutionSettings
+{
+	// Use FFT for long operands. It is O(n log n) instead of O(n^2) but its
+	// error is relative to the largest coefficient, so small coefficients
+	// next to huge ones lose precision; off by default
+	bool fft;
+	// Both operands must have at least this many terms to go through FFT
+	size_t fftThreshold;
+
+	static ConvolutionSettings& Instance()
+	{
+		static ConvolutionSettings settings = { false, 64 };
+		return settings;
+	}
+};
+
+// Twiddle factors e^(-2 pi i k / n), k < n / 2, of a transform of size n.
+// Every factor comes straight from cos/sin, without accumulated rounding.
+// They are computed on the first transform of each size and kept, the
+// returned table never changes afterwards
+inline const std::vector<std::complex<double>>& fft_twiddles(size_t n)
+{
+	static std::mutex mutex;
+	static std::map<size_t, std::unique_ptr<std::vector<std::complex<double>>>> cache;
+	std::lock_guard<std::mutex> lock(mutex);
+	std::unique_ptr<std::vector<std::complex<double>>>& entry = cache[n];
+	if (!entry) {
+		const double pi = std::acos(-1.0);
+		entry.reset(new std::vector<std::complex<double>>(n / 2));
+		for (size_t k = 0; k < n / 2; k++) {
+			double angle = 2 * pi * k / n;
+			(*entry)[k] = std::complex<double>(std::cos(angle), -std::sin(angle));
+		}
+	}
+	return *entry;
+}
+
+// x * y without the inf/nan recovery of std::complex
+inline std::complex<double> fft_multiply(std::complex<double> x, std::complex<double> y)
+{
+	return std::complex<double>(x.real() * y.real() - x.imag() * y.imag(), x.real() * y.imag() + x.imag() * y.real());
+}
+
+// In-place iterative FFT, a.size() must be a power of two. The inverse
+// transform is not scaled by 1 / n. After the bit reversal, pairs of
+// radix-2 stages are fused into radix-4 passes (one radix-2 pass first
+// when log2 n is odd), halving the sweeps over the data
+inline void fft(std::vector<std::complex<double>>& a, bool inverse)
+{
+	typedef std::complex<double> cd;
+	size_t n = a.size();
+	for (size_t i = 1, j = 0; i < n; i++) {
+		size_t bit = n >> 1;
+		for (; j & bit; bit >>= 1) {
+			j ^= bit;
+		}
+		j ^= bit;
+		if (i < j)
+			std::swap(a[i], a[j]);
+	}
+
+	const std::vector<cd>& roots = fft_twiddles(n);
+	unsigned levels = 0;
+	while ((size_t(1) << levels) < n) {
+		levels++;
+	}
+
+	// Size of the sub-transforms already done
+	size_t m = 1;
+	if (levels % 2 == 1) {
+		for (size_t start = 0; start < n; start += 2) {
+			cd u = a[start];
+			cd v = a[start + 1];
+			a[start] = u + v;
+			a[start + 1] = u - v;
+		}
+		m = 2;
+	}
+
+	// Four sub-transforms of size m into one of size 4m: two radix-2 stages
+	// with twiddles w1 = w_2m^k and w2 = w_4m^k, w_4m^(k + m) = w2 * (-i)
+	for (; 4 * m <= n; m *= 4) {
+		size_t step = n / (4 * m);
+		for (size_t start = 0; start < n; start += 4 * m) {
+			for (size_t k = 0; k < m; k++) {
+				cd w1 = roots[2 * k * step];
+				cd w2 = roots[k * step];
+				if (inverse) {
+					w1 = std::conj(w1);
+					w2 = std::conj(w2);
+				}
+				cd* x = &a[start + k];
+				cd t1 = fft_multiply(w1, x[m]);
+				cd t3 = fft_multiply(w1, x[3 * m]);
+				cd b0 = x[0] + t1;
+				cd b1 = x[0] - t1;
+				cd b2 = fft_multiply(w2, x[2 * m] + t3);
+				cd b3 = fft_multiply(w2, x[2 * m] - t3);
+				// -i * b3 forward, i * b3 inverse
+				b3 = inverse ? cd(-b3.imag(), b3.real()) : cd(b3.imag(), -b3.real());
+				x[0] = b0 + b2;
+				x[2 * m] = b0 - b2;
+				x[m] = b1 + b3;
+				x[3 * m] = b1 - b3;
+			}
+		}
+	}
+}
+
+// First maxLength terms of the convolution of a and b (the coefficients of
+// the product of two polynomials). Every term is an independent dot
+// product, long convolutions split them between the pool threads
+template <typename T>
+std::vector<T> convolve(const std::vector<T>& a, const std::vector<T>& b, size_t maxLength)
+{
+	if (a.empty() || b.empty())
+		return std::vector<T>(maxLength, T());
+
+	size_t length = std::min(maxLength, a.size() + b.size() - 1);
+	std::vector<T> result(maxLength, T());
+	size_t grain = std::max<size_t>(1, PARALLEL_MIN_ELEMENTS / std::min(a.size(), b.size()));
+	ThreadPool::Instance().ParallelFor(length, grain, [&](size_t begin, size_t end) {
+		for (size_t k = begin; k < end; k++) {
+			size_t first = k >= b.size() ? k - b.size() + 1 : 0;
+			size_t last = std::min(k, a.size() - 1);
+			T sum = T();
+			for (size_t i = first; i <= last; i++) {
+				sum = sum + a[i] * b[k - i];
+			}
+			result[k] = sum;
+		}
+	});
+	return result;
+}
+
+// Same through FFT
+inline std::vector<std::complex<double>> convolve_fft(const std::vector<std::complex<double>>& a, const std::vector<std::complex<double>>& b, size_t maxLength)
+{
+	typedef std::complex<double> cd;
+	if (a.empty() || b.empty())
+		return std::vector<cd>(maxLength, cd());
+
+	size_t length = std::min(maxLength, a.size() + b.size() - 1);
+	size_t size = 1;
+	while (size < a.size() + b.size() - 1) {
+		size <<= 1;
+	}
+
+	std::vector<cd> fa(a.begin(), a.end());
+	std::vector<cd> fb(b.begin(), b.end());
+	fa.resize(size);
+	fb.resize(size);
+	fft(fa, false);
+	fft(fb, false);
+	for (size_t i = 0; i < size; i++) {
+		fa[i] *= fb[i];
+	}
+	fft(fa, true);
+
+	std::vector<cd> result(maxLength, cd());
+	for (size_t i = 0; i < length; i++) {
+		result[i] = fa[i] / (double)size;
+	}
+	return result;
+}
+
+inline std::vector<std::complex<double>> convolve(const std::vector<std::complex<double>>& a, const std::vector<std::complex<double>>& b, size_t maxLength)
+{
+	const ConvolutionSettings& settings = ConvolutionSettings::Instance();
+	if (settings.fft && a.size() >= settings.fftThreshold && b.size() >= settings.fftThreshold)
+		return convolve_fft(a, b, maxLength);
+	return convolve<std::complex<double>>(a, b, maxLength);
+}
@@ -0,0 +1,184 @@
+#pragma once
+#include <cassert>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+#include "QSMatrix.h"
+
+// Matrix of compile-time size R x C stored in place (on the stack for
+// locals). Every operation is expanded over index sequences, so a 2x2
+// product compiles down to eight multiplications and four additions with
+// no loops, no heap and no stride arithmetic.
+template <typename T, unsigned R, unsigned C>
+class FixedMatrix
+{
+public:
+	typedef T value_type;
+
+	T elements[R * C];
+
+	// All elements value-initialized (zero for arithmetic types)
+	constexpr FixedMatrix() : elements{} {}
+
+	// Elements in row-major order: FixedMatrix<int, 2, 2> m(1, 1, 1, 0)
+	template <typename... Args, typename = typename std::enable_if<sizeof...(Args) == R * C
+		&& (std::is_convertible<const Args&, T>::value && ...)>::type>
+	constexpr FixedMatrix(const Args&... args) : elements{ T(args)... } {}
+
+	// Copies a QSMatrix of the same size
+	explicit FixedMatrix(const QSMatrix<T>& matrix) : FixedMatrix(checked_size(matrix), std::make_index_sequence<R * C>()) {}
+
+	static constexpr unsigned get_rows() { return R; }
+	static constexpr unsigned get_cols() { return C; }
+
+	constexpr T& operator()(unsigned row, unsigned col) { return elements[row * C + col]; }
+	constexpr const T& operator()(unsigned row, unsigned col) const { return elements[row * C + col]; }
+
+	// Unit matrix: ones on the main diagonal
+	static constexpr FixedMatrix identity()
+	{
+		return identity(std::make_index_sequence<R * C>());
+	}
+
+	// Copy into a heap matrix
+	QSMatrix<T> to_matrix() const
+	{
+		QSMatrix<T> result(R, C, T());
+		for (unsigned i = 0; i < R; i++) {
+			for (unsigned j = 0; j < C; j++) {
+				result(i, j) = (*this)(i, j);
+			}
+		}
+		return result;
+	}
+
+	constexpr FixedMatrix<T, C, R> transpose() const
+	{
+		return transpose(std::make_index_sequence<R * C>());
+	}
+
+private:
+	// The size is checked before the element-wise copy reads any element
+	static const QSMatrix<T>& checked_size(const QSMatrix<T>& matrix)
+	{
+		assert(matrix.get_rows() == R && matrix.get_cols() == C && "QSMatrix size differs from FixedMatrix size");
+		return matrix;
+	}
+
+	template <size_t... I>
+	FixedMatrix(const QSMatrix<T>& matrix, std::index_sequence<I...>) : elements{ matrix(I / C, I % C)... } {}
+
+	template <size_t... I>
+	static constexpr FixedMatrix identity(std::index_sequence<I...>)
+	{
+		return FixedMatrix(T(I / C == I % C ? 1 : 0)...);
+	}
+
+	template <size_t... I>
+	constexpr FixedMatrix<T, C, R> transpose(std::index_sequence<I...>) const
+	{
+		return FixedMatrix<T, C, R>(elements[(I % R) * C + I / R]...);
+	}
+};
+
+namespace fixed_matrix_detail
+{
+	template <typename Op, typename T, unsigned R, unsigned C, size_t... I>
+	constexpr FixedMatrix<T, R, C> elementwise(const FixedMatrix<T, R, C>& lhs, const FixedMatrix<T, R, C>& rhs, Op op, std::index_sequence<I...>)
+	{
+		return FixedMatrix<T, R, C>(op(lhs.elements[I], rhs.elements[I])...);
+	}
+
+	template <typename T, unsigned R, unsigned C, size_t... I>
+	constexpr FixedMatrix<T, R, C> scale(const FixedMatrix<T, R, C>& lhs, const T& rhs, std::index_sequence<I...>)
+	{
+		return FixedMatrix<T, R, C>((lhs.elements[I] * rhs)...);
+	}
+
+	// Element (Row, Col) of a product: a fold over the inner dimension
+	template <size_t Row, size_t Col, typename T, unsigned R, unsigned K, unsigned C, size_t... Ks>
+	constexpr T product_element(const FixedMatrix<T, R, K>& lhs, const FixedMatrix<T, K, C>& rhs, std::index_sequence<Ks...>)
+	{
+		return (... + (lhs.elements[Row * K + Ks] * rhs.elements[Ks * C + Col]));
+	}
+
+	template <typename T, unsigned R, unsigned K, unsigned C, size_t... I>
+	constexpr FixedMatrix<T, R, C> product(const FixedMatrix<T, R, K>& lhs, const FixedMatrix<T, K, C>& rhs, std::index_sequence<I...>)
+	{
+		return FixedMatrix<T, R, C>(product_element<I / C, I % C>(lhs, rhs, std::make_index_sequence<K>())...);
+	}
+
+	struct Add
+	{
+		template <typename T>
+		constexpr T operator()(const T& a, const T& b) const { return a + b; }
+	};
+
+	struct Sub
+	{
+		template <typename T>
+		constexpr T operator()(const T& a, const T& b) const { return a - b; }
+	};
+}
+
+template <typename T, unsigned R, unsigned C>
+constexpr FixedMatrix<T, R, C> operator+(const FixedMatrix<T, R, C>& lhs, const FixedMatrix<T, R, C>& rhs)
+{
+	return fixed_matrix_detail::elementwise(lhs, rhs, fixed_matrix_detail::Add(), std::make_index_sequence<R * C>());
+}
+
+template <typename T, unsigned R, unsigned C>
+constexpr FixedMatrix<T, R, C> operator-(const FixedMatrix<T, R, C>& lhs, const FixedMatrix<T, R, C>& rhs)
+{
+	return fixed_matrix_detail::elementwise(lhs, rhs, fixed_matrix_detail::Sub(), std::make_index_sequence<R * C>());
+}
+
+template <typename T, unsigned R, unsigned C>
+constexpr FixedMatrix<T, R, C> operator*(const FixedMatrix<T, R, C>& lhs, const T& rhs)
+{
+	return fixed_matrix_detail::scale(lhs, rhs, std::make_index_sequence<R * C>());
+}
+
+template <typename T, unsigned R, unsigned K, unsigned C>
+constexpr FixedMatrix<T, R, C> operator*(const FixedMatrix<T, R, K>& lhs, const FixedMatrix<T, K, C>& rhs)
+{
+	return fixed_matrix_detail::product(lhs, rhs, std::make_index_sequence<R * C>());
+}
+
+template <typename T, unsigned R, unsigned C>
+constexpr bool operator==(const FixedMatrix<T, R, C>& lhs, const FixedMatrix<T, R, C>& rhs)
+{
+	for (unsigned i = 0; i < R * C; i++) {
+		if (!(lhs.elements[i] == rhs.elements[i]))
+			return false;
+	}
+	return true;
+}
+
+// Products of a fixed-size matrix and a heap matrix of matching size
+template <typename T, unsigned R, unsigned C>
+QSMatrix<T> operator*(const FixedMatrix<T, R, C>& lhs, const QSMatrix<T>& rhs)
+{
+	return lhs.to_matrix() * rhs;
+}
+
+template <typename T, unsigned R, unsigned C>
+QSMatrix<T> operator*(const QSMatrix<T>& lhs, const FixedMatrix<T, R, C>& rhs)
+{
+	return lhs * rhs.to_matrix();
+}
+
+// Power by repeated squaring, pow(A, 0) is the identity
+template <typename T, unsigned N>
+constexpr FixedMatrix<T, N, N> pow(FixedMatrix<T, N, N> base, unsigned exponent)
+{
+	FixedMatrix<T, N, N> result = FixedMatrix<T, N, N>::identity();
+	while (exponent > 0) {
+		if (exponent & 1)
+			result = result * base;
+		exponent >>= 1;
+		if (exponent > 0)
+			base = base * base;
+	}
+	return result;
+}
@@ -0,0 +1,281 @@
+#pragma once
+#include <algorithm>
+#include <complex>
+#include <vector>
+#include "AlignedAllocator.h"
+#include "ComplexKernels.h"
+#include "ThreadPool.h"
+
+// Matrix multiplication kernels working on raw row-major blocks.
+// All of them compute C += A * B where A is m x k, B is k x n and
+// lda, ldb, ldc are the row strides of the blocks.
+
+// Products below this many multiply-adds skip the packing step
+static constexpr unsigned long long GEMM_SMALL_SIZE = 8 * 8 * 8;
+
+// Generic kernel for element types without a packed kernel (LongPlusPlus etc.).
+// Walks the rows of B contiguously and keeps a block of B hot in cache.
+template <typename T>
+void gemm_generic(unsigned m, unsigned n, unsigned k, const T* a, unsigned lda, const T* b, unsigned ldb, T* c, unsigned ldc)
+{
+	const unsigned KC = 128;
+	for (unsigned pc = 0; pc < k; pc += KC) {
+		unsigned kc = std::min(KC, k - pc);
+		for (unsigned i = 0; i < m; i++) {
+			const T* aRow = a + (size_t)i * lda + pc;
+			T* cRow = c + (size_t)i * ldc;
+			for (unsigned p = 0; p < kc; p++) {
+				const T& aik = aRow[p];
+				const T* bRow = b + (size_t)(pc + p) * ldb;
+				for (unsigned j = 0; j < n; j++) {
+					cRow[j] = cRow[j] + aik * bRow[j];
+				}
+			}
+		}
+	}
+}
+
+// Kernel selection by element type, specialized below for the packed kernels
+template <typename T>
+struct GemmKernel
+{
+	static void multiply(unsigned m, unsigned n, unsigned k, const T* a, unsigned lda, const T* b, unsigned ldb, T* c, unsigned ldc)
+	{
+		gemm_generic(m, n, k, a, lda, b, ldb, c, ldc);
+	}
+};
+
+// Register micro-kernel for double: a MR x NR block of C is kept in
+// accumulators while A and B are streamed from packed panels.
+struct DoubleMicroKernel
+{
+	typedef double value_type;
+	static constexpr unsigned MR = 4;
+	static constexpr unsigned NR = 4;
+	static constexpr unsigned MC = 128;
+	static constexpr unsigned KC = 256;
+	static constexpr unsigned NC = 2048;
+	// Number of doubles one packed element takes
+	static constexpr unsigned WIDTH = 1;
+
+	// Pack MR-row slivers of A, column by column, zero-padding the tail
+	static void pack_a(unsigned mc, unsigned kc, const double* a, unsigned lda, double* ap)
+	{
+		for (unsigned ir = 0; ir < mc; ir += MR) {
+			unsigned mr = std::min(MR, mc - ir);
+			for (unsigned p = 0; p < kc; p++) {
+				for (unsigned i = 0; i < MR; i++) {
+					*ap++ = i < mr ? a[(size_t)(ir + i) * lda + p] : 0.0;
+				}
+			}
+		}
+	}
+
+	// Pack NR-column slivers of B, row by row, zero-padding the tail
+	static void pack_b(unsigned kc, unsigned nc, const double* b, unsigned ldb, double* bp)
+	{
+		for (unsigned jr = 0; jr < nc; jr += NR) {
+			unsigned nr = std::min(NR, nc - jr);
+			for (unsigned p = 0; p < kc; p++) {
+				const double* bRow = b + (size_t)p * ldb + jr;
+				for (unsigned j = 0; j < NR; j++) {
+					*bp++ = j < nr ? bRow[j] : 0.0;
+				}
+			}
+		}
+	}
+
+	static void micro(unsigned kc, const double* ap, const double* bp, double* c, unsigned ldc, unsigned mr, unsigned nr)
+	{
+		double acc[MR][NR] = {};
+		for (unsigned p = 0; p < kc; p++) {
+			for (unsigned i = 0; i < MR; i++) {
+				double aip = ap[i];
+				for (unsigned j = 0; j < NR; j++) {
+					acc[i][j] += aip * bp[j];
+				}
+			}
+			ap += MR;
+			bp += NR;
+		}
+
+		for (unsigned i = 0; i < mr; i++) {
+			double* cRow = c + (size_t)i * ldc;
+			for (unsigned j = 0; j < nr; j++) {
+				cRow[j] += acc[i][j];
+			}
+		}
+	}
+};
+
+// Register micro-kernel for complex<double>. A is packed as interleaved
+// (re, im) pairs, B as separate real and imaginary rows, so the inner loop
+// is plain double arithmetic without the std::complex special cases.
+struct ComplexMicroKernel
+{
+	typedef std::complex<double> value_type;
+	static constexpr unsigned MR = 4;
+	static constexpr unsigned NR = 4;
+	static constexpr unsigned MC = 64;
+	static constexpr unsigned KC = 128;
+	static constexpr unsigned NC = 1024;
+	static constexpr unsigned WIDTH = 2;
+
+	static void pack_a(unsigned mc, unsigned kc, const value_type* a, unsigned lda, double* ap)
+	{
+		for (unsigned ir = 0; ir < mc; ir += MR) {
+			unsigned mr = std::min(MR, mc - ir);
+			for (unsigned p = 0; p < kc; p++) {
+				for (unsigned i = 0; i < MR; i++) {
+					value_type value = i < mr ? a[(size_t)(ir + i) * lda + p] : value_type(0);
+					*ap++ = value.real();
+					*ap++ = value.imag();
+				}
+			}
+		}
+	}
+
+	static void pack_b(unsigned kc, unsigned nc, const value_type* b, unsigned ldb, double* bp)
+	{
+		for (unsigned jr = 0; jr < nc; jr += NR) {
+			unsigned nr = std::min(NR, nc - jr);
+			for (unsigned p = 0; p < kc; p++) {
+				const value_type* bRow = b + (size_t)p * ldb + jr;
+				for (unsigned j = 0; j < NR; j++) {
+					bp[j] = j < nr ? bRow[j].real() : 0.0;
+					bp[NR + j] = j < nr ? bRow[j].imag() : 0.0;
+				}
+				bp += 2 * NR;
+			}
+		}
+	}
+
+	// Vectorized variants are picked at runtime, see ComplexKernels
+	static void micro(unsigned kc, const double* ap, const double* bp, value_type* c, unsigned ldc, unsigned mr, unsigned nr)
+	{
+		ComplexKernels::Get().gemm_micro(kc, ap, bp, c, ldc, mr, nr);
+	}
+
+	static void micro_scalar(unsigned kc, const double* ap, const double* bp, value_type* c, unsigned ldc, unsigned mr, unsigned nr)
+	{
+		double accRe[MR][NR] = {};
+		double accIm[MR][NR] = {};
+		for (unsigned p = 0; p < kc; p++) {
+			const double* bRe = bp;
+			const double* bIm = bp + NR;
+			for (unsigned i = 0; i < MR; i++) {
+				double aRe = ap[2 * i];
+				double aIm = ap[2 * i + 1];
+				for (unsigned j = 0; j < NR; j++) {
+					accRe[i][j] += aRe * bRe[j] - aIm * bIm[j];
+					accIm[i][j] += aRe * bIm[j] + aIm * bRe[j];
+				}
+			}
+			ap += 2 * MR;
+			bp += 2 * NR;
+		}
+
+		for (unsigned i = 0; i < mr; i++) {
+			value_type* cRow = c + (size_t)i * ldc;
+			for (unsigned j = 0; j < nr; j++) {
+				cRow[j] += value_type(accRe[i][j], accIm[i][j]);
+			}
+		}
+	}
+};
+
+// Cache-blocked driver around a micro-kernel: B is packed in KC x NC panels
+// (L2/L3 resident), A in MC x KC blocks (L2 resident), and the micro-kernel
+// sweeps MR x NR tiles of C out of them.
+template <typename Kernel>
+struct PackedGemm
+{
+	typedef typename Kernel::value_type T;
+	typedef std::vector<double, AlignedAllocator<double>> Buffer;
+
+	static void multiply(unsigned m, unsigned n, unsigned k, const T* a, unsigned lda, const T* b, unsigned ldb, T* c, unsigned ldc)
+	{
+		if ((unsigned long long)m * n * k <= GEMM_SMALL_SIZE) {
+			gemm_generic(m, n, k, a, lda, b, ldb, c, ldc);
+			return;
+		}
+
+		// Packing buffers are kept per thread and only ever grow
+		thread_local Buffer aPacked;
+		thread_local Buffer bPacked;
+		const unsigned MR = Kernel::MR;
+		const unsigned NR = Kernel::NR;
+		size_t aSize = (size_t)(std::min(Kernel::MC, m) + MR - 1) / MR * MR * Kernel::KC * Kernel::WIDTH;
+		size_t bSize = (size_t)(std::min(Kernel::NC, n) + NR - 1) / NR * NR * Kernel::KC * Kernel::WIDTH;
+		if (aPacked.size() < aSize)
+			aPacked.resize(aSize);
+		if (bPacked.size() < bSize)
+			bPacked.resize(bSize);
+
+		for (unsigned jc = 0; jc < n; jc += Kernel::NC) {
+			unsigned nc = std::min(Kernel::NC, n - jc);
+			for (unsigned pc = 0; pc < k; pc += Kernel::KC) {
+				unsigned kc = std::min(Kernel::KC, k - pc);
+				Kernel::pack_b(kc, nc, b + (size_t)pc * ldb + jc, ldb, bPacked.data());
+
+				for (unsigned ic = 0; ic < m; ic += Kernel::MC) {
+					unsigned mc = std::min(Kernel::MC, m - ic);
+					Kernel::pack_a(mc, kc, a + (size_t)ic * lda + pc, lda, aPacked.data());
+
+					for (unsigned jr = 0; jr < nc; jr += NR) {
+						const double* bSliver = bPacked.data() + (size_t)jr * kc * Kernel::WIDTH;
+						for (unsigned ir = 0; ir < mc; ir += MR) {
+							const double* aSliver = aPacked.data() + (size_t)ir * kc * Kernel::WIDTH;
+							T* cTile = c + (size_t)(ic + ir) * ldc + jc + jr;
+							Kernel::micro(kc, aSliver, bSliver, cTile, ldc, std::min(MR, mc - ir), std::min(NR, nc - jr));
+						}
+					}
+				}
+			}
+		}
+	}
+};
+
+template <>
+struct GemmKernel<double> : PackedGemm<DoubleMicroKernel> {};
+
+template <>
+struct GemmKernel<std::complex<double>> : PackedGemm<ComplexMicroKernel> {};
+
+// C += A * B on raw row-major blocks
+template <typename T>
+inline void gemm(unsigned m, unsigned n, unsigned k, const T* a, unsigned lda, const T* b, unsigned ldb, T* c, unsigned ldc)
+{
+	if (m == 0 || n == 0 || k == 0)
+		return;
+	GemmKernel<T>::multiply(m, n, k, a, lda, b, ldb, c, ldc);
+}
+
+// Output tiles handed out to the threads by gemm_parallel
+static constexpr unsigned GEMM_TILE_ROWS = 64;
+static constexpr unsigned GEMM_TILE_COLS = 256;
+// Products below this many multiply-adds stay on the calling thread
+static const unsigned long long GEMM_PARALLEL_SIZE = 64ULL * 64 * 64;
+
+// C += A * B split into independent output tiles over the thread pool
+template <typename T>
+void gemm_parallel(unsigned m, unsigned n, unsigned k, const T* a, unsigned lda, const T* b, unsigned ldb, T* c, unsigned ldc)
+{
+	ThreadPool &pool = ThreadPool::Instance();
+	if ((unsigned long long)m * n * k < GEMM_PARALLEL_SIZE || pool.ThreadCount() <= 1) {
+		gemm(m, n, k, a, lda, b, ldb, c, ldc);
+		return;
+	}
+
+	unsigned rowTiles = (m + GEMM_TILE_ROWS - 1) / GEMM_TILE_ROWS;
+	unsigned colTiles = (n + GEMM_TILE_COLS - 1) / GEMM_TILE_COLS;
+	pool.ParallelFor((size_t)rowTiles * colTiles, 1, [&](size_t begin, size_t end) {
+		for (size_t tile = begin; tile < end; tile++) {
+			unsigned i0 = (unsigned)(tile / colTiles) * GEMM_TILE_ROWS;
+			unsigned j0 = (unsigned)(tile % colTiles) * GEMM_TILE_COLS;
+			unsigned tileRows = std::min(GEMM_TILE_ROWS, m - i0);
+			unsigned tileCols = std::min(GEMM_TILE_COLS, n - j0);
+			gemm(tileRows, tileCols, k, a + (size_t)i0 * lda, lda, b + j0, ldb, c + (size_t)i0 * ldc + j0, ldc);
+		}
+	});
+}
@@ -0,0 +1,398 @@
+#pragma once
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <complex>
+#include <numeric>
+#include <vector>
+#include "Gemm.h"
+#include "HessenbergQR.h"
+#include "QSMatrix.h"
+#include "RowKernels.h"
+#include "ThreadPool.h"
+
+// Eigenvalues and eigenvectors of a Hermitian matrix: blocked Householder
+// reduction to a real symmetric tridiagonal matrix, then implicit QL
+// iteration on it. The eigenvalues are real and come out sorted, the
+// eigenvectors (when wanted) are the columns of a unitary matrix.
+
+// Tunable parameters of the Hermitian solver
+struct HermitianEigenSettings
+{
+	// Columns reduced per panel of the tridiagonal reduction
+	unsigned panelSize;
+	// A matrix counts as Hermitian when |a(i, j) - conj(a(j, i))| stays
+	// within this many ulps of its largest element
+	double hermitianUlps;
+	// QL iterations allowed per eigenvalue
+	unsigned maxIterations;
+
+	static HermitianEigenSettings& Instance()
+	{
+		static HermitianEigenSettings settings = { 32, 64, 30 };
+		return settings;
+	}
+};
+
+// True when the square matrix equals its conjugate transpose up to the
+// rounding of the computation that produced it
+inline bool is_hermitian(const QSMatrix<std::complex<double>>& matrix)
+{
+	unsigned n = matrix.get_rows();
+	if (n != matrix.get_cols())
+		return false;
+
+	double largest = 0;
+	for (unsigned i = 0; i < n; i++) {
+		for (unsigned j = 0; j < n; j++) {
+			largest = std::max(largest, abs1(matrix(i, j)));
+		}
+	}
+	double tolerance = HermitianEigenSettings::Instance().hermitianUlps * DBL_EPSILON * largest;
+
+	for (unsigned i = 0; i < n; i++) {
+		for (unsigned j = i; j < n; j++) {
+			if (abs1(matrix(i, j) - std::conj(matrix(j, i))) > tolerance)
+				return false;
+		}
+	}
+	return true;
+}
+
+// Reduces a Hermitian matrix to tridiagonal form Q^H A Q = T in place (the
+// matrix is left overwritten). diagonal and subdiagonal get T, the
+// subdiagonal as complex numbers. Reflector j is kept in column j of
+// reflectors below the diagonal, its tau in taus[j]. Panels of reflectors
+// are applied to the trailing block as A - V W^H - W V^H by gemm (the
+// scheme of LAPACK zhetrd)
+inline void hermitian_tridiagonalize(QSMatrix<std::complex<double>>& matrix, std::vector<double>& diagonal,
+	std::vector<std::complex<double>>& subdiagonal, QSMatrix<std::complex<double>>& reflectors, std::vector<double>& taus)
+{
+	typedef std::complex<double> cd;
+	unsigned n = matrix.get_rows();
+	diagonal.assign(n, 0);
+	subdiagonal.assign(n, cd());
+	taus.assign(n, 0);
+	if (n == 0)
+		return;
+
+	unsigned nb = std::max(1u, HermitianEigenSettings::Instance().panelSize);
+	ThreadPool& pool = ThreadPool::Instance();
+	cd* a = matrix.data();
+	unsigned lda = matrix.stride();
+	size_t grain = std::max<size_t>(1, PARALLEL_MIN_ELEMENTS / n);
+
+	QSMatrix<cd> v(n, nb, 0);
+	QSMatrix<cd> w(n, nb, 0);
+	std::vector<cd> column(n), p(n), vj(nb), wj(nb), vhv(nb), whv(nb);
+
+	for (unsigned k = 0; k + 2 < n; k += nb) {
+		unsigned b = std::min(nb, n - 2 - k);
+		for (unsigned r = 0; r < n; r++) {
+			std::fill(v.data() + (size_t)r * v.stride(), v.data() + (size_t)r * v.stride() + nb, cd());
+			std::fill(w.data() + (size_t)r * w.stride(), w.data() + (size_t)r * w.stride() + nb, cd());
+		}
+
+		for (unsigned i = 0; i < b; i++) {
+			unsigned j = k + i;
+
+			// Column j of A - V W^H - W V^H from row j down. Row j of the
+			// stored matrix is its conjugate, and contiguous
+			for (unsigned q = 0; q < i; q++) {
+				vj[q] = std::conj(v(j, q));
+				wj[q] = std::conj(w(j, q));
+			}
+			for (unsigned r = j; r < n; r++) {
+				column[r] = std::conj(a[(size_t)j * lda + r]) - row_dot(i, v.row(r), wj.data()) - row_dot(i, w.row(r), vj.data());
+			}
+			diagonal[j] = column[j].real();
+
+			cd beta;
+			double tau = householder_reflector(n - j - 1, column.data() + j + 1, beta);
+			subdiagonal[j] = beta;
+			taus[j] = tau;
+			for (unsigned r = j + 1; r < n; r++) {
+				v(r, i) = column[r];
+				reflectors(r, j) = column[r];
+			}
+			if (tau == 0)
+				continue;
+
+			// p = tau (A - V W^H - W V^H) v over the trailing rows, the
+			// stored trailing block still holds the values from the panel start
+			const cd* vr = column.data() + j + 1;
+			unsigned m = n - j - 1;
+			pool.ParallelFor(m, grain, [&](size_t begin, size_t end) {
+				for (size_t r = begin; r < end; r++) {
+					p[j + 1 + r] = row_dot(m, a + (j + 1 + r) * lda + j + 1, vr);
+				}
+			});
+			for (unsigned q = 0; q < i; q++) {
+				vhv[q] = 0;
+				whv[q] = 0;
+				for (unsigned r = j + 1; r < n; r++) {
+					vhv[q] += std::conj(v(r, q)) * column[r];
+					whv[q] += std::conj(w(r, q)) * column[r];
+				}
+			}
+			for (unsigned r = j + 1; r < n; r++) {
+				p[r] = tau * (p[r] - row_dot(i, v.row(r), whv.data()) - row_dot(i, w.row(r), vhv.data()));
+			}
+
+			// w = p - (tau / 2) (v^H p) v makes A - v w^H - w v^H = H A H
+			cd vhp = 0;
+			for (unsigned r = j + 1; r < n; r++) {
+				vhp += std::conj(column[r]) * p[r];
+			}
+			double half = 0.5 * tau * vhp.real();
+			for (unsigned r = j + 1; r < n; r++) {
+				w(r, i) = p[r] - half * column[r];
+			}
+		}
+
+		// Trailing block: A -= V W^H + W V^H
+		unsigned c0 = k + b;
+		unsigned m = n - c0;
+		QSMatrix<cd> minusWh(b, m, 0);
+		QSMatrix<cd> minusVh(b, m, 0);
+		for (unsigned q = 0; q < b; q++) {
+			for (unsigned c = 0; c < m; c++) {
+				minusWh(q, c) = -std::conj(w(c0 + c, q));
+				minusVh(q, c) = -std::conj(v(c0 + c, q));
+			}
+		}
+		cd* trailing = a + (size_t)c0 * lda + c0;
+		gemm_parallel(m, m, b, v.row(c0), v.stride(), minusWh.data(), minusWh.stride(), trailing, lda);
+		gemm_parallel(m, m, b, w.row(c0), w.stride(), minusVh.data(), minusVh.stride(), trailing, lda);
+	}
+
+	// The last 2 x 2 block, or the whole matrix when n < 3
+	unsigned last = n < 3 ? 0 : n - 2;
+	for (unsigned j = last; j < n; j++) {
+		diagonal[j] = matrix(j, j).real();
+		if (j + 1 < n)
+			subdiagonal[j] = matrix(j + 1, j);
+	}
+}
+
+// Q = H_0 H_1 ... H_(n-3) from the reflectors of hermitian_tridiagonalize
+inline void tridiagonal_form_q(const QSMatrix<std::complex<double>>& reflectors, const std::vector<double>& taus, QSMatrix<std::complex<double>>& q)
+{
+	typedef std::complex<double> cd;
+	unsigned n = reflectors.get_rows();
+	q = QSMatrix<cd>(n, n, 0);
+	for (unsigned i = 0; i < n; i++) {
+		q(i, i) = 1;
+	}
+
+	// Right to left: H_j only touches rows and columns j + 1.. of the product
+	std::vector<cd> v(n);
+	std::vector<cd> work(n);
+	for (unsigned j = n < 3 ? 0 : n - 2; j-- > 0;) {
+		if (taus[j] == 0)
+			continue;
+		unsigned first = j + 1;
+		unsigned m = n - first;
+		for (unsigned r = 0; r < m; r++) {
+			v[r] = reflectors(first + r, j);
+		}
+
+		// Q_sub -= tau v (v^H Q_sub), split over column chunks
+		size_t grain = std::max<size_t>(1, PARALLEL_MIN_ELEMENTS / m);
+		ThreadPool::Instance().ParallelFor(m, grain, [&](size_t begin, size_t end) {
+			unsigned width = (unsigned)(end - begin);
+			cd* part = work.data() + begin;
+			std::fill(part, part + width, cd());
+			for (unsigned r = 0; r < m; r++) {
+				row_axpy(width, std::conj(v[r]), q.row(first + r) + first + begin, part);
+			}
+			for (unsigned r = 0; r < m; r++) {
+				row_axpy(width, -taus[j] * v[r], part, q.data() + (size_t)(first + r) * q.stride() + first + begin);
+			}
+		});
+	}
+}
+
+// Applies real rotations to the rows of a matrix, in the order they are
+// stored: rotation t acts on rows (rows[t], rows[t] + 1). A real rotation
+// acts on real and imaginary parts alike, so the rows are treated as arrays
+// of doubles and only the entries [begin, end) of them are touched
+inline void rotate_rows_real(double* x, size_t stride, size_t count, const unsigned* rows, const double* c, const double* s, size_t begin, size_t end)
+{
+	for (size_t t = 0; t < count; t++) {
+		double* upper = x + rows[t] * stride;
+		double* lower = upper + stride;
+		const double ct = c[t];
+		const double st = s[t];
+		size_t k = begin;
+		// Four entries at a time, loads ahead of stores, so that the
+		// compiler can pack them into vector registers
+		for (; k + 4 <= end; k += 4) {
+			double u0 = upper[k], u1 = upper[k + 1], u2 = upper[k + 2], u3 = upper[k + 3];
+			double f0 = lower[k], f1 = lower[k + 1], f2 = lower[k + 2], f3 = lower[k + 3];
+			lower[k] = st * u0 + ct * f0;
+			lower[k + 1] = st * u1 + ct * f1;
+			lower[k + 2] = st * u2 + ct * f2;
+			lower[k + 3] = st * u3 + ct * f3;
+			upper[k] = ct * u0 - st * f0;
+			upper[k + 1] = ct * u1 - st * f1;
+			upper[k + 2] = ct * u2 - st * f2;
+			upper[k + 3] = ct * u3 - st * f3;
+		}
+		for (; k < end; k++) {
+			double f = lower[k];
+			lower[k] = st * upper[k] + ct * f;
+			upper[k] = ct * upper[k] - st * f;
+		}
+	}
+}
+
+// Eigenvalues of the real symmetric tridiagonal matrix with diagonal d and
+// subdiagonal e (e[i] = T(i + 1, i)) by implicit QL with Wilkinson shifts,
+// left in d. When zt is not null its rows are rotated along, so that
+// (z * (eigenvectors of T))^T comes out for zt = z^T. Rotations of a QL step
+// are collected and applied to zt in column chunks over the thread pool;
+// consecutive rotations share a row, so each step streams through the rows
+// once. Returns false when an eigenvalue did not converge
+inline bool tridiagonal_ql(std::vector<double>& d, std::vector<double>& e, QSMatrix<std::complex<double>>* zt)
+{
+	unsigned n = (unsigned)d.size();
+	e.resize(n);
+	if (n == 0)
+		return true;
+	e[n - 1] = 0;
+
+	unsigned maxIterations = HermitianEigenSettings::Instance().maxIterations;
+	std::vector<unsigned> rows(n);
+	std::vector<double> cosines(n), sines(n);
+
+	for (unsigned l = 0; l < n; l++) {
+		unsigned iterations = 0;
+		unsigned m;
+		do {
+			for (m = l; m + 1 < n; m++) {
+				double dd = std::abs(d[m]) + std::abs(d[m + 1]);
+				if (std::abs(e[m]) <= DBL_EPSILON * dd)
+					break;
+			}
+			if (m == l)
+				break;
+			if (iterations++ == maxIterations)
+				return false;
+
+			double g = (d[l + 1] - d[l]) / (2.0 * e[l]);
+			double r = std::hypot(g, 1.0);
+			g = d[m] - d[l] + e[l] / (g + (g >= 0 ? r : -r));
+			double s = 1;
+			double c = 1;
+			double p = 0;
+			size_t count = 0;
+			bool underflow = false;
+			for (unsigned i = m; i-- > l;) {
+				double f = s * e[i];
+				double b = c * e[i];
+				r = std::hypot(f, g);
+				e[i + 1] = r;
+				if (r == 0) {
+					d[i + 1] -= p;
+					e[m] = 0;
+					underflow = true;
+					break;
+				}
+				s = f / r;
+				c = g / r;
+				g = d[i + 1] - p;
+				r = (d[i] - g) * s + 2.0 * c * b;
+				p = s * r;
+				d[i + 1] = g + p;
+				g = c * r - b;
+				rows[count] = i;
+				cosines[count] = c;
+				sines[count] = s;
+				count++;
+			}
+
+			if (zt != nullptr && count > 0) {
+				double* x = reinterpret_cast<double*>(zt->data());
+				size_t stride = 2 * (size_t)zt->stride();
+				size_t grain = std::max<size_t>(512, PARALLEL_MIN_ELEMENTS / count);
+				ThreadPool::Instance().ParallelFor(2 * (size_t)zt->get_cols(), grain, [&](size_t begin, size_t end) {
+					rotate_rows_real(x, stride, count, rows.data(), cosines.data(), sines.data(), begin, end);
+				});
+			}
+
+			if (underflow)
+				continue;
+			d[l] -= p;
+			e[l] = g;
+			e[m] = 0;
+		} while (m != l);
+	}
+	return true;
+}
+
+// Eigenvalues of a Hermitian matrix in ascending order. When eigenvectors is
+// not null it gets the unitary matrix whose column i is the eigenvector of
+// eigenvalue i. Only the Hermitian part (A + A^H) / 2 is looked at. Returns
+// false when the QL iteration did not converge
+inline bool hermitian_eigen(const QSMatrix<std::complex<double>>& matrix, std::vector<double>& eigenvalues, QSMatrix<std::complex<double>>* eigenvectors = nullptr)
+{
+	typedef std::complex<double> cd;
+	unsigned n = matrix.get_rows();
+	QSMatrix<cd> work(n, n, 0);
+	for (unsigned i = 0; i < n; i++) {
+		for (unsigned j = 0; j < n; j++) {
+			work(i, j) = 0.5 * (matrix(i, j) + std::conj(matrix(j, i)));
+		}
+	}
+
+	std::vector<double> diagonal;
+	std::vector<cd> subdiagonal;
+	std::vector<double> taus;
+	QSMatrix<cd> reflectors(n, n, 0);
+	hermitian_tridiagonalize(work, diagonal, subdiagonal, reflectors, taus);
+
+	// T = D T' D^H with the unitary diagonal D that makes the subdiagonal of
+	// T' real: d[j + 1] = d[j] * e[j] / |e[j]|
+	std::vector<double> offDiagonal(n, 0);
+	std::vector<cd> phases(n, cd(1));
+	for (unsigned j = 0; j + 1 < n; j++) {
+		double size = std::abs(subdiagonal[j]);
+		offDiagonal[j] = size;
+		phases[j + 1] = size == 0 ? phases[j] : phases[j] * subdiagonal[j] / size;
+	}
+
+	// The QL rotations act on columns of Q D, which are kept as rows of the
+	// transpose for contiguous access
+	QSMatrix<cd> vectors(0, 0, 0);
+	if (eigenvectors != nullptr) {
+		QSMatrix<cd> q(0, 0, 0);
+		tridiagonal_form_q(reflectors, taus, q);
+		vectors = QSMatrix<cd>(n, n, 0);
+		for (unsigned r = 0; r < n; r++) {
+			for (unsigned c = 0; c < n; c++) {
+				vectors(c, r) = q(r, c) * phases[c];
+			}
+		}
+	}
+
+	bool converged = tridiagonal_ql(diagonal, offDiagonal, eigenvectors != nullptr ? &vectors : nullptr);
+
+	std::vector<unsigned> order(n);
+	std::iota(order.begin(), order.end(), 0u);
+	std::sort(order.begin(), order.end(), [&](unsigned x, unsigned y) { return diagonal[x] < diagonal[y]; });
+	eigenvalues.resize(n);
+	for (unsigned i = 0; i < n; i++) {
+		eigenvalues[i] = diagonal[order[i]];
+	}
+
+	if (eigenvectors != nullptr) {
+		*eigenvectors = QSMatrix<cd>(n, n, 0);
+		for (unsigned r = 0; r < n; r++) {
+			for (unsigned i = 0; i < n; i++) {
+				(*eigenvectors)(r, i) = vectors(order[i], r);
+			}
+		}
+	}
+	return converged;
+}
@@ -0,0 +1,526 @@
+#pragma once
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <complex>
+#include <vector>
+#include "Gemm.h"
+#include "QSMatrix.h"
+#include "RowKernels.h"
+#include "ThreadPool.h"
+
+// Eigenvalues of a dense complex matrix in O(n^3): blocked Householder
+// reduction to upper Hessenberg form, then implicitly shifted QR iteration
+// with aggressive early deflation. Only eigenvalues are wanted, so the QR
+// stage transforms the active diagonal block and nothing outside it.
+
+// Tunable parameters of the Hessenberg QR engine
+struct HessenbergQRSettings
+{
+	// Columns reduced per panel of the Hessenberg reduction
+	unsigned panelSize;
+	// Active blocks of this size and above try aggressive early deflation
+	// before every QR sweep
+	unsigned aedMinSize;
+	// Size of the trailing window searched by aggressive early deflation,
+	// must be below aedMinSize
+	unsigned aedWindow;
+	// QR sweeps allowed per eigenvalue of a block before the iteration
+	// gives up on it
+	unsigned maxIterations;
+
+	static HessenbergQRSettings& Instance()
+	{
+		static HessenbergQRSettings settings = { 32, 64, 32, 30 };
+		return settings;
+	}
+};
+
+// |re| + |im|, the cheap magnitude used by the deflation tests
+inline double abs1(const std::complex<double>& x)
+{
+	return std::abs(x.real()) + std::abs(x.imag());
+}
+
+// Turns x[0, m) into the Householder vector v with v[0] = 1 such that
+// (I - tau v v^H) x = beta e1. The reflector is Hermitian, tau is real and
+// 0 when x is already a multiple of e1
+inline double householder_reflector(unsigned m, std::complex<double>* x, std::complex<double>& beta)
+{
+	double tailNorm = 0;
+	for (unsigned r = 1; r < m; r++) {
+		tailNorm += std::norm(x[r]);
+	}
+	beta = x[0];
+	x[0] = 1;
+	if (tailNorm == 0)
+		return 0;
+
+	double alphaAbs = std::abs(beta);
+	double xNorm = std::sqrt(alphaAbs * alphaAbs + tailNorm);
+	std::complex<double> phase = alphaAbs == 0 ? std::complex<double>(1) : beta / alphaAbs;
+	std::complex<double> alpha = beta;
+	beta = -phase * xNorm;
+
+	std::complex<double> scale = 1.0 / (alpha - beta);
+	double vNorm = 1;
+	for (unsigned r = 1; r < m; r++) {
+		x[r] *= scale;
+		vNorm += std::norm(x[r]);
+	}
+	return 2 / vNorm;
+}
+
+// Reduces a square matrix to upper Hessenberg form by the similarity
+// Q^H A Q. Reflectors are gathered in panels as Q = I - V T V^H with
+// Y = A V T, and the trailing columns get the whole panel at once through
+// three matrix products (the scheme of LAPACK zgehrd)
+inline void hessenberg_reduce(QSMatrix<std::complex<double>>& matrix)
+{
+	typedef std::complex<double> cd;
+	unsigned n = matrix.get_rows();
+	if (n < 3)
+		return;
+
+	unsigned nb = std::max(1u, HessenbergQRSettings::Instance().panelSize);
+	ThreadPool& pool = ThreadPool::Instance();
+	cd* a = matrix.data();
+	unsigned lda = matrix.stride();
+	size_t grain = std::max<size_t>(1, PARALLEL_MIN_ELEMENTS / n);
+
+	// V by global row index, rows above the panel stay zero
+	QSMatrix<cd> v(n, nb, 0);
+	QSMatrix<cd> y(n, nb, 0);
+	QSMatrix<cd> t(nb, nb, 0);
+	std::vector<cd> column(n), av(n), w(nb), z(nb), vRow(nb);
+
+	for (unsigned k = 0; k + 2 < n; k += nb) {
+		unsigned b = std::min(nb, n - 2 - k);
+		for (unsigned r = 0; r < n; r++) {
+			std::fill(v.data() + (size_t)r * v.stride(), v.data() + (size_t)r * v.stride() + nb, cd());
+		}
+
+		for (unsigned i = 0; i < b; i++) {
+			unsigned j = k + i;
+
+			// Column j of A - Y V^H ...
+			for (unsigned p = 0; p < i; p++) {
+				vRow[p] = std::conj(v(j, p));
+			}
+			for (unsigned r = 0; r < n; r++) {
+				column[r] = a[(size_t)r * lda + j] - row_dot(i, y.row(r), vRow.data());
+			}
+
+			// ... and of (I - V T^H V^H) times it
+			if (i > 0) {
+				std::fill(w.begin(), w.begin() + i, cd());
+				for (unsigned r = k + 1; r < n; r++) {
+					for (unsigned p = 0; p < i; p++) {
+						w[p] += std::conj(v(r, p)) * column[r];
+					}
+				}
+				for (unsigned p = 0; p < i; p++) {
+					z[p] = 0;
+					for (unsigned q = 0; q <= p; q++) {
+						z[p] += std::conj(t(q, p)) * w[q];
+					}
+				}
+				for (unsigned r = k + 1; r < n; r++) {
+					column[r] -= row_dot(i, v.row(r), z.data());
+				}
+			}
+
+			cd beta;
+			double tau = householder_reflector(n - j - 1, column.data() + j + 1, beta);
+			for (unsigned r = 0; r <= j; r++) {
+				a[(size_t)r * lda + j] = column[r];
+			}
+			a[(size_t)(j + 1) * lda + j] = beta;
+			for (unsigned r = j + 2; r < n; r++) {
+				a[(size_t)r * lda + j] = 0;
+			}
+			for (unsigned r = j + 1; r < n; r++) {
+				v(r, i) = column[r];
+			}
+
+			// A v, columns right of j still hold the values from the panel start
+			const cd* vj = column.data() + j + 1;
+			pool.ParallelFor(n, grain, [&](size_t begin, size_t end) {
+				for (size_t r = begin; r < end; r++) {
+					av[r] = row_dot(n - j - 1, a + r * lda + j + 1, vj);
+				}
+			});
+
+			// T(:, i) = -tau T V^H v, Y(:, i) = tau (A v - Y V^H v)
+			for (unsigned p = 0; p < i; p++) {
+				z[p] = 0;
+				for (unsigned r = j + 1; r < n; r++) {
+					z[p] += std::conj(v(r, p)) * column[r];
+				}
+			}
+			for (unsigned p = 0; p < i; p++) {
+				cd sum = 0;
+				for (unsigned q = p; q < i; q++) {
+					sum += t(p, q) * z[q];
+				}
+				t(p, i) = -tau * sum;
+			}
+			t(i, i) = tau;
+			for (unsigned r = 0; r < n; r++) {
+				y(r, i) = tau * (av[r] - row_dot(i, y.row(r), z.data()));
+			}
+		}
+
+		// Trailing columns: A := (I - V T^H V^H) (A - Y V^H)
+		unsigned c0 = k + b;
+		unsigned m = n - c0;
+		unsigned r0 = k + 1;
+		unsigned mr = n - r0;
+
+		QSMatrix<cd> minusVh(b, m, 0);
+		for (unsigned p = 0; p < b; p++) {
+			for (unsigned c = 0; c < m; c++) {
+				minusVh(p, c) = -std::conj(v(c0 + c, p));
+			}
+		}
+		gemm_parallel(n, m, b, y.data(), y.stride(), minusVh.data(), minusVh.stride(), a + c0, lda);
+
+		QSMatrix<cd> vh(b, mr, 0);
+		for (unsigned p = 0; p < b; p++) {
+			for (unsigned r = 0; r < mr; r++) {
+				vh(p, r) = std::conj(v(r0 + r, p));
+			}
+		}
+		QSMatrix<cd> vha(b, m, 0);
+		gemm_parallel(b, m, mr, vh.data(), vh.stride(), a + (size_t)r0 * lda + c0, lda, vha.data(), vha.stride());
+
+		// -T^H V^H A, T^H is lower triangular
+		QSMatrix<cd> tvha(b, m, 0);
+		for (unsigned p = 0; p < b; p++) {
+			for (unsigned q = 0; q <= p; q++) {
+				row_axpy(m, -std::conj(t(q, p)), vha.row(q), tvha.data() + (size_t)p * tvha.stride());
+			}
+		}
+		gemm_parallel(mr, m, b, v.row(r0), v.stride(), tvha.data(), tvha.stride(), a + (size_t)r0 * lda + c0, lda);
+	}
+}
+
+// Unblocked reduction of the block [first, last] of h back to Hessenberg
+// form. Left reflectors touch columns up to last, right reflectors rows
+// from rowBegin
+inline void hessenberg_restore(QSMatrix<std::complex<double>>& h, unsigned first, unsigned last, unsigned rowBegin)
+{
+	typedef std::complex<double> cd;
+	std::vector<cd> v(last - first + 1), vConj(last - first + 1), w(last - first + 1);
+
+	for (unsigned c = first; c + 1 < last; c++) {
+		unsigned m = last - c;
+		for (unsigned r = 0; r < m; r++) {
+			v[r] = h(c + 1 + r, c);
+		}
+		cd beta;
+		double tau = householder_reflector(m, v.data(), beta);
+		h(c + 1, c) = beta;
+		for (unsigned r = c + 2; r <= last; r++) {
+			h(r, c) = 0;
+		}
+		if (tau == 0)
+			continue;
+
+		// Left: rows c + 1..last, columns c + 1..last
+		std::fill(w.begin(), w.begin() + m, cd());
+		for (unsigned r = 0; r < m; r++) {
+			row_axpy(m, std::conj(v[r]), h.row(c + 1 + r) + c + 1, w.data());
+		}
+		for (unsigned r = 0; r < m; r++) {
+			row_axpy(m, -tau * v[r], w.data(), h.data() + (size_t)(c + 1 + r) * h.stride() + c + 1);
+		}
+
+		// Right: rows rowBegin..last, columns c + 1..last
+		for (unsigned r = 0; r < m; r++) {
+			vConj[r] = std::conj(v[r]);
+		}
+		for (unsigned r = rowBegin; r <= last; r++) {
+			cd* row = h.data() + (size_t)r * h.stride() + c + 1;
+			row_axpy(m, -tau * row_dot(m, row, v.data()), vConj.data(), row);
+		}
+	}
+}
+
+// Rotation [c s; -conj(s) c] with real c taking (f, g) to (r, 0)
+inline void givens_rotation(const std::complex<double>& f, const std::complex<double>& g, double& c, std::complex<double>& s, std::complex<double>& r)
+{
+	double fa = std::abs(f);
+	double ga = std::abs(g);
+	if (ga == 0) {
+		c = 1;
+		s = 0;
+		r = f;
+		return;
+	}
+	if (fa == 0) {
+		c = 0;
+		s = std::conj(g) / ga;
+		r = ga;
+		return;
+	}
+	double norm = std::hypot(fa, ga);
+	std::complex<double> phase = f / fa;
+	c = fa / norm;
+	s = phase * std::conj(g) / norm;
+	r = phase * norm;
+}
+
+// Applies the rotations of columns first..first + count - 1 in this order
+// to a row: (x[k], x[k + 1]) := (x[k], x[k + 1]) G_k^H
+inline void rotate_row(std::complex<double>* x, unsigned first, unsigned count, const double* c, const std::complex<double>* s)
+{
+	for (unsigned k = first; k < first + count; k++) {
+		std::complex<double> u = x[k];
+		std::complex<double> v = x[k + 1];
+		x[k] = c[k] * u + std::conj(s[k]) * v;
+		x[k + 1] = -s[k] * u + c[k] * v;
+	}
+}
+
+// One implicit single-shift QR sweep over the active block [lo, hi] of the
+// Hessenberg matrix h: the bulge made by the shift is chased down the
+// subdiagonal by rotations. They are applied to columns up to colEnd and
+// rows from rowBegin, and accumulated into z when it is not null.
+// Rows k + 1 and k + 2 take rotation k from the right at once, the bulge
+// needs them. Rows above it take all their rotations after the sweep, each
+// in one contiguous pass, instead of a strided column walk per rotation
+inline void qr_sweep(QSMatrix<std::complex<double>>& h, unsigned lo, unsigned hi, const std::complex<double>& shift,
+	unsigned rowBegin, unsigned colEnd, QSMatrix<std::complex<double>>* z)
+{
+	typedef std::complex<double> cd;
+	std::vector<double> cosines(hi);
+	std::vector<cd> sines(hi);
+
+	for (unsigned k = lo; k < hi; k++) {
+		double& c = cosines[k];
+		cd& s = sines[k];
+		cd r;
+		if (k == lo) {
+			givens_rotation(h(lo, lo) - shift, h(lo + 1, lo), c, s, r);
+		}
+		else {
+			givens_rotation(h(k, k - 1), h(k + 1, k - 1), c, s, r);
+			h(k, k - 1) = r;
+			h(k + 1, k - 1) = 0;
+		}
+
+		cd* upper = h.data() + (size_t)k * h.stride();
+		cd* lower = upper + h.stride();
+		for (unsigned col = k; col <= colEnd; col++) {
+			cd x = upper[col];
+			cd y = lower[col];
+			upper[col] = c * x + s * y;
+			lower[col] = -std::conj(s) * x + c * y;
+		}
+
+		for (unsigned row = k + 1; row <= std::min(k + 2, hi); row++) {
+			cd* x = h.data() + (size_t)row * h.stride();
+			rotate_row(x, k, 1, cosines.data(), sines.data());
+		}
+	}
+
+	// Row r above the bulge takes rotations max(r, lo)..hi - 1
+	unsigned rowEnd = hi - 1;
+	size_t grain = std::max<size_t>(1, PARALLEL_MIN_ELEMENTS / (hi - lo + 1));
+	ThreadPool::Instance().ParallelFor(rowEnd + 1 - rowBegin, grain, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			unsigned row = rowBegin + (unsigned)i;
+			unsigned first = std::max(row, lo);
+			rotate_row(h.data() + (size_t)row * h.stride(), first, hi - first, cosines.data(), sines.data());
+		}
+	});
+
+	if (z != nullptr) {
+		for (unsigned row = 0; row < z->get_rows(); row++) {
+			rotate_row(z->data() + (size_t)row * z->stride(), lo, hi - lo, cosines.data(), sines.data());
+		}
+	}
+}
+
+// Eigenvalue of the trailing 2 x 2 block of [lo, hi] closer to h(hi, hi)
+inline std::complex<double> wilkinson_shift(const QSMatrix<std::complex<double>>& h, unsigned hi)
+{
+	std::complex<double> a = h(hi - 1, hi - 1);
+	std::complex<double> b = h(hi - 1, hi);
+	std::complex<double> c = h(hi, hi - 1);
+	std::complex<double> d = h(hi, hi);
+	std::complex<double> half = 0.5 * (a - d);
+	std::complex<double> root = std::sqrt(half * half + b * c);
+	std::complex<double> first = d + half + root;
+	std::complex<double> second = d + half - root;
+	return std::abs(first - d) < std::abs(second - d) ? first : second;
+}
+
+inline bool hessenberg_qr(QSMatrix<std::complex<double>>& h, unsigned lo, unsigned hi, bool full,
+	QSMatrix<std::complex<double>>* z, std::vector<std::complex<double>>& eigenvalues);
+
+// Aggressive early deflation on the active block [lo, hi]: the trailing
+// window is brought to Schur form and every eigenvalue at its bottom whose
+// entry of the spike (the old subdiagonal element times the first row of
+// the Schur vectors) is negligible is split off without a QR sweep. The
+// rest of the window is reduced back to Hessenberg form, its eigenvalues
+// go to shifts for the next sweeps. Returns the number of deflated ones
+inline unsigned aggressive_early_deflation(QSMatrix<std::complex<double>>& h, unsigned lo, unsigned hi, std::vector<std::complex<double>>& shifts)
+{
+	typedef std::complex<double> cd;
+	const double ulp = DBL_EPSILON;
+	const double smallNum = DBL_MIN * ((hi - lo + 1) / ulp);
+
+	unsigned window = std::min(HessenbergQRSettings::Instance().aedWindow, hi - lo);
+	if (window < 2)
+		return 0;
+	unsigned kw = hi - window + 1;
+
+	QSMatrix<cd> t(window, window, 0);
+	QSMatrix<cd> z(window, window, 0);
+	for (unsigned r = 0; r < window; r++) {
+		for (unsigned c = (r == 0 ? 0 : r - 1); c < window; c++) {
+			t(r, c) = h(kw + r, kw + c);
+		}
+		z(r, r) = 1;
+	}
+	std::vector<cd> values(window);
+	if (!hessenberg_qr(t, 0, window - 1, true, &z, values))
+		return 0;
+
+	cd spike = h(kw, kw - 1);
+	unsigned kept = window;
+	while (kept > 0) {
+		double tst = abs1(t(kept - 1, kept - 1));
+		if (tst == 0)
+			tst = abs1(spike);
+		if (std::abs(spike) * std::abs(z(0, kept - 1)) > std::max(smallNum, ulp * tst))
+			break;
+		kept--;
+	}
+	for (unsigned j = 0; j < kept; j++) {
+		shifts.push_back(t(j, j));
+	}
+	if (kept == window)
+		return 0;
+
+	// Rows lo..kw - 1 of the window columns times Z
+	unsigned above = kw - lo;
+	QSMatrix<cd> product(above, window, 0);
+	gemm_parallel(above, window, window, h.row(lo) + kw, h.stride(), z.data(), z.stride(), product.data(), product.stride());
+	for (unsigned r = 0; r < above; r++) {
+		std::copy(product.row(r), product.row(r) + window, h.data() + (size_t)(lo + r) * h.stride() + kw);
+	}
+
+	for (unsigned r = 0; r < window; r++) {
+		h(kw + r, kw - 1) = r < kept ? spike * std::conj(z(0, r)) : cd();
+		for (unsigned c = 0; c < window; c++) {
+			h(kw + r, kw + c) = c >= r ? t(r, c) : cd();
+		}
+	}
+
+	if (kept > 1)
+		hessenberg_restore(h, kw - 1, kw + kept - 1, lo);
+	return window - kept;
+}
+
+// Eigenvalues of the Hessenberg block [lo, hi] of h by implicitly shifted QR,
+// written to eigenvalues[lo..hi]. With full set the rotations cover whole
+// rows and columns of h, which ends in Schur form, and are accumulated into
+// z when it is not null; aggressive early deflation is used otherwise.
+// Returns false when the block took more than maxIterations sweeps per
+// eigenvalue, the unconverged eigenvalues are then the diagonal elements left
+inline bool hessenberg_qr(QSMatrix<std::complex<double>>& h, unsigned lo, unsigned hi, bool full,
+	QSMatrix<std::complex<double>>* z, std::vector<std::complex<double>>& eigenvalues)
+{
+	typedef std::complex<double> cd;
+	const HessenbergQRSettings& settings = HessenbergQRSettings::Instance();
+	const double ulp = DBL_EPSILON;
+	const double smallNum = DBL_MIN * ((hi - lo + 1) / ulp);
+	unsigned n = h.get_rows();
+
+	// Sweeps since the last deflation, and in total
+	unsigned iterations = 0;
+	size_t totalIterations = 0;
+	size_t maxTotal = (size_t)settings.maxIterations * (hi - lo + 1);
+	std::vector<cd> shifts;
+	for (long i = hi; i >= (long)lo;) {
+		// Look for a negligible subdiagonal element
+		unsigned l = lo;
+		for (unsigned k = (unsigned)i; k > lo; k--) {
+			double sub = abs1(h(k, k - 1));
+			if (sub <= smallNum) {
+				l = k;
+				break;
+			}
+			double tst = abs1(h(k - 1, k - 1)) + abs1(h(k, k));
+			if (tst == 0) {
+				if (k >= lo + 2)
+					tst += std::abs(h(k - 1, k - 2).real());
+				if (k + 1 <= (unsigned)i)
+					tst += std::abs(h(k + 1, k).real());
+			}
+			if (sub <= ulp * tst) {
+				l = k;
+				break;
+			}
+		}
+		if (l > lo)
+			h(l, l - 1) = 0;
+
+		if (l == (unsigned)i) {
+			eigenvalues[i] = h(i, i);
+			i--;
+			iterations = 0;
+			continue;
+		}
+
+		if (totalIterations == maxTotal) {
+			for (unsigned k = lo; k <= (unsigned)i; k++) {
+				eigenvalues[k] = h(k, k);
+			}
+			return false;
+		}
+		iterations++;
+		totalIterations++;
+
+		// A deflation attempt whenever the shifts from the last one are used up
+		bool aed = !full && i - l + 1 >= settings.aedMinSize;
+		if (aed && shifts.empty() && aggressive_early_deflation(h, l, (unsigned)i, shifts) > 0) {
+			shifts.clear();
+			iterations = 0;
+			continue;
+		}
+
+		// Exceptional shifts break the rare cycles of the regular ones
+		cd shift;
+		if (iterations % 20 == 10)
+			shift = h(l, l) + 0.75 * std::abs(h(l + 1, l).real());
+		else if (iterations % 20 == 0)
+			shift = h(i, i) + 0.75 * std::abs(h(i, i - 1).real());
+		else if (aed && !shifts.empty()) {
+			shift = shifts.back();
+			shifts.pop_back();
+		}
+		else
+			shift = wilkinson_shift(h, (unsigned)i);
+
+		qr_sweep(h, l, (unsigned)i, shift, full ? 0 : l, full ? n - 1 : (unsigned)i, z);
+	}
+	return true;
+}
+
+// Eigenvalues of a square complex matrix: Hessenberg reduction of a copy
+// and shifted QR on it. Returns false when the QR iteration did not converge
+inline bool hessenberg_qr_eigenvalues(const QSMatrix<std::complex<double>>& matrix, std::vector<std::complex<double>>& eigenvalues)
+{
+	unsigned n = matrix.get_rows();
+	eigenvalues.assign(n, std::complex<double>());
+	if (n == 0)
+		return true;
+
+	QSMatrix<std::complex<double>> h = matrix;
+	hessenberg_reduce(h);
+	return hessenberg_qr(h, 0, n - 1, false, nullptr, eigenvalues);
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <algorithm>
+#include <complex>
+#include <vector>
+#include "ComplexKernels.h"
+#include "ThreadPool.h"
+
+// Evaluation of one polynomial at many points by Horner's rule, with the
+// derivative fused into the same pass. The coefficients come lowest degree
+// first: P = a[0] + a[1] x + ... + a[degree] x^degree.
+
+// Points evaluated side by side by the generic kernel
+static const unsigned HORNER_LANES = 8;
+
+// values[i] = P(x[i]), derivatives[i] = P'(x[i]) unless derivatives is null.
+// The points go in groups of HORNER_LANES whose recurrences are independent,
+// so the compiler can keep them in vector registers
+template <typename T>
+inline void horner_kernel(size_t degree, const T* a, size_t n, const T* x, T* values, T* derivatives)
+{
+	for (size_t first = 0; first < n; first += HORNER_LANES) {
+		unsigned lanes = (unsigned)std::min<size_t>(HORNER_LANES, n - first);
+		T points[HORNER_LANES], p[HORNER_LANES], d[HORNER_LANES];
+		for (unsigned l = 0; l < HORNER_LANES; l++) {
+			points[l] = l < lanes ? x[first + l] : T();
+			p[l] = a[degree];
+			d[l] = T();
+		}
+		for (size_t k = degree; k-- > 0;) {
+			for (unsigned l = 0; l < HORNER_LANES; l++) {
+				d[l] = d[l] * points[l] + p[l];
+				p[l] = p[l] * points[l] + a[k];
+			}
+		}
+		for (unsigned l = 0; l < lanes; l++) {
+			values[first + l] = p[l];
+			if (derivatives != nullptr)
+				derivatives[first + l] = d[l];
+		}
+	}
+}
+
+inline void horner_kernel(size_t degree, const std::complex<double>* a, size_t n, const std::complex<double>* x, std::complex<double>* values, std::complex<double>* derivatives)
+{
+	ComplexKernels::Get().horner(degree, a, n, x, values, derivatives);
+}
+
+// P(x[i]) (and P'(x[i]) when derivatives is not null) for n points, in
+// chunks over the thread pool for large batches. An empty coefficient list
+// is the zero polynomial
+template <typename T>
+void horner_evaluate(const std::vector<T>& coefficients, size_t n, const T* x, T* values, T* derivatives = nullptr)
+{
+	if (coefficients.empty()) {
+		std::fill(values, values + n, T());
+		if (derivatives != nullptr)
+			std::fill(derivatives, derivatives + n, T());
+		return;
+	}
+
+	size_t degree = coefficients.size() - 1;
+	size_t grain = std::max<size_t>(HORNER_LANES, PARALLEL_MIN_ELEMENTS / coefficients.size());
+	ThreadPool::Instance().ParallelFor(n, grain, [&](size_t begin, size_t end) {
+		horner_kernel(degree, coefficients.data(), end - begin, x + begin, values + begin, derivatives != nullptr ? derivatives + begin : nullptr);
+	});
+}
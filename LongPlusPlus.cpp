@@ -1,4 +1,6 @@
 #include "LongPlusPlus.h"
+#include "DecimalFormat.h"
+#include "WideUInt.h"
 
 LongPlusPlus LongPlusPlus::preMultCalc(const LongPlusPlus &_summand, const ull value, const int _pow = 0) const
 {
@@ -50,10 +52,8 @@ LongPlusPlus::LongPlusPlus(ull _low, ull _medium, ull _high)
 
 std::string LongPlusPlus::addLeadingZeroes(std::string number)
 {
-	int constLength = std::to_string(LongPlusPlus::e8).length() - 2;
-	while (number.length() <= constLength) {
-		number = "0" + number;
-	}
+	if (number.length() < e8Digits)
+		number.insert(0, e8Digits - number.length(), '0');
 	return number;
 }
 
@@ -80,13 +80,52 @@ LongPlusPlus LongPlusPlus::operator*(const LongPlusPlus & _summand) const
 	return res1 + res2 + res3;
 }
 
+LongPlusPlus LongPlusPlus::divCalc(const LongPlusPlus &_divisor, bool _remainder) const
+{
+	// high < 2^64, so every value is below 2^64 e8^2 < 2^128
+	UInt128 base = this->e8;
+	UInt128 dividend = (UInt128(this->high) * base + UInt128(this->medium)) * base + UInt128(this->low);
+	UInt128 divisor = (UInt128(_divisor.high) * base + UInt128(_divisor.medium)) * base + UInt128(_divisor.low);
+	UInt128 result = _remainder ? dividend % divisor : dividend / divisor;
+
+	std::pair<UInt128, UInt128> lowSplit = divmod(result, base);
+	std::pair<UInt128, UInt128> mediumSplit = divmod(lowSplit.first, base);
+	return LongPlusPlus((ull)lowSplit.second, (ull)mediumSplit.second, (ull)mediumSplit.first);
+}
+
+LongPlusPlus LongPlusPlus::operator/(const LongPlusPlus & _divisor) const
+{
+	return divCalc(_divisor, false);
+}
+
+LongPlusPlus LongPlusPlus::operator%(const LongPlusPlus & _divisor) const
+{
+	return divCalc(_divisor, true);
+}
+
+size_t LongPlusPlus::write_decimal(char *buffer) const
+{
+	// Parts below the leading one take exactly e8Digits digits
+	size_t length = 0;
+	if (this->high > 0) {
+		length = format_decimal(buffer, this->high);
+		length += format_decimal_padded(buffer + length, this->medium, e8Digits);
+		length += format_decimal_padded(buffer + length, this->low, e8Digits);
+	}
+	else if (this->medium > 0) {
+		length = format_decimal(buffer, this->medium);
+		length += format_decimal_padded(buffer + length, this->low, e8Digits);
+	}
+	else {
+		length = format_decimal(buffer, this->low);
+	}
+	return length;
+}
+
 std::string LongPlusPlus::to_string()
 {
-	std::string result = "";
-	result += (this->high > 0) ? std::to_string(this->high) : "";
-	result += (this->high > 0) ? this->addLeadingZeroes(std::to_string(this->medium)) : ((this->medium > 0) ? std::to_string(this->medium) : "");
-	result += (this->medium > 0) ? this->addLeadingZeroes(std::to_string(this->low)) : ((this->low > 0) ? std::to_string(this->low) : "");
-	return result;
+	char buffer[MAX_DECIMAL_LENGTH];
+	return std::string(buffer, this->write_decimal(buffer));
 }
 
 LongPlusPlus::~LongPlusPlus()
@@ -95,9 +134,6 @@ LongPlusPlus::~LongPlusPlus()
 
 std::string to_string(const LongPlusPlus & lpnum)
 {
-	std::string result = "";
-	result += (lpnum.high > 0) ? std::to_string(lpnum.high) : "";
-	result += (lpnum.high > 0) ? lpnum.addLeadingZeroes(std::to_string(lpnum.medium)) : ((lpnum.medium > 0) ? std::to_string(lpnum.medium) : "");
-	result += (lpnum.medium > 0) ? lpnum.addLeadingZeroes(std::to_string(lpnum.low)) : ((lpnum.low > 0) ? std::to_string(lpnum.low) : "");
-	return result;
+	char buffer[LongPlusPlus::MAX_DECIMAL_LENGTH];
+	return std::string(buffer, lpnum.write_decimal(buffer));
 }
@@ -6,18 +6,29 @@ class LongPlusPlus
 {
 private:
 	ull low, medium, high;
+	friend class BigInt;
 	LongPlusPlus preMultCalc(const LongPlusPlus &_summand, const ull value, const int _pow) const;
+	// Quotient or, with _remainder set, remainder of the division by _divisor
+	LongPlusPlus divCalc(const LongPlusPlus &_divisor, bool _remainder) const;
 public:
 	LongPlusPlus(ull n = 0);
 	LongPlusPlus(ull _low, ull _medium, ull _high);
 
 	LongPlusPlus operator+(const LongPlusPlus &_summand) const;
 	LongPlusPlus operator*(const LongPlusPlus &_summand) const;
+	// The divisor must not be zero
+	LongPlusPlus operator/(const LongPlusPlus &_divisor) const;
+	LongPlusPlus operator%(const LongPlusPlus &_divisor) const;
 	std::string to_string();
 	friend std::string to_string(const LongPlusPlus &lpnum);
+	// Writes the decimal digits into buffer of MAX_DECIMAL_LENGTH chars or
+	// more, returns their number
+	size_t write_decimal(char *buffer) const;
 
 	~LongPlusPlus();
 	static const ull e8 = 1E+8;
+	static const unsigned e8Digits = 8;
+	static const size_t MAX_DECIMAL_LENGTH = 20 + 2 * e8Digits;
 	static std::string addLeadingZeroes(std::string number);
 };
 
@@ -1,4 +1,6 @@
 #include "Longplus.h"
+#include "DecimalFormat.h"
+#include "WideUInt.h"
 
 LongPlus::LongPlus(ull n)
 {
@@ -21,14 +23,47 @@ LongPlus LongPlus::operator+(const LongPlus &_summand) const
 	return LongPlus(resultLow, resultHigh);
 }
 
+LongPlus LongPlus::divCalc(const LongPlus &_divisor, bool _remainder) const
+{
+	// high < 2^64, so every value is below 2^64 e15 < 2^128
+	UInt128 base = this->e15;
+	UInt128 dividend = UInt128(this->high) * base + UInt128(this->low);
+	UInt128 divisor = UInt128(_divisor.high) * base + UInt128(_divisor.low);
+	UInt128 result = _remainder ? dividend % divisor : dividend / divisor;
+
+	std::pair<UInt128, UInt128> split = divmod(result, base);
+	return LongPlus((ull)split.second, (ull)split.first);
+}
+
+LongPlus LongPlus::operator/(const LongPlus &_divisor) const
+{
+	return divCalc(_divisor, false);
+}
+
+LongPlus LongPlus::operator%(const LongPlus &_divisor) const
+{
+	return divCalc(_divisor, true);
+}
+
+size_t LongPlus::write_decimal(char *buffer) const
+{
+	// low takes exactly e15Digits digits below a nonzero high
+	if (this->high == 0)
+		return format_decimal(buffer, this->low);
+	size_t length = format_decimal(buffer, this->high);
+	return length + format_decimal_padded(buffer + length, this->low, e15Digits);
+}
+
 std::string LongPlus::to_string()
 {
-	return ((this->high > 0) ? std::to_string(this->high) : "") + std::to_string(this->low);
+	char buffer[MAX_DECIMAL_LENGTH];
+	return std::string(buffer, this->write_decimal(buffer));
 }
 
 std::string to_string(const LongPlus &lpnum)
 {
-	return ((lpnum.high > 0) ? std::to_string(lpnum.high) : "") + std::to_string(lpnum.low);
+	char buffer[LongPlus::MAX_DECIMAL_LENGTH];
+	return std::string(buffer, lpnum.write_decimal(buffer));
 }
 
 LongPlus::~LongPlus()
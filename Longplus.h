@@ -8,13 +8,24 @@ class LongPlus
 {
 private:
 	ull low, high;
+	friend class BigInt;
+	//  ,  _remainder,     _divisor
+	LongPlus divCalc(const LongPlus &_divisor, bool _remainder) const;
 public:
 	LongPlus(ull n = 0);
 	LongPlus(ull _low, ull _high);
 	~LongPlus();
 	LongPlus operator+(const LongPlus &_summand) const;
+	//     
+	LongPlus operator/(const LongPlus &_divisor) const;
+	LongPlus operator%(const LongPlus &_divisor) const;
 	std::string to_string();
 	friend std::string to_string(const LongPlus &lpnum);
+	//        MAX_DECIMAL_LENGTH,
+	//   
+	size_t write_decimal(char *buffer) const;
 	static const ull e15 = 1E+15;
+	static const unsigned e15Digits = 15;
+	static const size_t MAX_DECIMAL_LENGTH = 20 + e15Digits;
 };
 
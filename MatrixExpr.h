@@ -0,0 +1,326 @@
+#pragma once
+#include <complex>
+#include <type_traits>
+#include <utility>
+#include "RowKernels.h"
+
+// Lazily evaluated element-wise matrix expressions. A + B * s - C builds a
+// tree of small nodes holding references to the matrices; assigning the
+// tree to a QSMatrix evaluates it in one pass with a single allocation
+// (none at all when a temporary operand's buffer can be reused).
+// Matrix products are not lazy, they go straight to the GEMM kernels.
+
+template <typename T>
+class QSMatrix;
+
+// Base of every expression, E is the concrete node type
+template <typename E>
+struct MatrixExpr
+{
+	const E& self() const
+	{
+		return static_cast<const E&>(*this);
+	}
+};
+
+template <typename E>
+struct IsMatrixExpr : std::is_base_of<MatrixExpr<typename std::decay<E>::type>, typename std::decay<E>::type> {};
+
+// Temporary matrix moved into an expression. Its buffer is reused for the
+// result, so (A * B) + C or std::move(A) * s do not allocate again
+template <typename T>
+class MatrixTemp : public MatrixExpr<MatrixTemp<T>>
+{
+public:
+	typedef T value_type;
+	typedef const T* RowType;
+
+	mutable QSMatrix<T> matrix;
+
+	MatrixTemp(QSMatrix<T>&& _matrix) : matrix(std::move(_matrix)) {}
+
+	unsigned get_rows() const { return matrix.get_rows(); }
+	unsigned get_cols() const { return matrix.get_cols(); }
+	RowType row(unsigned i) const { return matrix.row(i); }
+};
+
+// Node type for an operand: lvalue matrices are referenced, rvalue
+// matrices are moved into a MatrixTemp, inner nodes are moved in by value
+template <typename E>
+struct ExprOperand
+{
+	typedef typename std::decay<E>::type type;
+};
+
+template <typename T>
+struct ExprOperand<QSMatrix<T>>
+{
+	typedef MatrixTemp<T> type;
+};
+
+template <typename T>
+struct ExprOperand<QSMatrix<T>&>
+{
+	typedef QSMatrix<T> type;
+};
+
+template <typename T>
+struct ExprOperand<const QSMatrix<T>&>
+{
+	typedef QSMatrix<T> type;
+};
+
+template <typename T>
+struct ExprOperand<const QSMatrix<T>>
+{
+	typedef QSMatrix<T> type;
+};
+
+// Matrices are held by reference, everything else by value
+template <typename E>
+struct ExprStorage
+{
+	typedef E type;
+};
+
+template <typename T>
+struct ExprStorage<QSMatrix<T>>
+{
+	typedef const QSMatrix<T>& type;
+};
+
+// Element operations. Complex products use the textbook formula, which
+// the compiler can vectorize, instead of the inf/nan-aware std::complex one
+struct ExprAdd
+{
+	template <typename A, typename B>
+	static A apply(const A& a, const B& b) { return a + b; }
+};
+
+struct ExprSub
+{
+	template <typename A, typename B>
+	static A apply(const A& a, const B& b) { return a - b; }
+};
+
+struct ExprMul
+{
+	template <typename A, typename B>
+	static A apply(const A& a, const B& b) { return a * b; }
+
+	static std::complex<double> apply(const std::complex<double>& a, const std::complex<double>& b)
+	{
+		return std::complex<double>(a.real() * b.real() - a.imag() * b.imag(), a.real() * b.imag() + a.imag() * b.real());
+	}
+};
+
+struct ExprDiv
+{
+	template <typename A, typename B>
+	static A apply(const A& a, const B& b) { return a / b; }
+};
+
+// Element-wise operation of two expressions of the same size
+template <typename L, typename R, typename Op>
+class MatrixBinaryExpr : public MatrixExpr<MatrixBinaryExpr<L, R, Op>>
+{
+public:
+	typedef typename L::value_type value_type;
+
+	typename ExprStorage<L>::type lhs;
+	typename ExprStorage<R>::type rhs;
+
+	// View of the i-th row of the result
+	struct RowType
+	{
+		typename L::RowType l;
+		typename R::RowType r;
+
+		value_type operator[](unsigned j) const
+		{
+			return Op::apply(l[j], r[j]);
+		}
+	};
+
+	template <typename A, typename B>
+	MatrixBinaryExpr(A&& _lhs, B&& _rhs) : lhs(std::forward<A>(_lhs)), rhs(std::forward<B>(_rhs)) {}
+
+	unsigned get_rows() const { return lhs.get_rows(); }
+	unsigned get_cols() const { return lhs.get_cols(); }
+
+	RowType row(unsigned i) const
+	{
+		RowType result = { lhs.row(i), rhs.row(i) };
+		return result;
+	}
+};
+
+// Operation of every element of an expression with a scalar on the right
+template <typename E, typename Op>
+class MatrixScalarExpr : public MatrixExpr<MatrixScalarExpr<E, Op>>
+{
+public:
+	typedef typename E::value_type value_type;
+
+	typename ExprStorage<E>::type expr;
+	value_type scalar;
+
+	struct RowType
+	{
+		typename E::RowType e;
+		value_type s;
+
+		value_type operator[](unsigned j) const
+		{
+			return Op::apply(e[j], s);
+		}
+	};
+
+	template <typename A>
+	MatrixScalarExpr(A&& _expr, const value_type& _scalar) : expr(std::forward<A>(_expr)), scalar(_scalar) {}
+
+	unsigned get_rows() const { return expr.get_rows(); }
+	unsigned get_cols() const { return expr.get_cols(); }
+
+	RowType row(unsigned i) const
+	{
+		RowType result = { expr.row(i), scalar };
+		return result;
+	}
+};
+
+// Evaluate the i-th row of an expression into out
+template <typename E, typename T>
+inline void eval_expr_row(const E& expr, unsigned i, unsigned n, T* out)
+{
+	typename E::RowType row = expr.row(i);
+	for (unsigned j = 0; j < n; j++) {
+		out[j] = row[j];
+	}
+}
+
+// Operands whose rows are plain arrays
+template <typename E>
+struct IsMatrixLeaf : std::is_same<typename E::RowType, const typename E::value_type*> {};
+
+// The simple shapes go to the row kernels (SIMD for complex<double>)
+template <typename L, typename R, typename T>
+inline typename std::enable_if<IsMatrixLeaf<L>::value && IsMatrixLeaf<R>::value>::type
+eval_expr_row(const MatrixBinaryExpr<L, R, ExprAdd>& expr, unsigned i, unsigned n, T* out)
+{
+	row_add(n, expr.lhs.row(i), expr.rhs.row(i), out);
+}
+
+template <typename L, typename R, typename T>
+inline typename std::enable_if<IsMatrixLeaf<L>::value && IsMatrixLeaf<R>::value>::type
+eval_expr_row(const MatrixBinaryExpr<L, R, ExprSub>& expr, unsigned i, unsigned n, T* out)
+{
+	row_sub(n, expr.lhs.row(i), expr.rhs.row(i), out);
+}
+
+template <typename E, typename T>
+inline typename std::enable_if<IsMatrixLeaf<E>::value>::type
+eval_expr_row(const MatrixScalarExpr<E, ExprMul>& expr, unsigned i, unsigned n, T* out)
+{
+	row_scale(n, expr.scalar, expr.expr.row(i), out);
+}
+
+// out[j] = Op(out[j], expression element (i, j)) for a compound assignment.
+// The expression is only referenced, so temporaries inside it are read
+// where they are instead of being copied into a new node
+template <typename Op, typename E, typename T>
+inline void update_expr_row(Op, const E& expr, unsigned i, unsigned n, T* out)
+{
+	typename E::RowType row = expr.row(i);
+	for (unsigned j = 0; j < n; j++) {
+		out[j] = Op::apply(out[j], row[j]);
+	}
+}
+
+template <typename E, typename T>
+inline typename std::enable_if<IsMatrixLeaf<E>::value>::type
+update_expr_row(ExprAdd, const E& expr, unsigned i, unsigned n, T* out)
+{
+	row_add(n, out, expr.row(i), out);
+}
+
+template <typename E, typename T>
+inline typename std::enable_if<IsMatrixLeaf<E>::value>::type
+update_expr_row(ExprSub, const E& expr, unsigned i, unsigned n, T* out)
+{
+	row_sub(n, out, expr.row(i), out);
+}
+
+// Temporary matrix of an expression whose buffer may take the result
+template <typename T>
+inline QSMatrix<T>* reusable_matrix(const QSMatrix<T>&)
+{
+	return nullptr;
+}
+
+template <typename T>
+inline QSMatrix<T>* reusable_matrix(const MatrixTemp<T>& temp)
+{
+	return &temp.matrix;
+}
+
+template <typename L, typename R, typename Op>
+inline QSMatrix<typename L::value_type>* reusable_matrix(const MatrixBinaryExpr<L, R, Op>& expr)
+{
+	QSMatrix<typename L::value_type>* result = reusable_matrix(expr.lhs);
+	return result != nullptr ? result : reusable_matrix(expr.rhs);
+}
+
+template <typename E, typename Op>
+inline QSMatrix<typename E::value_type>* reusable_matrix(const MatrixScalarExpr<E, Op>& expr)
+{
+	return reusable_matrix(expr.expr);
+}
+
+// Matrix/matrix element-wise operators
+template <typename L, typename R>
+inline typename std::enable_if<IsMatrixExpr<L>::value && IsMatrixExpr<R>::value,
+	MatrixBinaryExpr<typename ExprOperand<L>::type, typename ExprOperand<R>::type, ExprAdd>>::type
+operator+(L&& lhs, R&& rhs)
+{
+	typedef MatrixBinaryExpr<typename ExprOperand<L>::type, typename ExprOperand<R>::type, ExprAdd> Result;
+	return Result(std::forward<L>(lhs), std::forward<R>(rhs));
+}
+
+template <typename L, typename R>
+inline typename std::enable_if<IsMatrixExpr<L>::value && IsMatrixExpr<R>::value,
+	MatrixBinaryExpr<typename ExprOperand<L>::type, typename ExprOperand<R>::type, ExprSub>>::type
+operator-(L&& lhs, R&& rhs)
+{
+	typedef MatrixBinaryExpr<typename ExprOperand<L>::type, typename ExprOperand<R>::type, ExprSub> Result;
+	return Result(std::forward<L>(lhs), std::forward<R>(rhs));
+}
+
+// Matrix/scalar operators
+template <typename E>
+inline typename std::enable_if<IsMatrixExpr<E>::value, MatrixScalarExpr<typename ExprOperand<E>::type, ExprAdd>>::type
+operator+(E&& lhs, const typename std::decay<E>::type::value_type& rhs)
+{
+	return MatrixScalarExpr<typename ExprOperand<E>::type, ExprAdd>(std::forward<E>(lhs), rhs);
+}
+
+template <typename E>
+inline typename std::enable_if<IsMatrixExpr<E>::value, MatrixScalarExpr<typename ExprOperand<E>::type, ExprSub>>::type
+operator-(E&& lhs, const typename std::decay<E>::type::value_type& rhs)
+{
+	return MatrixScalarExpr<typename ExprOperand<E>::type, ExprSub>(std::forward<E>(lhs), rhs);
+}
+
+template <typename E>
+inline typename std::enable_if<IsMatrixExpr<E>::value, MatrixScalarExpr<typename ExprOperand<E>::type, ExprMul>>::type
+operator*(E&& lhs, const typename std::decay<E>::type::value_type& rhs)
+{
+	return MatrixScalarExpr<typename ExprOperand<E>::type, ExprMul>(std::forward<E>(lhs), rhs);
+}
+
+template <typename E>
+inline typename std::enable_if<IsMatrixExpr<E>::value, MatrixScalarExpr<typename ExprOperand<E>::type, ExprDiv>>::type
+operator/(E&& lhs, const typename std::decay<E>::type::value_type& rhs)
+{
+	return MatrixScalarExpr<typename ExprOperand<E>::type, ExprDiv>(std::forward<E>(lhs), rhs);
+}
@@ -1,10 +1,25 @@
 #pragma once
 #include <vector>
 #include <complex>
-#include <random>
+#include "AberthRoots.h"
+#include "CompanionOperator.h"
+#include "Horner.h"
+#include "PolynomialMultiply.h"
+#include "Random.h"
+#include "SquareFree.h"
+#include "TaylorShift.h"
 
 using namespace std;
 
+//     
+enum RootMethod
+{
+	//       x - a  
+	ROOTS_DEFLATION = 0,
+	//     - (. AberthRoots.h)
+	ROOTS_ABERTH = 1
+};
+
 template <typename T>
 class Polynomial
 {
@@ -45,18 +60,35 @@ public:
 	}
 
 	/*
-	*    P(x)
+	*    P(x)   
 	* @param int value -  x
 	*/
-	T operator ()(const T &value)
+	T operator ()(const T &value) const
 	{
-		T result = 0;
-		for (int i = 0; i < this->coefficients.size(); i++) {
-			result += this->coefficients[i] * pow(value, i);
-		}
+		T result;
+		horner_evaluate(this->coefficients, 1, &value, &result);
 		return result;
 	}
 
+	/*
+	*           ,
+	*     
+	* @param vector<T> points -  x
+	* @param vector<T> *derivatives -   ,    P'(x)
+	* @return vector<T> -  P(x)
+	*/
+	vector<T> Evaluate(const vector<T> &points, vector<T> *derivatives = nullptr) const
+	{
+		vector<T> values(points.size());
+		T *derivativeValues = nullptr;
+		if (derivatives != nullptr) {
+			derivatives->resize(points.size());
+			derivativeValues = derivatives->data();
+		}
+		horner_evaluate(this->coefficients, points.size(), points.data(), values.data(), derivativeValues);
+		return values;
+	}
+
 	/*
 	*   P(x)  x - a
 	* @param T coefficient -  a
@@ -74,6 +106,28 @@ public:
 		return result;
 	}
 
+	/*
+	*   :  P(x)  x - a.   
+	*      |a| > 1,   
+	*   : a_0 = -a q_0, a_i = q_(i-1) - a q_i
+	* @param T root -  a
+	* @return Polynomial<T> - 
+	*/
+	Polynomial<T> Deflate(const T &root)
+	{
+		if (abs(root) <= 1)
+			return this->Divide(root);
+
+		int currentPolyDegree = this->Degree();
+		Polynomial<T> result(currentPolyDegree - 1);
+		result[0] = -this->coefficients[0] / root;
+		for (int i = 1; i < currentPolyDegree; i++) {
+			result[i] = (result[i - 1] - this->coefficients[i]) / root;
+		}
+
+		return result;
+	}
+
 	/*
 	*       
 	* @param T coefficient - 
@@ -90,6 +144,33 @@ public:
 		return result;
 	}
 
+	/*
+	*  .     
+	* : ,   ,   
+	* PolynomialMultiplySettings::fft (. PolynomialMultiply.h)
+	* @param Polynomial<T> rhs -  
+	*/
+	Polynomial<T> operator *(const Polynomial<T> &rhs) const
+	{
+		return Polynomial<T>(polynomial_multiply(this->coefficients, rhs.coefficients));
+	}
+
+	Polynomial<T>& operator *=(const Polynomial<T> &rhs)
+	{
+		this->coefficients = polynomial_multiply(this->coefficients, rhs.coefficients);
+		return *this;
+	}
+
+	/*
+	*  ,  P * P:    
+	*     ,   -  
+	*   
+	*/
+	Polynomial<T> Square() const
+	{
+		return Polynomial<T>(polynomial_square(this->coefficients));
+	}
+
 	/*
 	*   
 	* @return Polynomial<T> -  
@@ -171,8 +252,12 @@ public:
 	**  
 	*/
 	T Neuton(complex<double> someRoot) {
-		auto derivativePolinomial = this->Derivative();
-		return someRoot - (*this)(someRoot) / derivativePolinomial(someRoot);
+		// P(x)  P'(x)   ,   
+		T point = someRoot;
+		T value;
+		T derivative;
+		horner_evaluate(this->coefficients, 1, &point, &value, &derivative);
+		return someRoot - value / derivative;
 	}
 
 	complex <double> FindComplexRoot()
@@ -193,29 +278,51 @@ public:
 		complex <double> randomAlpha = this->GetRandomComplexNumber();
 		//    
 		Polynomial<complex<double>> shiftedPoly = normalizePoly.Shift(randomAlpha);
-		//  
-		QSMatrix <complex<double>> polyMatrix = this->GeneratePolynomialComplexMatrix(shiftedPoly);
-		QSMatrix <complex<double>> randomVector = this->GenerateRandomComplexVector(polyMatrix.get_cols());
+		//      ,
+		//     O(n)
+		CompanionOperator <complex<double>> companion(shiftedPoly.Coefficients());
+		QSMatrix <complex<double>> randomVector = this->GenerateRandomComplexVector(companion.size());
+		vector <complex<double>> x(companion.size());
+		vector <complex<double>> y;
+		double norm = 0;
+		for (unsigned i = 0; i < companion.size(); i++) {
+			x[i] = randomVector(i, 0);
+			norm += std::norm(x[i]);
+		}
+		norm = sqrt(norm);
+		for (unsigned i = 0; i < companion.size(); i++) {
+			x[i] /= norm;
+		}
 
-		QSMatrix <complex<double>> squaredMatrix = polyMatrix;
 		complex<double> lambda;
-		complex<double> uN;
-		complex<double> vN;
 		complex<double> prevLambda(0, 0);
 
 		int count = 0;
 		double difference = 9999;
 		double eps = 1e-3;
+		//         
+		int maxPowerCount = 1000;
 
-		//   
-		while (difference > eps)
+		//     :  
+		//   ,  -   x^H C x  |x| = 1
+		while (difference > eps && count < maxPowerCount)
 		{
-			squaredMatrix = squaredMatrix * polyMatrix;
-			QSMatrix <complex<double>> resultMatrix = squaredMatrix * randomVector;
-			
-			uN = resultMatrix(0, 0);
-			vN = resultMatrix(1, 0);
-			lambda = uN / vN;
+			companion.apply(x, y);
+
+			lambda = 0;
+			norm = 0;
+			for (unsigned i = 0; i < companion.size(); i++) {
+				lambda += conj(x[i]) * y[i];
+				norm += std::norm(y[i]);
+			}
+			norm = sqrt(norm);
+			if (norm == 0) {
+				// x   C: 0 -  
+				break;
+			}
+			for (unsigned i = 0; i < companion.size(); i++) {
+				x[i] = y[i] / norm;
+			}
 
 			if (count == 0)
 			{
@@ -234,9 +341,13 @@ public:
 		count = 0;
 		difference = 9999;
 		eps = 1e-10;
-		complex <double> initRoot = lambda;
+		//  -    P(x + alpha),
+		//  P  lambda + alpha
+		complex <double> initRoot = lambda + randomAlpha;
+		//    P(x)       eps
+		int maxNewtonCount = 100;
 
-		while (difference > eps)
+		while (difference > eps && count < maxNewtonCount)
 		{
 			auto nextRoot = this->Neuton(initRoot);
 			difference = abs(initRoot - nextRoot);
@@ -247,17 +358,29 @@ public:
 		return initRoot;
 	}
 
-	vector<complex<double>> FindComplexRoots()
+	/*
+	*    
+	*   x - a         ,
+	*       .    ,
+	*   
+	* @param RootMethod method -   
+	*/
+	vector<complex<double>> FindComplexRoots(RootMethod method = ROOTS_ABERTH)
 	{
 		vector<complex<double>> roots;
 		vector<complex<double>> coefficients = this->coefficients;
 
+		if (method == ROOTS_ABERTH) {
+			aberth_roots(coefficients, roots);
+			return roots;
+		}
+
 		while (coefficients.size() > 1)
 		{
 			Polynomial<complex<double>> tempPoly(coefficients);
 			complex<double> root = tempPoly.FindComplexRoot();
 			roots.push_back(root);
-			Polynomial<complex<double>> divResult = tempPoly.Divide(root);
+			Polynomial<complex<double>> divResult = tempPoly.Deflate(root);
 			coefficients = divResult.Coefficients();
 		}
 
@@ -265,65 +388,65 @@ public:
 	}
 
 	/*
-	*      
+	*      
+	*    (P, P'):   v   ,  ,
+	*       .   r 
+	* w(r) / v'(r),  w = P' / (P, P').     
+	*   (  ),   P  
+	* @param RootMethod method -    
 	*/
-	vector<pair<int, complex<double>>> FindComplexRootsWithDegrees()
+	vector<pair<int, complex<double>>> FindComplexRootsWithDegrees(RootMethod method = ROOTS_ABERTH)
 	{
 		vector<pair<int, complex<double>>> roots;
-		double epsilon = 1e-4;
-		Polynomial<complex<double>> tempPoly(this->coefficients);
-
-		while (tempPoly.Degree() >= 1)
-		{
-			int multipleDegree = 1;
-			complex<double> root = tempPoly.FindComplexRoot();
-			tempPoly = tempPoly.Divide(root);
-
-			while (abs(tempPoly(root)) < epsilon && tempPoly.Degree() > 0)
-			{
-				multipleDegree++;
-				tempPoly = tempPoly.Divide(root);
-			}
-			roots.push_back(make_pair(multipleDegree, root));
+		vector<complex<double>> coefficients = this->coefficients;
+		if (coefficients.size() < 2)
+			return roots;
+
+		vector<complex<double>> squareFree;
+		vector<complex<double>> derivativeQuotient;
+		square_free_part(coefficients, squareFree, derivativeQuotient, SquareFreeSettings::Instance().gcdTolerance);
+		vector<complex<double>> simpleRoots = Polynomial<complex<double>>(squareFree).FindComplexRoots(method);
+		vector<int> multiplicities = root_multiplicities(squareFree, derivativeQuotient, simpleRoots);
+
+		int degreeSum = 0;
+		for (int multiplicity : multiplicities) {
+			degreeSum += multiplicity;
+		}
+		if (degreeSum != this->Degree()) {
+			simpleRoots = Polynomial<complex<double>>(coefficients).FindComplexRoots(method);
+			multiplicities.assign(simpleRoots.size(), 1);
 		}
 
+		for (size_t i = 0; i < simpleRoots.size(); i++) {
+			roots.push_back(make_pair(multiplicities[i], simpleRoots[i]));
+		}
 		return roots;
 	}
 
 	/*
-	*    
+	*       ,
+	*    - RandomSource::Seed
 	* @return complex<double> -  
 	*/
 	complex<double> GetRandomComplexNumber()
 	{
-		random_device rd;
-		mt19937 gen(rd());
-		uniform_real_distribution<> dis(-0.2, 0.2);
-		double real = dis(gen);
-		double imag = dis(gen);
+		double real = RandomSource::Uniform(-0.2, 0.2);
+		double imag = RandomSource::Uniform(-0.2, 0.2);
 		return complex <double>(real, imag);
 	}
 
 	/*
 	*     a. P(x) -> P(x + a)
+	*       O(n^2).   
+	*    TaylorShiftSettings::divide,  
+	*   ,     
 	* @param T coefficient -  a
-	* @return Polynomial<T> -  
+	* @return Polynomial<T> -  P(x + a)
 	*/
-	Polynomial<T> Shift(T coefficient)
+	Polynomial<T> Shift(T coefficient) const
 	{
-		int currentPolyDegree = this->Degree();
-		vector<T> resultCoefficients;
-		for (int i = 0; i < currentPolyDegree; i++) {
-			//    x-a
-			auto tempPoly = this->Divide(coefficient);
-			//    
-			auto remainder = tempPoly(coefficient);
-			//  
-			resultCoefficients.push_back(remainder);
-		}
-
-		//   
-		resultCoefficients.push_back(this->coefficients[this->coefficients.size() - 1]);
+		vector<T> resultCoefficients = this->coefficients;
+		taylor_shift(resultCoefficients, coefficient);
 		return Polynomial <T>(resultCoefficients);
 	}
 
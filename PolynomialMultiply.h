@@ -0,0 +1,245 @@
+#pragma once
+#include <algorithm>
+#include <complex>
+#include <type_traits>
+#include <vector>
+#include "Fft.h"
+
+// Products of coefficient sequences (lowest degree first) by three methods
+// picked by the length of the shorter operand: schoolbook, Karatsuba with
+// 3 half-size products per level instead of 4, and FFT convolution when
+// enabled.
+
+// Element types the FFT path is enabled for. Its error is relative to the
+// largest coefficient of the operands, like ConvolutionSettings::fft, and
+// other types cannot go through a complex transform at all
+template <typename T>
+struct FftMultiplySupported : std::false_type {};
+
+template <>
+struct FftMultiplySupported<double> : std::true_type {};
+
+template <>
+struct FftMultiplySupported<std::complex<double>> : std::true_type {};
+
+// Tunable parameters of polynomial multiplication
+struct PolynomialMultiplySettings
+{
+	// Use FFT for long operands of the types in FftMultiplySupported. It is
+	// O(n log n) instead of O(n^1.58) but, as with ConvolutionSettings::fft,
+	// small coefficients next to huge ones lose precision; off by default
+	bool fft;
+	// Shorter operands of this length and below are multiplied by the
+	// schoolbook method
+	size_t karatsubaThreshold;
+	// With fft on, shorter operands of this length and above go through FFT
+	size_t fftThreshold;
+
+	static PolynomialMultiplySettings& Instance()
+	{
+		static PolynomialMultiplySettings settings = { false, 16, 64 };
+		return settings;
+	}
+};
+
+// r[0 .. na + nb - 1) += a * b by the schoolbook method
+template <typename T>
+void schoolbook_multiply_add(const T* a, size_t na, const T* b, size_t nb, T* r)
+{
+	for (size_t i = 0; i < na; i++) {
+		for (size_t j = 0; j < nb; j++) {
+			r[i + j] = r[i + j] + a[i] * b[j];
+		}
+	}
+}
+
+// r[0 .. na + nb - 1) += a * b by Karatsuba. An operand about twice as long
+// as the other or longer is cut into pieces of the shorter length first, so
+// that both halves of the split are non-empty
+template <typename T>
+void karatsuba_multiply_add(const T* a, size_t na, const T* b, size_t nb, T* r, size_t threshold)
+{
+	if (na < nb) {
+		std::swap(a, b);
+		std::swap(na, nb);
+	}
+	if (nb == 0)
+		return;
+	if (nb <= threshold || nb < 2) {
+		schoolbook_multiply_add(a, na, b, nb, r);
+		return;
+	}
+	if (na + 1 >= 2 * nb) {
+		for (size_t offset = 0; offset < na; offset += nb) {
+			karatsuba_multiply_add(a + offset, std::min(nb, na - offset), b, nb, r + offset, threshold);
+		}
+		return;
+	}
+
+	// a = a0 + x^h a1, b = b0 + x^h b1, na + 2 <= 2 nb makes nb > h
+	size_t h = (na + 1) / 2;
+	size_t na1 = na - h;
+	size_t nb1 = nb - h;
+	std::vector<T> sa(h), sb(h);
+	for (size_t i = 0; i < h; i++) {
+		sa[i] = i < na1 ? a[i] + a[h + i] : a[i];
+		sb[i] = i < nb1 ? b[i] + b[h + i] : b[i];
+	}
+
+	// The three products are independent, large ones go to the pool
+	std::vector<T> z0(2 * h - 1, T()), z1(2 * h - 1, T()), z2(na1 + nb1 - 1, T());
+	size_t grain = (size_t)h * h >= PARALLEL_MIN_ELEMENTS ? 1 : 3;
+	ThreadPool::Instance().ParallelFor(3, grain, [&](size_t begin, size_t end) {
+		for (size_t product = begin; product < end; product++) {
+			if (product == 0)
+				karatsuba_multiply_add(a, h, b, h, z0.data(), threshold);
+			else if (product == 1)
+				karatsuba_multiply_add(a + h, na1, b + h, nb1, z2.data(), threshold);
+			else
+				karatsuba_multiply_add(sa.data(), h, sb.data(), h, z1.data(), threshold);
+		}
+	});
+
+	// r += z0 + x^h (z1 - z0 - z2) + x^2h z2
+	for (size_t i = 0; i < z0.size(); i++) {
+		r[i] = r[i] + z0[i];
+		r[h + i] = r[h + i] + (z1[i] - z0[i]);
+	}
+	for (size_t i = 0; i < z2.size(); i++) {
+		r[h + i] = r[h + i] - z2[i];
+		r[2 * h + i] = r[2 * h + i] + z2[i];
+	}
+}
+
+// a * b through one pair of forward transforms and one inverse transform
+inline std::vector<std::complex<double>> multiply_fft(const std::vector<std::complex<double>>& a, const std::vector<std::complex<double>>& b)
+{
+	return convolve_fft(a, b, a.size() + b.size() - 1);
+}
+
+inline std::vector<double> multiply_fft(const std::vector<double>& a, const std::vector<double>& b)
+{
+	std::vector<std::complex<double>> product = multiply_fft(std::vector<std::complex<double>>(a.begin(), a.end()), std::vector<std::complex<double>>(b.begin(), b.end()));
+	std::vector<double> result(product.size());
+	for (size_t i = 0; i < product.size(); i++) {
+		result[i] = product[i].real();
+	}
+	return result;
+}
+
+// a * a through one forward transform instead of two
+inline std::vector<std::complex<double>> square_fft(const std::vector<std::complex<double>>& a)
+{
+	size_t length = 2 * a.size() - 1;
+	size_t size = 1;
+	while (size < length) {
+		size <<= 1;
+	}
+	std::vector<std::complex<double>> fa(a.begin(), a.end());
+	fa.resize(size);
+	fft(fa, false);
+	for (size_t i = 0; i < size; i++) {
+		fa[i] *= fa[i];
+	}
+	fft(fa, true);
+	fa.resize(length);
+	for (size_t i = 0; i < length; i++) {
+		fa[i] /= (double)size;
+	}
+	return fa;
+}
+
+inline std::vector<double> square_fft(const std::vector<double>& a)
+{
+	std::vector<std::complex<double>> square = square_fft(std::vector<std::complex<double>>(a.begin(), a.end()));
+	std::vector<double> result(square.size());
+	for (size_t i = 0; i < square.size(); i++) {
+		result[i] = square[i].real();
+	}
+	return result;
+}
+
+// Coefficients of the product of two polynomials, a.size() + b.size() - 1
+// of them (none when an operand is empty)
+template <typename T>
+std::vector<T> polynomial_multiply(const std::vector<T>& a, const std::vector<T>& b)
+{
+	if (a.empty() || b.empty())
+		return std::vector<T>();
+
+	const PolynomialMultiplySettings& settings = PolynomialMultiplySettings::Instance();
+	size_t shorter = std::min(a.size(), b.size());
+	if constexpr (FftMultiplySupported<T>::value) {
+		if (settings.fft && shorter >= settings.fftThreshold)
+			return multiply_fft(a, b);
+	}
+	if (shorter <= settings.karatsubaThreshold)
+		return convolve<T>(a, b, a.size() + b.size() - 1);
+
+	std::vector<T> result(a.size() + b.size() - 1, T());
+	karatsuba_multiply_add(a.data(), a.size(), b.data(), b.size(), result.data(), settings.karatsubaThreshold);
+	return result;
+}
+
+// r[0 .. 2n - 1) += a * a by Karatsuba: the three half-size products are
+// all squares, and the schoolbook base case counts each cross term once
+template <typename T>
+void karatsuba_square_add(const T* a, size_t n, T* r, size_t threshold)
+{
+	if (n <= threshold || n < 2) {
+		for (size_t i = 0; i < n; i++) {
+			r[2 * i] = r[2 * i] + a[i] * a[i];
+			for (size_t j = i + 1; j < n; j++) {
+				T product = a[i] * a[j];
+				r[i + j] = r[i + j] + product + product;
+			}
+		}
+		return;
+	}
+
+	size_t h = (n + 1) / 2;
+	size_t n1 = n - h;
+	std::vector<T> s(h);
+	for (size_t i = 0; i < h; i++) {
+		s[i] = i < n1 ? a[i] + a[h + i] : a[i];
+	}
+
+	std::vector<T> z0(2 * h - 1, T()), z1(2 * h - 1, T()), z2(2 * n1 - 1, T());
+	size_t grain = (size_t)h * h >= PARALLEL_MIN_ELEMENTS ? 1 : 3;
+	ThreadPool::Instance().ParallelFor(3, grain, [&](size_t begin, size_t end) {
+		for (size_t product = begin; product < end; product++) {
+			if (product == 0)
+				karatsuba_square_add(a, h, z0.data(), threshold);
+			else if (product == 1)
+				karatsuba_square_add(a + h, n1, z2.data(), threshold);
+			else
+				karatsuba_square_add(s.data(), h, z1.data(), threshold);
+		}
+	});
+
+	for (size_t i = 0; i < z0.size(); i++) {
+		r[i] = r[i] + z0[i];
+		r[h + i] = r[h + i] + (z1[i] - z0[i]);
+	}
+	for (size_t i = 0; i < z2.size(); i++) {
+		r[h + i] = r[h + i] - z2[i];
+		r[2 * h + i] = r[2 * h + i] + z2[i];
+	}
+}
+
+// Coefficients of the square of a polynomial
+template <typename T>
+std::vector<T> polynomial_square(const std::vector<T>& a)
+{
+	if (a.empty())
+		return std::vector<T>();
+
+	const PolynomialMultiplySettings& settings = PolynomialMultiplySettings::Instance();
+	if constexpr (FftMultiplySupported<T>::value) {
+		if (settings.fft && a.size() >= settings.fftThreshold)
+			return square_fft(a);
+	}
+	std::vector<T> result(2 * a.size() - 1, T());
+	karatsuba_square_add(a.data(), a.size(), result.data(), settings.karatsubaThreshold);
+	return result;
+}
@@ -6,12 +6,10 @@
 // Parameter Constructor       
 template<typename T>
 QSMatrix<T>::QSMatrix(unsigned _rows, unsigned _cols, const T& _initial) {
-	mat.resize(_rows);
-	for (unsigned i = 0; i < mat.size(); i++) {
-		mat[i].resize(_cols, _initial);
-	}
 	rows = _rows;
 	cols = _cols;
+	row_stride = padded_stride(_cols);
+	mat = AlignedBuffer<T>(static_cast<size_t>(rows) * row_stride, _initial);
 }
 
 // Copy Constructor                                                                                                                                                           
@@ -20,8 +18,35 @@ QSMatrix<T>::QSMatrix(const QSMatrix<T>& rhs) {
 	mat = rhs.mat;
 	rows = rhs.get_rows();
 	cols = rhs.get_cols();
+	row_stride = rhs.stride();
+}
+
+// Move Constructor
+template<typename T>
+QSMatrix<T>::QSMatrix(QSMatrix<T>&& rhs) noexcept : mat(std::move(rhs.mat)) {
+	rows = rhs.rows;
+	cols = rhs.cols;
+	row_stride = rhs.row_stride;
+	rhs.rows = 0;
+	rhs.cols = 0;
 }
 
+// Expression Constructor
+template<typename T>
+template<typename E>
+QSMatrix<T>::QSMatrix(const MatrixExpr<E>& expr) {
+	rows = expr.self().get_rows();
+	cols = expr.self().get_cols();
+	row_stride = padded_stride(cols);
+	mat = AlignedBuffer<T>::uninitialized(static_cast<size_t>(rows) * row_stride);
+	assign(expr.self());
+}
+
+// Expression Constructor, reusing the buffer of a temporary operand
+template<typename T>
+template<typename E, typename>
+QSMatrix<T>::QSMatrix(E&& expr) : QSMatrix(evaluate_reusing(expr)) {}
+
 // (Virtual) Destructor                                                                                                                                                       
 template<typename T>
 QSMatrix<T>::~QSMatrix() {}
@@ -32,175 +57,214 @@ QSMatrix<T>& QSMatrix<T>::operator=(const QSMatrix<T>& rhs) {
 	if (&rhs == this)
 		return *this;
 
-	unsigned new_rows = rhs.get_rows();
-	unsigned new_cols = rhs.get_cols();
-
-	mat.resize(new_rows);
-	for (unsigned i = 0; i < mat.size(); i++) {
-		mat[i].resize(new_cols);
-	}
-
-	for (unsigned i = 0; i < new_rows; i++) {
-		for (unsigned j = 0; j < new_cols; j++) {
-			mat[i][j] = rhs(i, j);
-		}
-	}
-	rows = new_rows;
-	cols = new_cols;
+	mat = rhs.mat;
+	rows = rhs.get_rows();
+	cols = rhs.get_cols();
+	row_stride = rhs.stride();
 
 	return *this;
 }
 
-// Addition of two matrices                                                                                                                                                   
+// Move Assignment Operator
 template<typename T>
-QSMatrix<T> QSMatrix<T>::operator+(const QSMatrix<T>& rhs) {
-	QSMatrix result(rows, cols, 0.0);
+QSMatrix<T>& QSMatrix<T>::operator=(QSMatrix<T>&& rhs) noexcept {
+	if (&rhs == this)
+		return *this;
 
-	for (unsigned i = 0; i < rows; i++) {
-		for (unsigned j = 0; j < cols; j++) {
-			result(i, j) = this->mat[i][j] + rhs(i, j);
-		}
-	}
+	mat = std::move(rhs.mat);
+	rows = rhs.rows;
+	cols = rhs.cols;
+	row_stride = rhs.row_stride;
+	rhs.rows = 0;
+	rhs.cols = 0;
 
-	return result;
+	return *this;
 }
 
-// Cumulative addition of this matrix and another                                                                                                                             
+// Expression Assignment Operator
 template<typename T>
-QSMatrix<T>& QSMatrix<T>::operator+=(const QSMatrix<T>& rhs) {
-	unsigned rows = rhs.get_rows();
-	unsigned cols = rhs.get_cols();
-
-	for (unsigned i = 0; i < rows; i++) {
-		for (unsigned j = 0; j < cols; j++) {
-			this->mat[i][j] += rhs(i, j);
-		}
+template<typename E>
+QSMatrix<T>& QSMatrix<T>::operator=(const MatrixExpr<E>& expr) {
+	const E& source = expr.self();
+	// Each element only depends on the same element of the operands,
+	// so a matrix of the right size can be overwritten in place
+	if (source.get_rows() == rows && source.get_cols() == cols) {
+		assign(source);
+		return *this;
 	}
 
+	QSMatrix result(source);
+	mat.swap(result.mat);
+	rows = result.rows;
+	cols = result.cols;
+	row_stride = result.row_stride;
+
 	return *this;
 }
 
-// Subtraction of this matrix and another                                                                                                                                     
+// Expression Assignment Operator, reusing the buffer of a temporary operand
 template<typename T>
-QSMatrix<T> QSMatrix<T>::operator-(const QSMatrix<T>& rhs) {
-	unsigned rows = rhs.get_rows();
-	unsigned cols = rhs.get_cols();
-	QSMatrix result(rows, cols, 0.0);
-
-	for (unsigned i = 0; i < rows; i++) {
-		for (unsigned j = 0; j < cols; j++) {
-			result(i, j) = this->mat[i][j] - rhs(i, j);
-		}
+template<typename E, typename>
+QSMatrix<T>& QSMatrix<T>::operator=(E&& expr) {
+	if (expr.get_rows() == rows && expr.get_cols() == cols) {
+		assign(expr);
+		return *this;
 	}
 
-	return result;
+	return (*this) = evaluate_reusing(expr);
+}
+
+// Cumulative addition of this matrix and another                                                                                                                             
+template<typename T>
+template<typename E>
+QSMatrix<T>& QSMatrix<T>::operator+=(const MatrixExpr<E>& rhs) {
+	update<ExprAdd>(rhs.self());
+	return *this;
 }
 
 // Cumulative subtraction of this matrix and another                                                                                                                          
 template<typename T>
-QSMatrix<T>& QSMatrix<T>::operator-=(const QSMatrix<T>& rhs) {
-	unsigned rows = rhs.get_rows();
-	unsigned cols = rhs.get_cols();
+template<typename E>
+QSMatrix<T>& QSMatrix<T>::operator-=(const MatrixExpr<E>& rhs) {
+	update<ExprSub>(rhs.self());
+	return *this;
+}
+
+// Evaluate an rvalue expression, in place over its temporary operand if it has one
+template<typename T>
+template<typename E>
+QSMatrix<T> QSMatrix<T>::evaluate_reusing(const E& expr) {
+	QSMatrix<T>* temp = reusable_matrix(expr);
+	if (temp == nullptr)
+		return QSMatrix<T>(expr);
+
+	temp->assign(expr);
+	return std::move(*temp);
+}
 
-	for (unsigned i = 0; i < rows; i++) {
-		for (unsigned j = 0; j < cols; j++) {
-			this->mat[i][j] -= rhs(i, j);
-		}
-	}
+// Matrices are used as they are, expressions are evaluated into a matrix
+template<typename T>
+const QSMatrix<T>& evaluate(const QSMatrix<T>& matrix) {
+	return matrix;
+}
 
-	return *this;
+template<typename E>
+QSMatrix<typename E::value_type> evaluate(const MatrixExpr<E>& expr) {
+	return QSMatrix<typename E::value_type>(expr);
 }
 
 // Left multiplication of this matrix and another                                                                                                                              
-template<typename T>
-QSMatrix<T> QSMatrix<T>::operator*(const QSMatrix<T>& rhs) {
-	unsigned rows = this->rows;
-	unsigned cols = rhs.get_cols();
-	QSMatrix result(rows, cols, 0.0);
+template<typename L, typename R>
+QSMatrix<typename L::value_type> operator*(const MatrixExpr<L>& lhs, const MatrixExpr<R>& rhs) {
+	typedef typename L::value_type T;
+	const QSMatrix<T>& a = evaluate(lhs.self());
+	const QSMatrix<T>& b = evaluate(rhs.self());
+	unsigned rows = a.get_rows();
+	unsigned cols = b.get_cols();
+	QSMatrix<T> result(rows, cols, T());
 
-	for (unsigned i = 0; i < rows; i++) {
-		for (unsigned j = 0; j < cols; j++) {
-			for (unsigned k = 0; k < this->get_cols(); k++) {
-				result(i, j) = result(i, j) + this->mat[i][k] * rhs(k, j);
-			}
-		}
-	}
+	multiply_dispatch(rows, cols, a.get_cols(), a.data(), a.stride(), b.data(), b.stride(), result.data(), result.stride());
 
 	return result;
 }
 
-// Cumulative left multiplication of this matrix and another                                                                                                                  
+// Cumulative left multiplication of this matrix and another. The product
+// needs a buffer of its own, so every call allocates one; loops should use
+// multiply_assign with a scratch matrix they keep
 template<typename T>
 QSMatrix<T>& QSMatrix<T>::operator*=(const QSMatrix<T>& rhs) {
-	QSMatrix result = (*this) * rhs;
-	(*this) = result;
-	return *this;
+	QSMatrix<T> product(rows, rhs.get_cols(), T());
+	multiply_dispatch(rows, product.cols, cols, this->data(), row_stride, rhs.data(), rhs.stride(), product.data(), product.row_stride);
+	return (*this) = std::move(product);
 }
 
-// Calculate a transpose of this matrix                                                                                                                                       
+// Cumulative left multiplication through a scratch matrix owned by the
+// caller: the product is written there and swapped in, and our old buffer
+// is left in scratch for the next call. Like the loop of pow(), repeated
+// calls with the same shapes allocate nothing after the first
 template<typename T>
-QSMatrix<T> QSMatrix<T>::transpose() {
-	QSMatrix result(rows, cols, 0.0);
+QSMatrix<T>& QSMatrix<T>::multiply_assign(const QSMatrix<T>& rhs, QSMatrix<T>& scratch) {
+	assert(&scratch != this && &scratch != &rhs && "scratch must not be an operand");
+	unsigned new_cols = rhs.get_cols();
+	if (scratch.rows != rows || scratch.cols != new_cols)
+		scratch = QSMatrix<T>(rows, new_cols, T());
+	else
+		std::fill(scratch.data(), scratch.data() + static_cast<size_t>(rows) * scratch.row_stride, T());
 
-	for (unsigned i = 0; i < rows; i++) {
-		for (unsigned j = 0; j < cols; j++) {
-			result(i, j) = this->mat[j][i];
-		}
-	}
+	multiply_dispatch(rows, new_cols, cols, this->data(), row_stride, rhs.data(), rhs.stride(), scratch.data(), scratch.row_stride);
 
-	return result;
+	std::swap(*this, scratch);
+	return *this;
 }
 
-// Matrix/scalar addition                                                                                                                                                     
+// Power of a square matrix: O(log k) products. The product goes to a
+// scratch matrix which is then swapped in, so after the three initial
+// allocations the loop allocates nothing
 template<typename T>
-QSMatrix<T> QSMatrix<T>::operator+(const T& rhs) {
-	QSMatrix result(rows, cols, 0.0);
-
-	for (unsigned i = 0; i < rows; i++) {
-		for (unsigned j = 0; j < cols; j++) {
-			result(i, j) = this->mat[i][j] + rhs;
+QSMatrix<T> pow(const QSMatrix<T>& base, unsigned exponent) {
+	unsigned n = base.get_rows();
+	QSMatrix<T> result(n, n, T());
+	if (exponent == 0) {
+		for (unsigned i = 0; i < n; i++) {
+			result(i, i) = T(1);
 		}
+		return result;
 	}
 
-	return result;
-}
-
-// Matrix/scalar subtraction                                                                                                                                                  
-template<typename T>
-QSMatrix<T> QSMatrix<T>::operator-(const T& rhs) {
-	QSMatrix result(rows, cols, 0.0);
-
-	for (unsigned i = 0; i < rows; i++) {
-		for (unsigned j = 0; j < cols; j++) {
-			result(i, j) = this->mat[i][j] - rhs;
+	QSMatrix<T> square = base;
+	QSMatrix<T> scratch(n, n, T());
+	size_t size = static_cast<size_t>(n) * scratch.stride();
+	bool first = true;
+	while (true) {
+		if (exponent & 1) {
+			if (first) {
+				result = square;
+				first = false;
+			} else {
+				std::fill(scratch.data(), scratch.data() + size, T());
+				multiply_dispatch(n, n, n, result.data(), result.stride(), square.data(), square.stride(), scratch.data(), scratch.stride());
+				std::swap(result, scratch);
+			}
 		}
+		exponent >>= 1;
+		if (exponent == 0)
+			break;
+		std::fill(scratch.data(), scratch.data() + size, T());
+		multiply_dispatch(n, n, n, square.data(), square.stride(), square.data(), square.stride(), scratch.data(), scratch.stride());
+		std::swap(square, scratch);
 	}
-
 	return result;
 }
 
-// Matrix/scalar multiplication                                                                                                                                               
+// All powers A^1, ..., A^count, every product is written straight into
+// its slot of the result
 template<typename T>
-QSMatrix<T> QSMatrix<T>::operator*(const T& rhs) {
-	QSMatrix result(rows, cols, 0.0);
-
-	for (unsigned i = 0; i < rows; i++) {
-		for (unsigned j = 0; j < cols; j++) {
-			result(i, j) = this->mat[i][j] * rhs;
-		}
+std::vector<QSMatrix<T>> powers(const QSMatrix<T>& base, unsigned count) {
+	unsigned n = base.get_rows();
+	std::vector<QSMatrix<T>> result;
+	result.reserve(count);
+	if (count == 0)
+		return result;
+
+	result.push_back(base);
+	for (unsigned k = 1; k < count; k++) {
+		result.emplace_back(n, n, T());
+		const QSMatrix<T>& previous = result[k - 1];
+		QSMatrix<T>& current = result[k];
+		multiply_dispatch(n, n, n, previous.data(), previous.stride(), base.data(), base.stride(), current.data(), current.stride());
 	}
-
 	return result;
 }
 
-// Matrix/scalar division                                                                                                                                                     
+// Calculate a transpose of this matrix                                                                                                                                       
 template<typename T>
-QSMatrix<T> QSMatrix<T>::operator/(const T& rhs) {
-	QSMatrix result(rows, cols, 0.0);
+QSMatrix<T> QSMatrix<T>::transpose() {
+	QSMatrix result(cols, rows, T());
 
 	for (unsigned i = 0; i < rows; i++) {
+		const T* a = this->data() + i * row_stride;
 		for (unsigned j = 0; j < cols; j++) {
-			result(i, j) = this->mat[i][j] / rhs;
+			result(j, i) = a[j];
 		}
 	}
 
@@ -210,13 +274,13 @@ QSMatrix<T> QSMatrix<T>::operator/(const T& rhs) {
 // Multiply a matrix with a vector                                                                                                                                            
 template<typename T>
 std::vector<T> QSMatrix<T>::operator*(const std::vector<T>& rhs) {
-	std::vector<T> result(rhs.size(), 0.0);
+	std::vector<T> result(rows, T());
 
-	for (unsigned i = 0; i < rows; i++) {
-		for (unsigned j = 0; j < cols; j++) {
-			result[i] = this->mat[i][j] * rhs[j];
+	for_row_blocks([&](unsigned begin, unsigned end) {
+		for (unsigned i = begin; i < end; i++) {
+			result[i] = row_dot(cols, this->data() + i * row_stride, rhs.data());
 		}
-	}
+	});
 
 	return result;
 }
@@ -224,10 +288,10 @@ std::vector<T> QSMatrix<T>::operator*(const std::vector<T>& rhs) {
 // Obtain a vector of the diagonal elements                                                                                                                                   
 template<typename T>
 std::vector<T> QSMatrix<T>::diag_vec() {
-	std::vector<T> result(rows, 0.0);
+	std::vector<T> result(rows, T());
 
 	for (unsigned i = 0; i < rows; i++) {
-		result[i] = this->mat[i][i];
+		result[i] = (*this)(i, i);
 	}
 
 	return result;
@@ -236,13 +300,13 @@ std::vector<T> QSMatrix<T>::diag_vec() {
 // Access the individual elements                                                                                                                                             
 template<typename T>
 T& QSMatrix<T>::operator()(const unsigned& row, const unsigned& col) {
-	return this->mat[row][col];
+	return this->mat[row * row_stride + col];
 }
 
 // Access the individual elements (const)                                                                                                                                     
 template<typename T>
 const T& QSMatrix<T>::operator()(const unsigned& row, const unsigned& col) const {
-	return this->mat[row][col];
+	return this->mat[row * row_stride + col];
 }
 
 // Get the number of rows of the matrix                                                                                                                                       
@@ -257,6 +321,70 @@ unsigned QSMatrix<T>::get_cols() const {
 	return this->cols;
 }
 
+// Get the raw pointer to the first element
+template<typename T>
+T* QSMatrix<T>::data() {
+	return this->mat.data();
+}
+
+// Get the raw pointer to the first element (const)
+template<typename T>
+const T* QSMatrix<T>::data() const {
+	return this->mat.data();
+}
+
+// Get the distance in elements between the starts of two adjacent rows
+template<typename T>
+unsigned QSMatrix<T>::stride() const {
+	return this->row_stride;
+}
+
+// Round the row length up to a whole number of cache lines
+template<typename T>
+unsigned QSMatrix<T>::padded_stride(unsigned _cols) {
+	const unsigned line = CACHE_LINE_SIZE % sizeof(T) == 0 ? CACHE_LINE_SIZE / sizeof(T) : 1;
+	return (_cols + line - 1) / line * line;
+}
+
+// Run func(begin, end) over blocks of rows, in parallel for large matrices
+template<typename T>
+template<typename Func>
+void QSMatrix<T>::for_row_blocks(Func func) const {
+	size_t grain = std::max<size_t>(1, PARALLEL_MIN_ELEMENTS / std::max(cols, 1u));
+	ThreadPool::Instance().ParallelFor(rows, grain, [&func](size_t begin, size_t end) {
+		func((unsigned)begin, (unsigned)end);
+	});
+}
+
+// Get a view of the i-th row for expression evaluation
+template<typename T>
+typename QSMatrix<T>::RowType QSMatrix<T>::row(unsigned i) const {
+	return this->data() + i * row_stride;
+}
+
+// Evaluate an expression of the same size into this matrix
+template<typename T>
+template<typename E>
+void QSMatrix<T>::assign(const E& expr) {
+	for_row_blocks([&](unsigned begin, unsigned end) {
+		for (unsigned i = begin; i < end; i++) {
+			eval_expr_row(expr, i, cols, this->data() + i * row_stride);
+		}
+	});
+}
+
+// Combine every element with the same element of an expression of the same
+// size in place, for += and -=
+template<typename T>
+template<typename Op, typename E>
+void QSMatrix<T>::update(const E& expr) {
+	for_row_blocks([&](unsigned begin, unsigned end) {
+		for (unsigned i = begin; i < end; i++) {
+			update_expr_row(Op(), expr, i, cols, this->data() + i * row_stride);
+		}
+	});
+}
+
 #endif
 
 
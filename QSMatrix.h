@@ -1,38 +1,78 @@
 #ifndef __QS_MATRIX_H
 #define __QS_MATRIX_H
 
+#include <cassert>
 #include <vector>
+#include "AlignedBuffer.h"
+#include "Gemm.h"
+#include "MatrixExpr.h"
+#include "RowKernels.h"
+#include "Strassen.h"
+#include "ThreadPool.h"
 
 template <typename T>
-class QSMatrix
+class QSMatrix : public MatrixExpr<QSMatrix<T>>
 {
 private:
-	std::vector<std::vector<T>> mat;
+	// Row-major storage in a single aligned block, rows are row_stride apart
+	AlignedBuffer<T> mat;
 	unsigned rows;
 	unsigned cols;
+	unsigned row_stride;
+
+	static unsigned padded_stride(unsigned _cols);
+
+	template <typename Func>
+	void for_row_blocks(Func func) const;
+
+	template <typename E>
+	void assign(const E& expr);
+
+	template <typename Op, typename E>
+	void update(const E& expr);
+
+	template <typename E>
+	static QSMatrix<T> evaluate_reusing(const E& expr);
+
+	// Rvalue expressions other than a plain QSMatrix
+	template <typename E>
+	using IfTemporaryExpr = typename std::enable_if<IsMatrixExpr<E>::value && !std::is_lvalue_reference<E>::value
+		&& !std::is_same<typename std::decay<E>::type, QSMatrix<T>>::value>::type;
 public:
+	typedef T value_type;
+	typedef const T* RowType;
+
 	QSMatrix(unsigned _rows, unsigned _cols, const T& _initial);
 	QSMatrix(const QSMatrix<T>& rhs);
+	QSMatrix(QSMatrix<T>&& rhs) noexcept;
+	// Evaluates an element-wise expression (see MatrixExpr.h) in one pass
+	template <typename E>
+	QSMatrix(const MatrixExpr<E>& expr);
+	// Same, but writes the result over a temporary operand when there is one
+	template <typename E, typename = IfTemporaryExpr<E>>
+	QSMatrix(E&& expr);
 	virtual ~QSMatrix();
 
 	// Operator overloading, for "standard" mathematical matrix operations                                                                                                                                                          
 	QSMatrix<T>& operator=(const QSMatrix<T>& rhs);
+	QSMatrix<T>& operator=(QSMatrix<T>&& rhs) noexcept;
+	template <typename E>
+	QSMatrix<T>& operator=(const MatrixExpr<E>& expr);
+	template <typename E, typename = IfTemporaryExpr<E>>
+	QSMatrix<T>& operator=(E&& expr);
 
 	// Matrix mathematical operations                                                                                                                                                                                               
-	QSMatrix<T> operator+(const QSMatrix<T>& rhs);
-	QSMatrix<T>& operator+=(const QSMatrix<T>& rhs);
-	QSMatrix<T> operator-(const QSMatrix<T>& rhs);
-	QSMatrix<T>& operator-=(const QSMatrix<T>& rhs);
-	QSMatrix<T> operator*(const QSMatrix<T>& rhs);
+	// +, - and the matrix/scalar operators are lazy expressions (MatrixExpr.h),
+	// the product is evaluated eagerly by the GEMM kernels
+	template <typename E>
+	QSMatrix<T>& operator+=(const MatrixExpr<E>& rhs);
+	template <typename E>
+	QSMatrix<T>& operator-=(const MatrixExpr<E>& rhs);
 	QSMatrix<T>& operator*=(const QSMatrix<T>& rhs);
+	// Same as *=, with the product buffer kept in scratch between calls
+	QSMatrix<T>& multiply_assign(const QSMatrix<T>& rhs, QSMatrix<T>& scratch);
 	QSMatrix<T> transpose();
 
-	// Matrix/scalar operations                                                                                                                                                                                                     
-	QSMatrix<T> operator+(const T& rhs);
-	QSMatrix<T> operator-(const T& rhs);
-	QSMatrix<T> operator*(const T& rhs);
-	QSMatrix<T> operator/(const T& rhs);
-
 	// Matrix/vector operations                                                                                                                                                                                                     
 	std::vector<T> operator*(const std::vector<T>& rhs);
 	std::vector<T> diag_vec();
@@ -41,10 +81,28 @@ public:
 	T& operator()(const unsigned& row, const unsigned& col);
 	const T& operator()(const unsigned& row, const unsigned& col) const;
 
+	// Raw access to the storage, element (i, j) is data()[i * stride() + j]
+	T* data();
+	const T* data() const;
+	unsigned stride() const;
+	RowType row(unsigned i) const;
+
 	// Access the row and column sizes                                                                                                                                                                                              
 	unsigned get_rows() const;
 	unsigned get_cols() const;
 };
 
+// Matrix product, operands that are expressions are evaluated first
+template <typename L, typename R>
+QSMatrix<typename L::value_type> operator*(const MatrixExpr<L>& lhs, const MatrixExpr<R>& rhs);
+
+// Power of a square matrix by repeated squaring, pow(A, 0) is the identity
+template <typename T>
+QSMatrix<T> pow(const QSMatrix<T>& base, unsigned exponent);
+
+// All powers A^1, ..., A^count of a square matrix
+template <typename T>
+std::vector<QSMatrix<T>> powers(const QSMatrix<T>& base, unsigned count);
+
 #include "QSMatrix.cpp"
 #endif
\ No newline at end of file
@@ -0,0 +1,123 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <random>
+
+// Random numbers for the randomized algorithms: one small fast engine per
+// thread, seeded lazily, or reproducibly after RandomSource::Seed.
+
+// SplitMix64 step: turns a counter into a well mixed 64-bit value. Used to
+// expand one seed into the engine state
+inline uint64_t splitmix64(uint64_t& state)
+{
+	uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	return z ^ (z >> 31);
+}
+
+// xoshiro256** (Blackman, Vigna): 32 bytes of state, period 2^256 - 1, a few
+// cycles per number. Meets UniformRandomBitGenerator, so it also works with
+// the <random> distributions
+class Xoshiro256
+{
+private:
+	uint64_t state[4];
+
+	static uint64_t rotl(uint64_t x, int k)
+	{
+		return (x << k) | (x >> (64 - k));
+	}
+
+public:
+	typedef uint64_t result_type;
+
+	explicit Xoshiro256(uint64_t seed = 0)
+	{
+		this->seed(seed);
+	}
+
+	void seed(uint64_t seed)
+	{
+		for (int i = 0; i < 4; i++) {
+			state[i] = splitmix64(seed);
+		}
+	}
+
+	static constexpr result_type min() { return 0; }
+	static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+	result_type operator()()
+	{
+		uint64_t result = rotl(state[1] * 5, 7) * 9;
+		uint64_t t = state[1] << 17;
+		state[2] ^= state[0];
+		state[3] ^= state[1];
+		state[1] ^= state[2];
+		state[0] ^= state[3];
+		state[2] ^= t;
+		state[3] = rotl(state[3], 45);
+		return result;
+	}
+
+	// Uniform in [0, 1) from the top 53 bits
+	double canonical()
+	{
+		return (double)((*this)() >> 11) * (1.0 / 9007199254740992.0);
+	}
+};
+
+// Per-thread random engine. Without a seed every thread draws its own from
+// std::random_device once, on first use. After Seed(seed) the calling thread
+// restarts from seed, and threads that create their engine afterwards get
+// seeds derived from it in creation order
+class RandomSource
+{
+private:
+	struct SeedState
+	{
+		std::atomic<bool> seeded;
+		std::atomic<uint64_t> base;
+		std::atomic<uint64_t> streams;
+	};
+
+	static SeedState& State()
+	{
+		static SeedState state = { { false }, { 0 }, { 0 } };
+		return state;
+	}
+
+	static uint64_t NewThreadSeed()
+	{
+		SeedState& state = State();
+		if (!state.seeded.load()) {
+			std::random_device device;
+			return ((uint64_t)device() << 32) ^ device();
+		}
+		uint64_t stream = state.base.load() + (state.streams.fetch_add(1) + 1) * 0xd1b54a32d192ed03ULL;
+		return splitmix64(stream);
+	}
+
+public:
+	static Xoshiro256& Engine()
+	{
+		static thread_local Xoshiro256 engine(NewThreadSeed());
+		return engine;
+	}
+
+	static void Seed(uint64_t seed)
+	{
+		SeedState& state = State();
+		state.base.store(seed);
+		state.streams.store(0);
+		state.seeded.store(true);
+		Engine().seed(seed);
+	}
+
+	// Uniform in [low, high)
+	static double Uniform(double low, double high)
+	{
+		return low + (high - low) * Engine().canonical();
+	}
+};
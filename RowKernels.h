@@ -0,0 +1,78 @@
+#pragma once
+#include <complex>
+#include "ComplexKernels.h"
+
+// Element-wise loops over contiguous rows. The generic versions are plain
+// loops, the complex<double> overloads go to the dispatched SIMD kernels.
+
+// r[j] = x[j] + y[j]
+template <typename T>
+inline void row_add(unsigned n, const T* x, const T* y, T* r)
+{
+	for (unsigned j = 0; j < n; j++) {
+		r[j] = x[j] + y[j];
+	}
+}
+
+// r[j] = x[j] - y[j]
+template <typename T>
+inline void row_sub(unsigned n, const T* x, const T* y, T* r)
+{
+	for (unsigned j = 0; j < n; j++) {
+		r[j] = x[j] - y[j];
+	}
+}
+
+// r[j] = x[j] * alpha
+template <typename T>
+inline void row_scale(unsigned n, const T& alpha, const T* x, T* r)
+{
+	for (unsigned j = 0; j < n; j++) {
+		r[j] = x[j] * alpha;
+	}
+}
+
+// y[j] = y[j] + alpha * x[j]
+template <typename T>
+inline void row_axpy(unsigned n, const T& alpha, const T* x, T* y)
+{
+	for (unsigned j = 0; j < n; j++) {
+		y[j] = y[j] + alpha * x[j];
+	}
+}
+
+// Sum of x[j] * y[j]
+template <typename T>
+inline T row_dot(unsigned n, const T* x, const T* y)
+{
+	T result = T();
+	for (unsigned j = 0; j < n; j++) {
+		result = result + x[j] * y[j];
+	}
+	return result;
+}
+
+inline void row_add(unsigned n, const std::complex<double>* x, const std::complex<double>* y, std::complex<double>* r)
+{
+	ComplexKernels::Get().add(n, x, y, r);
+}
+
+inline void row_sub(unsigned n, const std::complex<double>* x, const std::complex<double>* y, std::complex<double>* r)
+{
+	ComplexKernels::Get().sub(n, x, y, r);
+}
+
+inline void row_scale(unsigned n, const std::complex<double>& alpha, const std::complex<double>* x, std::complex<double>* r)
+{
+	ComplexKernels::Get().scale(n, alpha, x, r);
+}
+
+inline void row_axpy(unsigned n, const std::complex<double>& alpha, const std::complex<double>* x, std::complex<double>* y)
+{
+	ComplexKernels::Get().axpy(n, alpha, x, y);
+}
+
+inline std::complex<double> row_dot(unsigned n, const std::complex<double>* x, const std::complex<double>* y)
+{
+	return ComplexKernels::Get().dot(n, x, y);
+}
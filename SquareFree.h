@@ -0,0 +1,195 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <vector>
+#include "Horner.h"
+
+// Numerical square-free decomposition: P = u v with u = gcd(P, P'), so v
+// has every root of P exactly once. Roots of v are simple, Newton and
+// Aberth converge fast on them, and the multiplicities follow from w = P' / u.
+// Coefficients come lowest degree first.
+
+// Tunable parameters of the square-free decomposition
+struct SquareFreeSettings
+{
+	// A remainder of the Euclidean algorithm is taken for zero when its
+	// coefficients are below this fraction of the terms it came from. Too
+	// small and rounding hides multiple roots, too large and close simple
+	// roots merge
+	double gcdTolerance;
+
+	static SquareFreeSettings& Instance()
+	{
+		static SquareFreeSettings settings = { 1e-8 };
+		return settings;
+	}
+};
+
+// Largest coefficient modulus
+template <typename T>
+double max_coefficient(const std::vector<T>& a)
+{
+	double result = 0;
+	for (size_t i = 0; i < a.size(); i++) {
+		result = std::max<double>(result, std::abs(a[i]));
+	}
+	return result;
+}
+
+// Divides by the largest coefficient modulus, unless the polynomial is zero
+template <typename T>
+void scale_to_unit(std::vector<T>& a)
+{
+	double scale = max_coefficient(a);
+	if (scale == 0)
+		return;
+	for (size_t i = 0; i < a.size(); i++) {
+		a[i] = a[i] / (T)scale;
+	}
+}
+
+template <typename T>
+std::vector<T> polynomial_derivative(const std::vector<T>& a)
+{
+	std::vector<T> result(a.size() > 1 ? a.size() - 1 : 0);
+	for (size_t i = 1; i < a.size(); i++) {
+		result[i - 1] = a[i] * (T)(double)i;
+	}
+	return result;
+}
+
+// Quotient of a / b by long division from the leading coefficient, the
+// remainder (b.size() - 1 coefficients) goes to remainder unless it is null.
+// b.back() must not be zero
+template <typename T>
+std::vector<T> polynomial_divide(const std::vector<T>& a, const std::vector<T>& b, std::vector<T>* remainder = nullptr)
+{
+	size_t nb = b.size();
+	std::vector<T> r = a;
+	std::vector<T> q(a.size() >= nb ? a.size() - nb + 1 : 0);
+	for (size_t k = q.size(); k-- > 0;) {
+		q[k] = r[k + nb - 1] / b[nb - 1];
+		for (size_t j = 0; j < nb; j++) {
+			r[k + j] = r[k + j] - q[k] * b[j];
+		}
+	}
+	if (remainder != nullptr) {
+		r.resize(std::min(r.size(), nb - 1));
+		*remainder = r;
+	}
+	return q;
+}
+
+// Monic approximate gcd by the Euclidean algorithm. Both operands and every
+// remainder are scaled to unit largest coefficient; a remainder below
+// tolerance times the size of the step (dividend, or quotient times
+// divisor) counts as zero, and so do its leading coefficients below that
+// bound. Gives { 1 } for coprime operands
+template <typename T>
+std::vector<T> approximate_gcd(const std::vector<T>& first, const std::vector<T>& second, double tolerance)
+{
+	std::vector<T> a = first;
+	std::vector<T> b = second;
+	if (a.size() < b.size())
+		std::swap(a, b);
+	scale_to_unit(a);
+	scale_to_unit(b);
+	// gcd(a, 0) = a
+	if (max_coefficient(b) == 0)
+		a.swap(b);
+
+	while (b.size() > 1) {
+		std::vector<T> r;
+		std::vector<T> q = polynomial_divide(a, b, &r);
+		double bound = tolerance * std::max(max_coefficient(a), max_coefficient(q) * max_coefficient(b));
+		while (!r.empty() && std::abs(r.back()) <= bound) {
+			r.pop_back();
+		}
+		if (r.empty())
+			break;
+
+		scale_to_unit(r);
+		a.swap(b);
+		b.swap(r);
+	}
+
+	if (b.size() == 1)
+		return std::vector<T>(1, T(1));
+	T lead = b.back();
+	for (size_t i = 0; i < b.size(); i++) {
+		b[i] = b[i] / lead;
+	}
+	return b;
+}
+
+// Power of two near the geometric mean modulus of the nonzero roots,
+// |a_k / a_n|^(1 / (n - k)) for the lowest nonzero a_k. Substituting x = s y
+// brings those roots near the unit circle and the coefficients to similar
+// sizes, which keeps the Euclidean algorithm stable; a power of two makes the
+// substitution exact
+template <typename T>
+double root_scale(const std::vector<T>& p)
+{
+	size_t n = p.size() - 1;
+	size_t k = 0;
+	while (k < n && std::abs(p[k]) == 0) {
+		k++;
+	}
+	if (k == n)
+		return 1;
+	double magnitude = std::pow(std::abs(p[k]) / std::abs(p[n]), 1.0 / (double)(n - k));
+	if (!std::isfinite(magnitude) || magnitude == 0)
+		return 1;
+	return std::ldexp(1.0, std::ilogb(magnitude));
+}
+
+// squareFree = P / u and derivativeQuotient = P' / u for u = gcd(P, P'),
+// computed on P(s x) for s = root_scale(P) and scaled back. P must have
+// degree 1 or more
+template <typename T>
+void square_free_part(const std::vector<T>& p, std::vector<T>& squareFree, std::vector<T>& derivativeQuotient, double tolerance)
+{
+	double s = root_scale(p);
+	std::vector<T> scaled(p.size());
+	double power = 1;
+	for (size_t i = 0; i < p.size(); i++) {
+		scaled[i] = p[i] * (T)power;
+		power *= s;
+	}
+
+	std::vector<T> derivative = polynomial_derivative(scaled);
+	std::vector<T> gcd = approximate_gcd(scaled, derivative, tolerance);
+	squareFree = polynomial_divide(scaled, gcd);
+	derivativeQuotient = polynomial_divide(derivative, gcd);
+
+	// v(x) = v_s(x / s); P'(x) = P_s'(x / s) / s carries one more 1 / s
+	power = 1;
+	for (size_t i = 0; i < squareFree.size(); i++) {
+		squareFree[i] = squareFree[i] / (T)power;
+		power *= s;
+	}
+	power = s;
+	for (size_t i = 0; i < derivativeQuotient.size(); i++) {
+		derivativeQuotient[i] = derivativeQuotient[i] / (T)power;
+		power *= s;
+	}
+}
+
+// Multiplicity of each root of the square-free part. With v = c prod (x - r_j)
+// and P = u v, P' / u = c sum_j m_j prod_(k != j) (x - r_k), so
+// m_j = w(r_j) / v'(r_j), rounded
+template <typename T>
+std::vector<int> root_multiplicities(const std::vector<T>& squareFree, const std::vector<T>& derivativeQuotient, const std::vector<T>& roots)
+{
+	size_t n = roots.size();
+	std::vector<T> values(n), derivatives(n), weights(n);
+	horner_evaluate(squareFree, n, roots.data(), values.data(), derivatives.data());
+	horner_evaluate(derivativeQuotient, n, roots.data(), weights.data());
+	std::vector<int> multiplicities(n);
+	for (size_t j = 0; j < n; j++) {
+		double m = std::real(weights[j] / derivatives[j]);
+		multiplicities[j] = std::max(1, (int)std::lround(m));
+	}
+	return multiplicities;
+}
@@ -0,0 +1,210 @@
+#pragma once
+#include <algorithm>
+#include <complex>
+#include <type_traits>
+#include "AlignedBuffer.h"
+#include "Gemm.h"
+#include "RowKernels.h"
+
+// Strassen-Winograd multiplication of square blocks: 7 half-size products
+// and 15 additions per level instead of 8 products. Sizes at or below the
+// crossover, or levels the scratch arena has no room for, use the classic
+// kernel. Odd sizes are handled by peeling off the last row and column.
+
+// Element types the Strassen path is enabled for (it needs subtraction and
+// gives up a little accuracy, so it is opt-in per type)
+template <typename T>
+struct StrassenSupported : std::false_type {};
+
+template <>
+struct StrassenSupported<double> : std::true_type {};
+
+template <>
+struct StrassenSupported<std::complex<double>> : std::true_type {};
+
+// Tunable parameters of the Strassen path
+struct StrassenSettings
+{
+	// Use Strassen in QSMatrix::operator* for square products
+	bool enabled;
+	// Blocks of this size and below are multiplied by the classic kernel
+	unsigned crossover;
+	// Upper bound on the scratch memory of one multiplication
+	size_t scratchLimitBytes;
+
+	static StrassenSettings& Instance()
+	{
+		static StrassenSettings settings = { false, 512, size_t(256) << 20 };
+		return settings;
+	}
+};
+
+// Bump allocator over one preallocated block. Blocks are released in
+// reverse order by resetting to a mark
+template <typename T>
+class ScratchArena
+{
+private:
+	AlignedBuffer<T> storage;
+	size_t used;
+
+public:
+	explicit ScratchArena(size_t capacity) : storage(AlignedBuffer<T>::uninitialized(capacity)), used(0) {}
+
+	// Block of n elements, nullptr when the arena is full
+	T* allocate(size_t n)
+	{
+		// Keep every block on a cache line boundary
+		const size_t line = CACHE_LINE_SIZE % sizeof(T) == 0 ? CACHE_LINE_SIZE / sizeof(T) : 1;
+		size_t start = (used + line - 1) / line * line;
+		if (start + n > storage.size())
+			return nullptr;
+		used = start + n;
+		return storage.data() + start;
+	}
+
+	size_t mark() const { return used; }
+	void reset(size_t position) { used = position; }
+};
+
+// r = x + y on h x h blocks
+template <typename T>
+inline void block_add(unsigned h, const T* x, unsigned ldx, const T* y, unsigned ldy, T* r, unsigned ldr)
+{
+	for (unsigned i = 0; i < h; i++) {
+		row_add(h, x + (size_t)i * ldx, y + (size_t)i * ldy, r + (size_t)i * ldr);
+	}
+}
+
+// r = x - y on h x h blocks
+template <typename T>
+inline void block_sub(unsigned h, const T* x, unsigned ldx, const T* y, unsigned ldy, T* r, unsigned ldr)
+{
+	for (unsigned i = 0; i < h; i++) {
+		row_sub(h, x + (size_t)i * ldx, y + (size_t)i * ldy, r + (size_t)i * ldr);
+	}
+}
+
+// C = A * B by the classic kernel, C is overwritten
+template <typename T>
+inline void classic_multiply(unsigned n, const T* a, unsigned lda, const T* b, unsigned ldb, T* c, unsigned ldc)
+{
+	for (unsigned i = 0; i < n; i++) {
+		std::fill(c + (size_t)i * ldc, c + (size_t)i * ldc + n, T());
+	}
+	gemm_parallel(n, n, n, a, lda, b, ldb, c, ldc);
+}
+
+// C = A * B for n x n blocks, C is overwritten
+template <typename T>
+void strassen_multiply(unsigned n, const T* a, unsigned lda, const T* b, unsigned ldb, T* c, unsigned ldc, unsigned crossover, ScratchArena<T>& arena)
+{
+	if (n <= crossover || n < 2) {
+		classic_multiply(n, a, lda, b, ldb, c, ldc);
+		return;
+	}
+
+	// Peeling: the even part recursively, the last row and column by gemm
+	if (n % 2 == 1) {
+		unsigned e = n - 1;
+		strassen_multiply(e, a, lda, b, ldb, c, ldc, crossover, arena);
+		// C[0:e, 0:e] += A[0:e, e] * B[e, 0:e]
+		gemm_parallel(e, e, 1, a + e, lda, b + (size_t)e * ldb, ldb, c, ldc);
+		// C[0:e, e] = A[0:e, :] * B[:, e]
+		for (unsigned i = 0; i < e; i++) {
+			c[(size_t)i * ldc + e] = T();
+		}
+		gemm_parallel(e, 1, n, a, lda, b + e, ldb, c + e, ldc);
+		// C[e, :] = A[e, :] * B
+		std::fill(c + (size_t)e * ldc, c + (size_t)e * ldc + n, T());
+		gemm_parallel(1, n, n, a + (size_t)e * lda, lda, b, ldb, c + (size_t)e * ldc, ldc);
+		return;
+	}
+
+	unsigned h = n / 2;
+	size_t mark = arena.mark();
+	T* x = arena.allocate((size_t)h * h);
+	T* y = arena.allocate((size_t)h * h);
+	if (x == nullptr || y == nullptr) {
+		arena.reset(mark);
+		classic_multiply(n, a, lda, b, ldb, c, ldc);
+		return;
+	}
+
+	const T* a11 = a;
+	const T* a12 = a + h;
+	const T* a21 = a + (size_t)h * lda;
+	const T* a22 = a21 + h;
+	const T* b11 = b;
+	const T* b12 = b + h;
+	const T* b21 = b + (size_t)h * ldb;
+	const T* b22 = b21 + h;
+	T* c11 = c;
+	T* c12 = c + h;
+	T* c21 = c + (size_t)h * ldc;
+	T* c22 = c21 + h;
+
+	// Schedule with two temporaries, X and Y (Boyer, Dumas, Pernet, Zhou)
+	block_sub(h, a11, lda, a21, lda, x, h);                          // S3 = A11 - A21
+	block_sub(h, b22, ldb, b12, ldb, y, h);                          // T3 = B22 - B12
+	strassen_multiply(h, x, h, y, h, c21, ldc, crossover, arena);    // P7 = S3 * T3
+	block_add(h, a21, lda, a22, lda, x, h);                          // S1 = A21 + A22
+	block_sub(h, b12, ldb, b11, ldb, y, h);                          // T1 = B12 - B11
+	strassen_multiply(h, x, h, y, h, c22, ldc, crossover, arena);    // P5 = S1 * T1
+	block_sub(h, x, h, a11, lda, x, h);                              // S2 = S1 - A11
+	block_sub(h, b22, ldb, y, h, y, h);                              // T2 = B22 - T1
+	strassen_multiply(h, x, h, y, h, c12, ldc, crossover, arena);    // P6 = S2 * T2
+	block_sub(h, a12, lda, x, h, x, h);                              // S4 = A12 - S2
+	strassen_multiply(h, x, h, b22, ldb, c11, ldc, crossover, arena);// P3 = S4 * B22
+	strassen_multiply(h, a11, lda, b11, ldb, x, h, crossover, arena);// P1 = A11 * B11
+	block_add(h, x, h, c12, ldc, c12, ldc);                          // U2 = P1 + P6
+	block_add(h, c12, ldc, c21, ldc, c21, ldc);                      // U3 = U2 + P7
+	block_add(h, c12, ldc, c22, ldc, c12, ldc);                      // U4 = U2 + P5
+	block_add(h, c21, ldc, c22, ldc, c22, ldc);                      // C22 = U3 + P5
+	block_add(h, c12, ldc, c11, ldc, c12, ldc);                      // C12 = U4 + P3
+	block_sub(h, y, h, b21, ldb, y, h);                              // T4 = T2 - B21
+	strassen_multiply(h, a22, lda, y, h, c11, ldc, crossover, arena);// P4 = A22 * T4
+	block_sub(h, c21, ldc, c11, ldc, c21, ldc);                      // C21 = U3 - P4
+	strassen_multiply(h, a12, lda, b21, ldb, c11, ldc, crossover, arena);// P2 = A12 * B21
+	block_add(h, x, h, c11, ldc, c11, ldc);                          // C11 = P1 + P2
+
+	arena.reset(mark);
+}
+
+// Scratch elements the recursion needs: two h x h blocks per level
+inline size_t strassen_scratch_size(unsigned n, unsigned crossover, size_t lineElements)
+{
+	size_t total = 0;
+	while (n > crossover && n >= 2) {
+		n -= n % 2;
+		unsigned h = n / 2;
+		total += 2 * ((size_t)h * h + lineElements);
+		n = h;
+	}
+	return total;
+}
+
+// C = A * B for n x n blocks with the scratch memory capped by scratchLimitBytes
+template <typename T>
+void strassen(unsigned n, const T* a, unsigned lda, const T* b, unsigned ldb, T* c, unsigned ldc, unsigned crossover, size_t scratchLimitBytes)
+{
+	const size_t line = CACHE_LINE_SIZE % sizeof(T) == 0 ? CACHE_LINE_SIZE / sizeof(T) : 1;
+	size_t needed = strassen_scratch_size(n, crossover, line);
+	ScratchArena<T> arena(std::min(needed, scratchLimitBytes / sizeof(T)));
+	strassen_multiply(n, a, lda, b, ldb, c, ldc, crossover, arena);
+}
+
+// C = A * B for a zero-filled C: Strassen for square products above the
+// crossover when it is enabled for T, gemm_parallel otherwise
+template <typename T>
+void multiply_dispatch(unsigned m, unsigned n, unsigned k, const T* a, unsigned lda, const T* b, unsigned ldb, T* c, unsigned ldc)
+{
+	if constexpr (StrassenSupported<T>::value) {
+		const StrassenSettings& settings = StrassenSettings::Instance();
+		if (settings.enabled && m == n && n == k && n > settings.crossover) {
+			strassen(n, a, lda, b, ldb, c, ldc, settings.crossover, settings.scratchLimitBytes);
+			return;
+		}
+	}
+	gemm_parallel(m, n, k, a, lda, b, ldb, c, ldc);
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include <algorithm>
+#include <vector>
+#include "PolynomialMultiply.h"
+
+// Taylor shift: the coefficients of P(x + a) from those of P(x), lowest
+// degree first.
+
+// Tunable parameters of the Taylor shift
+struct TaylorShiftSettings
+{
+	// Shift long polynomials by divide and conquer. It takes O(log n) fast
+	// multiplications instead of O(n^2) operations, but every product
+	// mixes coefficients of very different magnitude (those of (x + a)^m
+	// span many orders), so the small ones of the result lose most of
+	// their digits; off by default
+	bool divide;
+	// With divide on, polynomials with more coefficients than this are
+	// split, shorter ones are shifted by synthetic division
+	size_t divideThreshold;
+
+	static TaylorShiftSettings& Instance()
+	{
+		static TaylorShiftSettings settings = { false, 256 };
+		return settings;
+	}
+};
+
+// c[0 .. n) becomes the coefficients of P(x + a) by n - 1 rounds of
+// synthetic division by x - a, in place: O(n^2) operations, no memory
+template <typename T>
+void taylor_shift_horner(T* c, size_t n, const T& a)
+{
+	for (size_t i = 0; i + 1 < n; i++) {
+		for (size_t j = n - 1; j-- > i;) {
+			c[j] = c[j] + a * c[j + 1];
+		}
+	}
+}
+
+// P(x + a) = L(x + a) + (x + a)^m H(x + a) for P = L + x^m H with m the
+// largest power of two below n. powers[i] holds (x + a)^(2^i), so every
+// level of the recursion is one multiplication
+template <typename T>
+std::vector<T> taylor_shift_split(const T* c, size_t n, const T& a, const std::vector<std::vector<T>>& powers, size_t threshold)
+{
+	if (n <= threshold) {
+		std::vector<T> result(c, c + n);
+		taylor_shift_horner(result.data(), n, a);
+		return result;
+	}
+
+	unsigned level = 0;
+	while ((size_t(2) << level) < n) {
+		level++;
+	}
+	size_t m = size_t(1) << level;
+	std::vector<T> result = taylor_shift_split(c, m, a, powers, threshold);
+	std::vector<T> high = taylor_shift_split(c + m, n - m, a, powers, threshold);
+	std::vector<T> product = polynomial_multiply(high, powers[level]);
+	result.resize(n, T());
+	for (size_t k = 0; k < n; k++) {
+		result[k] = result[k] + product[k];
+	}
+	return result;
+}
+
+// coefficients become those of P(x + a), in place by synthetic division.
+// With TaylorShiftSettings::divide on, long ones are split in halves
+// recursively, with O(log n) multiplications through the fast paths of
+// polynomial_multiply, at the price of temporary memory and precision
+template <typename T>
+void taylor_shift(std::vector<T>& coefficients, const T& a)
+{
+	const TaylorShiftSettings& settings = TaylorShiftSettings::Instance();
+	size_t n = coefficients.size();
+	size_t threshold = std::max<size_t>(1, settings.divideThreshold);
+	if (!settings.divide || n <= threshold) {
+		taylor_shift_horner(coefficients.data(), n, a);
+		return;
+	}
+
+	std::vector<std::vector<T>> powers(1, std::vector<T>{ a, T(1) });
+	while ((size_t(1) << powers.size()) < n) {
+		powers.push_back(polynomial_square(powers.back()));
+	}
+	coefficients = taylor_shift_split(coefficients.data(), n, a, powers, threshold);
+}
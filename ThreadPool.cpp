@@ -0,0 +1,175 @@
+#include "ThreadPool.h"
+
+// Index of the queue owned by the current thread, -1 outside the pool
+static thread_local int workerIndex = -1;
+
+ThreadPool& ThreadPool::Instance()
+{
+	static ThreadPool instance;
+	return instance;
+}
+
+ThreadPool::ThreadPool() : pending(0), nextQueue(0), stopping(false), threadCount(1)
+{
+	unsigned count = std::thread::hardware_concurrency();
+	Start(count > 0 ? count : 1);
+}
+
+ThreadPool::~ThreadPool()
+{
+	Stop();
+}
+
+void ThreadPool::Start(unsigned count)
+{
+	threadCount = count;
+	stopping = false;
+	// The calling thread counts as one of the threads
+	for (unsigned i = 0; i + 1 < count; i++) {
+		queues.push_back(std::unique_ptr<WorkQueue>(new WorkQueue()));
+	}
+	for (unsigned i = 0; i + 1 < count; i++) {
+		workers.push_back(std::thread(&ThreadPool::WorkerLoop, this, i));
+	}
+}
+
+void ThreadPool::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		stopping = true;
+	}
+	sleepCondition.notify_all();
+	for (auto &worker : workers) {
+		worker.join();
+	}
+	workers.clear();
+	queues.clear();
+}
+
+void ThreadPool::SetThreadCount(unsigned count)
+{
+	if (count == 0)
+		count = 1;
+	if (count == threadCount)
+		return;
+	Stop();
+	Start(count);
+}
+
+unsigned ThreadPool::ThreadCount() const
+{
+	return threadCount;
+}
+
+void ThreadPool::Submit(std::function<void()> task)
+{
+	// Workers push to their own queue, other threads spread round-robin
+	size_t index = workerIndex >= 0 ? workerIndex : nextQueue++ % queues.size();
+	{
+		std::lock_guard<std::mutex> lock(queues[index]->mutex);
+		queues[index]->tasks.push_back(std::move(task));
+	}
+	pending++;
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+	}
+	sleepCondition.notify_one();
+}
+
+bool ThreadPool::TryRunOne()
+{
+	std::function<void()> task;
+	size_t count = queues.size();
+	size_t self = workerIndex >= 0 ? workerIndex : 0;
+
+	// Own queue from the back (most recent, still in cache)
+	if (workerIndex >= 0) {
+		WorkQueue &queue = *queues[self];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (!queue.tasks.empty()) {
+			task = std::move(queue.tasks.back());
+			queue.tasks.pop_back();
+		}
+	}
+
+	// Steal the oldest task of another queue
+	for (size_t i = 0; !task && i < count; i++) {
+		WorkQueue &queue = *queues[(self + i) % count];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (!queue.tasks.empty()) {
+			task = std::move(queue.tasks.front());
+			queue.tasks.pop_front();
+		}
+	}
+
+	if (!task)
+		return false;
+
+	pending--;
+	task();
+	return true;
+}
+
+void ThreadPool::WorkerLoop(unsigned index)
+{
+	workerIndex = index;
+	while (true) {
+		if (TryRunOne())
+			continue;
+
+		std::unique_lock<std::mutex> lock(sleepMutex);
+		sleepCondition.wait(lock, [this]() { return stopping || pending > 0; });
+		if (stopping)
+			return;
+	}
+}
+
+void ThreadPool::ParallelFor(size_t count, size_t grain, const RangeFunc& func)
+{
+	if (count == 0)
+		return;
+	if (grain == 0)
+		grain = 1;
+
+	// A few chunks per thread so that stealing can even out the load
+	size_t chunks = (count + grain - 1) / grain;
+	size_t maxChunks = (size_t)threadCount * 4;
+	if (chunks > maxChunks)
+		chunks = maxChunks;
+
+	if (chunks <= 1 || threadCount <= 1) {
+		func(0, count);
+		return;
+	}
+
+	std::atomic<size_t> remaining(chunks);
+	size_t chunkSize = count / chunks;
+	size_t extra = count % chunks;
+	size_t begin = 0;
+	size_t firstEnd = 0;
+
+	for (size_t chunk = 0; chunk < chunks; chunk++) {
+		size_t end = begin + chunkSize + (chunk < extra ? 1 : 0);
+		if (chunk == 0) {
+			// The first chunk is run by the caller itself
+			firstEnd = end;
+		}
+		else {
+			Submit([&func, &remaining, begin, end]() {
+				func(begin, end);
+				remaining--;
+			});
+		}
+		begin = end;
+	}
+
+	func(0, firstEnd);
+	remaining--;
+
+	// Help with any queued work until all chunks of this call are done
+	while (remaining > 0) {
+		if (!TryRunOne())
+			std::this_thread::yield();
+	}
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Smallest number of elements of element-wise work worth handing to
+// another thread; anything below runs serially on the caller
+static const size_t PARALLEL_MIN_ELEMENTS = 1 << 15;
+
+// Work-stealing thread pool owned by the library. Every worker has its own
+// deque: it takes its own work from the back and steals from the front of
+// the others. The thread calling ParallelFor works too, so nested calls
+// cannot deadlock.
+class ThreadPool
+{
+public:
+	typedef std::function<void(size_t, size_t)> RangeFunc;
+
+	static ThreadPool& Instance();
+
+	// Total number of threads running a ParallelFor, the caller included.
+	// Defaults to std::thread::hardware_concurrency(). Must not be called
+	// while a ParallelFor is running
+	void SetThreadCount(unsigned count);
+	unsigned ThreadCount() const;
+
+	// Splits [0, count) into chunks of at least grain items and runs
+	// func(begin, end) for each of them. Runs inline when there is only one
+	// chunk or one thread. Returns when all chunks are done.
+	void ParallelFor(size_t count, size_t grain, const RangeFunc& func);
+
+	~ThreadPool();
+
+private:
+	struct WorkQueue
+	{
+		std::mutex mutex;
+		std::deque<std::function<void()>> tasks;
+	};
+
+	std::vector<std::thread> workers;
+	std::vector<std::unique_ptr<WorkQueue>> queues;
+	std::atomic<size_t> pending;
+	std::atomic<unsigned> nextQueue;
+	bool stopping;
+	std::mutex sleepMutex;
+	std::condition_variable sleepCondition;
+	unsigned threadCount;
+
+	ThreadPool();
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	void Start(unsigned count);
+	void Stop();
+	void Submit(std::function<void()> task);
+	bool TryRunOne();
+	void WorkerLoop(unsigned index);
+};
@@ -0,0 +1,67 @@
+#pragma once
+#include <vector>
+#include "Fft.h"
+#include "QSMatrix.h"
+
+// Lower-triangular Toeplitz matrix rows x cols: element (i, j) is
+// column[i - j] on and below the diagonal and zero above it. Only the
+// first column is stored. Multiplying a vector by it is multiplying a
+// polynomial by column and dropping the terms from x^rows, a convolution.
+template <typename T>
+class LowerToeplitz
+{
+private:
+	unsigned rows;
+	unsigned cols;
+	std::vector<T> column;
+
+public:
+	typedef T value_type;
+
+	// column holds the first column, it is cut or padded with zeroes to rows
+	LowerToeplitz(unsigned _rows, unsigned _cols, const std::vector<T>& _column) : rows(_rows), cols(_cols), column(_column)
+	{
+		column.resize(rows, T());
+	}
+
+	unsigned get_rows() const { return rows; }
+	unsigned get_cols() const { return cols; }
+	const std::vector<T>& first_column() const { return column; }
+
+	T operator()(unsigned row, unsigned col) const
+	{
+		return row >= col ? column[row - col] : T();
+	}
+
+	QSMatrix<T> to_matrix() const
+	{
+		QSMatrix<T> result(rows, cols, T());
+		for (unsigned j = 0; j < cols; j++) {
+			for (unsigned i = j; i < rows; i++) {
+				result(i, j) = column[i - j];
+			}
+		}
+		return result;
+	}
+
+	// Product with a vector of cols elements
+	std::vector<T> operator*(const std::vector<T>& rhs) const
+	{
+		return convolve(column, rhs, rows);
+	}
+};
+
+// First column of the product T0 * T1 * ... * Tk of lower Toeplitz matrices.
+// A rectangular product is not Toeplitz itself (the terms dropped by one
+// factor still reach the rows of the next), so the chain is applied from
+// the right to the first column of Tk: k convolutions instead of k dense
+// matrix products
+template <typename T>
+std::vector<T> toeplitz_chain_column(const std::vector<LowerToeplitz<T>>& chain)
+{
+	std::vector<T> result = chain.back().first_column();
+	for (size_t i = chain.size() - 1; i-- > 0;) {
+		result = chain[i] * result;
+	}
+	return result;
+}
@@ -0,0 +1,551 @@
+#pragma once
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include "BigIntKernels.h"
+#include "DecimalFormat.h"
+
+// Unsigned integer of a fixed number of bits, a multiple of 64, kept in place
+// as 64-bit limbs, least significant first. Arithmetic wraps modulo 2^Bits
+// like the built-in unsigned types. Every operation is constexpr. Additions
+// and comparisons are expanded over the limb indices into one add-with-carry
+// chain, products into 64 x 64 -> 128 bit multiplies, with no branches on
+// the values and no heap.
+
+namespace wide_uint_detail
+{
+#if defined(__SIZEOF_INT128__)
+	typedef unsigned __int128 uint128;
+#endif
+
+	// Whether evaluation happens at compile time, where the carry intrinsics
+	// of BigIntKernels.h cannot be used
+	constexpr bool constant_evaluated()
+	{
+#if defined(__GNUC__) || defined(__clang__) || (defined(_MSC_VER) && _MSC_VER >= 1928)
+		return __builtin_is_constant_evaluated();
+#else
+		return true;
+#endif
+	}
+
+	// sum = a + b + carry for carry 0 or 1, returns the carry out
+	constexpr uint64_t add_carry(uint64_t a, uint64_t b, uint64_t carry, uint64_t& sum)
+	{
+		if (!constant_evaluated())
+			return limb_add_carry((unsigned char)carry, a, b, sum);
+#if defined(__SIZEOF_INT128__)
+		uint128 total = (uint128)a + b + carry;
+		sum = (uint64_t)total;
+		return (uint64_t)(total >> 64);
+#else
+		uint64_t partial = a + b;
+		uint64_t total = partial + carry;
+		sum = total;
+		return (uint64_t)(partial < a) | (uint64_t)(total < partial);
+#endif
+	}
+
+	// difference = a - b - borrow for borrow 0 or 1, returns the borrow out
+	constexpr uint64_t sub_borrow(uint64_t a, uint64_t b, uint64_t borrow, uint64_t& difference)
+	{
+		if (!constant_evaluated())
+			return limb_sub_borrow((unsigned char)borrow, a, b, difference);
+#if defined(__SIZEOF_INT128__)
+		uint128 total = (uint128)a - b - borrow;
+		difference = (uint64_t)total;
+		return (uint64_t)(total >> 127);
+#else
+		uint64_t partial = a - b;
+		difference = partial - borrow;
+		return (uint64_t)(a < b) | (uint64_t)(partial < borrow);
+#endif
+	}
+
+	// a * b + c + d as high:low, which cannot overflow 128 bits; returns low
+	constexpr uint64_t mul_add(uint64_t a, uint64_t b, uint64_t c, uint64_t d, uint64_t& high)
+	{
+#if defined(__SIZEOF_INT128__)
+		uint128 product = (uint128)a * b + c + d;
+		high = (uint64_t)(product >> 64);
+		return (uint64_t)product;
+#else
+		if (!constant_evaluated())
+			return limb_mul_add(a, b, c, d, high);
+		return limb_mul_add_portable(a, b, c, d, high);
+#endif
+	}
+
+	// (high:low) / divisor for high < divisor, the remainder goes to remainder
+	constexpr uint64_t div(uint64_t high, uint64_t low, uint64_t divisor, uint64_t& remainder)
+	{
+#if defined(__SIZEOF_INT128__)
+		uint128 dividend = ((uint128)high << 64) | low;
+		remainder = (uint64_t)(dividend % divisor);
+		return (uint64_t)(dividend / divisor);
+#else
+		if (!constant_evaluated())
+			return limb_div(high, low, divisor, remainder);
+		return limb_div_portable(high, low, divisor, remainder);
+#endif
+	}
+
+	// Number of leading zero bits of a nonzero limb
+	constexpr unsigned leading_zeros(uint64_t a)
+	{
+#if defined(_MSC_VER) && !defined(__clang__)
+		unsigned count = 0;
+		for (unsigned width = 32; width > 0; width /= 2) {
+			if ((a >> (64 - width)) == 0) {
+				count += width;
+				a <<= width;
+			}
+		}
+		return count;
+#else
+		return (unsigned)__builtin_clzll(a);
+#endif
+	}
+}
+
+template <unsigned Bits>
+class WideUInt
+{
+	static_assert(Bits > 0 && Bits % 64 == 0, "width must be a multiple of 64 bits");
+
+public:
+	static constexpr unsigned LIMBS = Bits / 64;
+	// Most chars write_decimal can write: log10(2) < 1234 / 4096
+	static constexpr size_t DECIMAL_CAPACITY = (size_t)Bits * 1234 / 4096 + 1;
+
+	uint64_t limbs[LIMBS];
+
+	constexpr WideUInt() : limbs{} {}
+
+	// Negative values wrap modulo 2^Bits, as for the built-in unsigned types
+	template <typename Integer, typename = typename std::enable_if<std::is_integral<Integer>::value>::type>
+	constexpr WideUInt(Integer n) : limbs{}
+	{
+		static_assert(sizeof(Integer) <= sizeof(uint64_t), "integer wider than a limb");
+		uint64_t extension = std::is_signed<Integer>::value && n < 0 ? ~0ULL : 0;
+		limbs[0] = (uint64_t)n;
+		for (unsigned i = 1; i < LIMBS; i++) {
+			limbs[i] = extension;
+		}
+	}
+
+	// Zero-extends a narrower value, a wider one is taken modulo 2^Bits
+	template <unsigned OtherBits>
+	explicit constexpr WideUInt(const WideUInt<OtherBits>& other) : limbs{}
+	{
+		for (unsigned i = 0; i < LIMBS && i < WideUInt<OtherBits>::LIMBS; i++) {
+			limbs[i] = other.limbs[i];
+		}
+	}
+
+	// Decimal digits, leading zeros allowed; the value must fit
+	constexpr WideUInt(const char* decimal, size_t length) : limbs{}
+	{
+		assert(length > 0 && "no digits");
+		for (size_t position = 0; position < length;) {
+			// value = value 10^count + next count <= 19 digits
+			size_t count = length - position < 19 ? length - position : 19;
+			uint64_t chunk = 0;
+			uint64_t scale = 1;
+			for (size_t end = position + count; position < end; position++) {
+				assert(decimal[position] >= '0' && decimal[position] <= '9' && "not a decimal digit");
+				chunk = chunk * 10 + (uint64_t)(decimal[position] - '0');
+				scale *= 10;
+			}
+			uint64_t carry = chunk;
+			for (unsigned i = 0; i < LIMBS; i++) {
+				limbs[i] = wide_uint_detail::mul_add(limbs[i], scale, carry, 0, carry);
+			}
+			assert(carry == 0 && "value does not fit");
+		}
+	}
+
+	explicit WideUInt(const std::string& decimal) : WideUInt(decimal.data(), decimal.size()) {}
+
+	constexpr bool is_zero() const
+	{
+		uint64_t bits = 0;
+		for (unsigned i = 0; i < LIMBS; i++) {
+			bits |= limbs[i];
+		}
+		return bits == 0;
+	}
+
+	// Position of the highest set bit plus one, 0 for zero
+	constexpr unsigned bit_length() const
+	{
+		unsigned n = significant_limbs();
+		return n == 0 ? 0 : 64 * n - wide_uint_detail::leading_zeros(limbs[n - 1]);
+	}
+
+	explicit constexpr operator bool() const { return !is_zero(); }
+
+	// The low bits, as a built-in unsigned conversion would keep them
+	template <typename Integer, typename = typename std::enable_if<std::is_integral<Integer>::value>::type>
+	explicit constexpr operator Integer() const { return (Integer)limbs[0]; }
+
+	constexpr WideUInt& operator+=(const WideUInt& other)
+	{
+		add(other, std::make_index_sequence<LIMBS>());
+		return *this;
+	}
+
+	constexpr WideUInt& operator-=(const WideUInt& other)
+	{
+		subtract(other, std::make_index_sequence<LIMBS>());
+		return *this;
+	}
+
+	constexpr WideUInt& operator*=(const WideUInt& other)
+	{
+		return *this = multiply(*this, other, std::make_index_sequence<LIMBS>());
+	}
+
+	constexpr WideUInt& operator/=(const WideUInt& other)
+	{
+		WideUInt remainder;
+		divide(*this, other, *this, remainder);
+		return *this;
+	}
+
+	constexpr WideUInt& operator%=(const WideUInt& other)
+	{
+		WideUInt quotient;
+		divide(*this, other, quotient, *this);
+		return *this;
+	}
+
+	constexpr WideUInt& operator&=(const WideUInt& other)
+	{
+		for (unsigned i = 0; i < LIMBS; i++) {
+			limbs[i] &= other.limbs[i];
+		}
+		return *this;
+	}
+
+	constexpr WideUInt& operator|=(const WideUInt& other)
+	{
+		for (unsigned i = 0; i < LIMBS; i++) {
+			limbs[i] |= other.limbs[i];
+		}
+		return *this;
+	}
+
+	constexpr WideUInt& operator^=(const WideUInt& other)
+	{
+		for (unsigned i = 0; i < LIMBS; i++) {
+			limbs[i] ^= other.limbs[i];
+		}
+		return *this;
+	}
+
+	// Shifts by Bits or more give zero
+	constexpr WideUInt& operator<<=(unsigned shift)
+	{
+		unsigned limbShift = shift / 64;
+		unsigned bitShift = shift % 64;
+		for (unsigned i = LIMBS; i-- > 0;) {
+			uint64_t value = 0;
+			if (i >= limbShift) {
+				value = limbs[i - limbShift] << bitShift;
+				if (bitShift != 0 && i > limbShift)
+					value |= limbs[i - limbShift - 1] >> (64 - bitShift);
+			}
+			limbs[i] = value;
+		}
+		return *this;
+	}
+
+	constexpr WideUInt& operator>>=(unsigned shift)
+	{
+		unsigned limbShift = shift / 64;
+		unsigned bitShift = shift % 64;
+		for (unsigned i = 0; i < LIMBS; i++) {
+			uint64_t value = 0;
+			if (limbShift < LIMBS - i) {
+				value = limbs[i + limbShift] >> bitShift;
+				if (bitShift != 0 && limbShift < LIMBS - i - 1)
+					value |= limbs[i + limbShift + 1] << (64 - bitShift);
+			}
+			limbs[i] = value;
+		}
+		return *this;
+	}
+
+	constexpr WideUInt& operator++() { return *this += WideUInt(1); }
+	constexpr WideUInt& operator--() { return *this -= WideUInt(1); }
+	constexpr WideUInt operator++(int) { WideUInt previous = *this; ++*this; return previous; }
+	constexpr WideUInt operator--(int) { WideUInt previous = *this; --*this; return previous; }
+
+	constexpr WideUInt operator~() const
+	{
+		WideUInt result;
+		for (unsigned i = 0; i < LIMBS; i++) {
+			result.limbs[i] = ~limbs[i];
+		}
+		return result;
+	}
+
+	// 2^Bits - value, as for the built-in unsigned types
+	constexpr WideUInt operator-() const { return WideUInt() - *this; }
+	constexpr WideUInt operator+() const { return *this; }
+
+	friend constexpr WideUInt operator+(WideUInt lhs, const WideUInt& rhs) { return lhs += rhs; }
+	friend constexpr WideUInt operator-(WideUInt lhs, const WideUInt& rhs) { return lhs -= rhs; }
+	friend constexpr WideUInt operator*(WideUInt lhs, const WideUInt& rhs) { return lhs *= rhs; }
+	friend constexpr WideUInt operator/(WideUInt lhs, const WideUInt& rhs) { return lhs /= rhs; }
+	friend constexpr WideUInt operator%(WideUInt lhs, const WideUInt& rhs) { return lhs %= rhs; }
+	friend constexpr WideUInt operator&(WideUInt lhs, const WideUInt& rhs) { return lhs &= rhs; }
+	friend constexpr WideUInt operator|(WideUInt lhs, const WideUInt& rhs) { return lhs |= rhs; }
+	friend constexpr WideUInt operator^(WideUInt lhs, const WideUInt& rhs) { return lhs ^= rhs; }
+	friend constexpr WideUInt operator<<(WideUInt lhs, unsigned shift) { return lhs <<= shift; }
+	friend constexpr WideUInt operator>>(WideUInt lhs, unsigned shift) { return lhs >>= shift; }
+
+	// Quotient and remainder in one division
+	friend constexpr std::pair<WideUInt, WideUInt> divmod(const WideUInt& lhs, const WideUInt& rhs)
+	{
+		WideUInt quotient, remainder;
+		divide(lhs, rhs, quotient, remainder);
+		return std::pair<WideUInt, WideUInt>(quotient, remainder);
+	}
+
+	// Equality from the OR of the limb differences and order from the borrow
+	// of lhs - rhs, so neither branches on the limbs
+	friend constexpr bool operator==(const WideUInt& lhs, const WideUInt& rhs)
+	{
+		uint64_t difference = 0;
+		for (unsigned i = 0; i < LIMBS; i++) {
+			difference |= lhs.limbs[i] ^ rhs.limbs[i];
+		}
+		return difference == 0;
+	}
+
+	friend constexpr bool operator<(const WideUInt& lhs, const WideUInt& rhs)
+	{
+		return lhs.less(rhs, std::make_index_sequence<LIMBS>());
+	}
+
+	friend constexpr bool operator!=(const WideUInt& lhs, const WideUInt& rhs) { return !(lhs == rhs); }
+	friend constexpr bool operator>(const WideUInt& lhs, const WideUInt& rhs) { return rhs < lhs; }
+	friend constexpr bool operator<=(const WideUInt& lhs, const WideUInt& rhs) { return !(rhs < lhs); }
+	friend constexpr bool operator>=(const WideUInt& lhs, const WideUInt& rhs) { return !(lhs < rhs); }
+
+	// Writes the decimal digits, "0" for zero, into buffer of
+	// DECIMAL_CAPACITY chars or more; returns their number
+	size_t write_decimal(char* buffer) const
+	{
+		// 19-digit chunks from the bottom by single-limb division
+		const uint64_t chunkBase = UINT64_POWERS_OF_TEN[19];
+		uint64_t chunks[DECIMAL_CAPACITY / 19 + 1] = {};
+		WideUInt rest = *this;
+		size_t n = rest.significant_limbs();
+		size_t count = 0;
+		while (n > 0) {
+			chunks[count++] = limbs_divmod_1(rest.limbs, rest.limbs, n, chunkBase);
+			while (n > 0 && rest.limbs[n - 1] == 0) {
+				n--;
+			}
+		}
+		if (count == 0)
+			return format_decimal(buffer, 0);
+
+		size_t written = format_decimal(buffer, chunks[count - 1]);
+		for (size_t i = count - 1; i-- > 0;) {
+			written += format_decimal_padded(buffer + written, chunks[i], 19);
+		}
+		return written;
+	}
+
+	std::string to_string() const
+	{
+		char buffer[DECIMAL_CAPACITY];
+		return std::string(buffer, write_decimal(buffer));
+	}
+
+	friend std::string to_string(const WideUInt& value) { return value.to_string(); }
+
+	friend std::ostream& operator<<(std::ostream& out, const WideUInt& value)
+	{
+		char buffer[DECIMAL_CAPACITY];
+		return out.write(buffer, (std::streamsize)value.write_decimal(buffer));
+	}
+
+private:
+	template <size_t... I>
+	constexpr void add(const WideUInt& other, std::index_sequence<I...>)
+	{
+		uint64_t carry = 0;
+		((carry = wide_uint_detail::add_carry(limbs[I], other.limbs[I], carry, limbs[I])), ...);
+	}
+
+	template <size_t... I>
+	constexpr void subtract(const WideUInt& other, std::index_sequence<I...>)
+	{
+		uint64_t borrow = 0;
+		((borrow = wide_uint_detail::sub_borrow(limbs[I], other.limbs[I], borrow, limbs[I])), ...);
+	}
+
+	// Rows product += a.limbs[I] b, only the partial products below 2^Bits
+	template <size_t... I>
+	static constexpr WideUInt multiply(const WideUInt& a, const WideUInt& b, std::index_sequence<I...>)
+	{
+		WideUInt product;
+		(multiply_row<I>(product, a, b, std::make_index_sequence<LIMBS - I>()), ...);
+		return product;
+	}
+
+	template <size_t I, size_t... J>
+	static constexpr void multiply_row(WideUInt& product, const WideUInt& a, const WideUInt& b, std::index_sequence<J...>)
+	{
+		uint64_t carry = 0;
+		((product.limbs[I + J] = wide_uint_detail::mul_add(a.limbs[I], b.limbs[J], product.limbs[I + J], carry, carry)), ...);
+	}
+
+	// The borrow out of this - other
+	template <size_t... I>
+	constexpr bool less(const WideUInt& other, std::index_sequence<I...>) const
+	{
+		uint64_t borrow = 0;
+		uint64_t difference = 0;
+		((borrow = wide_uint_detail::sub_borrow(limbs[I], other.limbs[I], borrow, difference)), ...);
+		return borrow != 0;
+	}
+
+	// Number of limbs without the leading zero ones
+	constexpr unsigned significant_limbs() const
+	{
+		unsigned n = LIMBS;
+		while (n > 0 && limbs[n - 1] == 0) {
+			n--;
+		}
+		return n;
+	}
+
+	// quotient = a / d and remainder = a % d, either may be a or d. A divisor
+	// of one limb takes a 128 / 64 bit division per limb, longer ones
+	// schoolbook long division (Knuth's algorithm D)
+	static constexpr void divide(const WideUInt& a, const WideUInt& d, WideUInt& quotient, WideUInt& remainder)
+	{
+		unsigned na = a.significant_limbs();
+		unsigned nd = d.significant_limbs();
+		assert(nd > 0 && "division by zero");
+		WideUInt q, r;
+		if (na < nd) {
+			r = a;
+		}
+		else if (nd == 1) {
+			uint64_t rest = 0;
+			for (unsigned i = na; i-- > 0;) {
+				q.limbs[i] = wide_uint_detail::div(rest, a.limbs[i], d.limbs[0], rest);
+			}
+			r.limbs[0] = rest;
+		}
+		else {
+			// With the top bit of the divisor set an estimate from the top two
+			// limbs of the remainder is at most 2 too large
+			unsigned shift = wide_uint_detail::leading_zeros(d.limbs[nd - 1]);
+			WideUInt divisor = d << shift;
+			uint64_t rest[LIMBS + 1] = {};
+			for (unsigned i = 0; i < na; i++) {
+				rest[i] = a.limbs[i] << shift;
+				if (shift != 0 && i > 0)
+					rest[i] |= a.limbs[i - 1] >> (64 - shift);
+			}
+			if (shift != 0)
+				rest[na] = a.limbs[na - 1] >> (64 - shift);
+			uint64_t top = divisor.limbs[nd - 1];
+			uint64_t next = divisor.limbs[nd - 2];
+
+			for (unsigned j = na - nd + 1; j-- > 0;) {
+				uint64_t* window = rest + j;
+				uint64_t estimate = 0;
+				uint64_t rest0 = 0;
+				bool restOverflow = false;
+				if (window[nd] == top) {
+					estimate = ~0ULL;
+					restOverflow = wide_uint_detail::add_carry(window[nd - 1], top, 0, rest0) != 0;
+				}
+				else {
+					estimate = wide_uint_detail::div(window[nd], window[nd - 1], top, rest0);
+				}
+				// The second divisor limb catches all but one case of a too
+				// large estimate
+				while (!restOverflow) {
+					uint64_t high = 0;
+					uint64_t low = wide_uint_detail::mul_add(estimate, next, 0, 0, high);
+					if (high < rest0 || (high == rest0 && low <= window[nd - 2]))
+						break;
+					estimate--;
+					restOverflow = wide_uint_detail::add_carry(rest0, top, 0, rest0) != 0;
+				}
+
+				// window -= estimate divisor, added back once if that went below zero
+				uint64_t carry = 0;
+				uint64_t borrow = 0;
+				for (unsigned i = 0; i < nd; i++) {
+					uint64_t low = wide_uint_detail::mul_add(estimate, divisor.limbs[i], carry, 0, carry);
+					borrow = wide_uint_detail::sub_borrow(window[i], low, borrow, window[i]);
+				}
+				borrow = wide_uint_detail::sub_borrow(window[nd], carry, borrow, window[nd]);
+				if (borrow != 0) {
+					estimate--;
+					carry = 0;
+					for (unsigned i = 0; i < nd; i++) {
+						carry = wide_uint_detail::add_carry(window[i], divisor.limbs[i], carry, window[i]);
+					}
+					window[nd] += carry;
+				}
+				q.limbs[j] = estimate;
+			}
+
+			for (unsigned i = 0; i < nd; i++) {
+				r.limbs[i] = rest[i] >> shift;
+				if (shift != 0)
+					r.limbs[i] |= rest[i + 1] << (64 - shift);
+			}
+		}
+		quotient = q;
+		remainder = r;
+	}
+};
+
+namespace wide_uint_detail
+{
+	// product += a.limbs[I] b, the carry out of the row included
+	template <size_t I, unsigned BitsP, unsigned BitsA, unsigned BitsB, size_t... J>
+	constexpr void wide_multiply_row(WideUInt<BitsP>& product, const WideUInt<BitsA>& a, const WideUInt<BitsB>& b, std::index_sequence<J...>)
+	{
+		uint64_t carry = 0;
+		((product.limbs[I + J] = mul_add(a.limbs[I], b.limbs[J], product.limbs[I + J], carry, carry)), ...);
+		product.limbs[I + sizeof...(J)] = carry;
+	}
+
+	template <unsigned BitsA, unsigned BitsB, size_t... I>
+	constexpr WideUInt<BitsA + BitsB> wide_multiply(const WideUInt<BitsA>& a, const WideUInt<BitsB>& b, std::index_sequence<I...>)
+	{
+		WideUInt<BitsA + BitsB> product;
+		(wide_multiply_row<I>(product, a, b, std::make_index_sequence<WideUInt<BitsB>::LIMBS>()), ...);
+		return product;
+	}
+}
+
+// The full product of a and b, no bits dropped
+template <unsigned BitsA, unsigned BitsB>
+constexpr WideUInt<BitsA + BitsB> wide_multiply(const WideUInt<BitsA>& a, const WideUInt<BitsB>& b)
+{
+	return wide_uint_detail::wide_multiply(a, b, std::make_index_sequence<WideUInt<BitsA>::LIMBS>());
+}
+
+typedef WideUInt<128> UInt128;
+typedef WideUInt<192> UInt192;
+typedef WideUInt<256> UInt256;
+typedef WideUInt<512> UInt512;
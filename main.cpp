@@ -6,8 +6,10 @@
 #include "Longplus.h"
 #include "LongPlusPlus.h"
 #include "QSMatrix.h"
+#include "FixedMatrix.h"
 #include "Polynomial.h"
 #include "Eigenvalues.h"
+#include "Benchmarks.h"
 
 using namespace std;
 
@@ -61,22 +63,12 @@ LongPlusPlus FibonachiLinear(int n)
 //  
 pair <LongPlusPlus, LongPlusPlus> FibonachiMatrix(int number)
 {
-	int matrixSize = 2;
-	QSMatrix <LongPlusPlus> initMatrix(matrixSize, matrixSize, LongPlusPlus(0));
-	QSMatrix <LongPlusPlus> subMatrix(matrixSize, 1, LongPlusPlus(0));
-	QSMatrix <LongPlusPlus> proxyMatrix(matrixSize, matrixSize, LongPlusPlus(0));
-	initMatrix(0, 0) = LongPlusPlus(1);
-	initMatrix(0, 1) = LongPlusPlus(1);
-	initMatrix(1, 0) = LongPlusPlus(1);
-	initMatrix(1, 1) = LongPlusPlus(0);
-	subMatrix(0, 0) = LongPlusPlus(1);
-	subMatrix(1, 0) = LongPlusPlus(0);
-	proxyMatrix = initMatrix;
-
-	for (int power = 1; power < number; power++) {
-		proxyMatrix = proxyMatrix * initMatrix;
-	}
-	
+	typedef FixedMatrix<LongPlusPlus, 2, 2> Matrix2x2;
+	const Matrix2x2 initMatrix(1, 1, 1, 0);
+	const FixedMatrix<LongPlusPlus, 2, 1> subMatrix(1, 0);
+	// O(log n)   n - 1
+	Matrix2x2 proxyMatrix = pow(initMatrix, number);
+
 	auto resultMatrix = proxyMatrix * subMatrix;
 
 	return make_pair(resultMatrix(0, 0), resultMatrix(1, 0));
@@ -118,6 +110,77 @@ void mainTest()
 	printf("Result: %s \n", sum.to_string().c_str());
 }
 
+/*
+*        ,
+*       
+*/
+bool moveSemanticsTest()
+{
+	typedef complex<double> cd;
+	unsigned size = 64;
+	QSMatrix<cd> a(size, size, cd(1, 1));
+	QSMatrix<cd> b(size, size, cd(2, 0));
+	QSMatrix<cd> c(size, size, cd(0, 3));
+	QSMatrix<cd> target(size, size, 0);
+	bool success = true;
+
+	// :   GEMM
+	QSMatrix<cd> warmUp = a * b;
+	QSMatrix<cd> scratch(size, size, 0);
+
+	auto check = [&success](const char *name, unsigned long long expected, unsigned long long startCount) {
+		unsigned long long allocations = AlignedAllocationCount().load() - startCount;
+		bool passed = allocations == expected;
+		success = success && passed;
+		printf("%-32s %llu allocation(s), expected %llu: %s\n", name, allocations, expected, passed ? "ok" : "FAIL");
+	};
+
+	unsigned long long startCount = AlignedAllocationCount().load();
+	QSMatrix<cd> moved = std::move(warmUp);
+	check("move construction", 0, startCount);
+
+	startCount = AlignedAllocationCount().load();
+	moved = a * b;
+	check("product + move assignment", 1, startCount);
+
+	startCount = AlignedAllocationCount().load();
+	QSMatrix<cd> fused = a + b * cd(2, 0) - c;
+	check("fused expression", 1, startCount);
+
+	startCount = AlignedAllocationCount().load();
+	target = a + b * cd(2, 0) - c;
+	check("fused expression, same size", 0, startCount);
+
+	startCount = AlignedAllocationCount().load();
+	QSMatrix<cd> reused = (a * b) + c * cd(0, 1);
+	check("expression over a temporary", 1, startCount);
+
+	startCount = AlignedAllocationCount().load();
+	QSMatrix<cd> scaled = std::move(fused) * cd(3, 0);
+	check("rvalue * scalar", 0, startCount);
+
+	startCount = AlignedAllocationCount().load();
+	target += a;
+	target -= b * cd(0.5, 0);
+	check("+= and -=", 0, startCount);
+
+	startCount = AlignedAllocationCount().load();
+	target += (a * b) * cd(0.5, 0);
+	check("+= over a temporary", 1, startCount);
+
+	startCount = AlignedAllocationCount().load();
+	target *= b;
+	target *= c;
+	check("*=", 2, startCount);
+
+	startCount = AlignedAllocationCount().load();
+	target.multiply_assign(b, scratch);
+	target.multiply_assign(c, scratch);
+	check("*= with a scratch matrix", 0, startCount);
+
+	return success;
+}
+
 /*
 *    
 */